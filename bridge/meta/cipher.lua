@@ -121,4 +121,18 @@ function ctx:finish() end
 ---@nodiscard
 function M.create(type) end
 
+---Encrypt/Decrypt data in one call.
+---
+---It reuses a cached cipher context, which is cheaper than ``create()``
+---for one-shot operations.
+---@param type CipherType Cipher type.
+---@param op '"encrypt"'|'"decrypt"'   Operation.
+---@param key string The key to use.
+---@param iv string|nil The initialization vector (IV).
+---@param input string Input binary data.
+---@param padding? CipherPadding The padding mode.
+---@return string output Output binary data.
+---@nodiscard
+function M.crypt(type, op, key, iv, input, padding) end
+
 return M
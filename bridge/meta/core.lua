@@ -9,6 +9,9 @@ local timer = {}
 ---@class MessageQueue:userdata Message queue.
 local mq = {}
 
+---@class Task:userdata Task running in its own coroutine.
+local task = {}
+
 ---Get current time in milliseconds.
 function core.time() end
 
@@ -23,6 +26,13 @@ function core.atexit(func) end
 ---@param ms integer Milliseconds.
 function core.sleep(ms) end
 
+---Set the tolerance of the timers.
+---
+---The timers may fire up to ``ms`` milliseconds late,
+---so that the timers due close together fire in one wakeup. Default is 0.
+---@param ms integer Tolerance in milliseconds, ``0`` to fire the timers on time.
+function core.setTimerTolerance(ms) end
+
 ---Create a timer.
 ---@param cb async fun(...) Function to call when the timer expires.
 ---@param ... any Arguments passed to the callback.
@@ -33,23 +43,37 @@ function core.createTimer(cb, ...) end
 ---Start the timer.
 ---If the timer has already started, it will start again.
 ---@param ms integer The timeout period in milliseconds.
-function timer:start(ms) end
+---@param periodic? boolean Whether to restart the timer automatically every ``ms`` milliseconds.
+function timer:start(ms, periodic) end
 
 ---Stop the timer before trigger.
 ---If the timer has not started, nothing will happen.
 function timer:stop() end
 
 ---Send message.
+---
+---When the message queue is full, the current coroutine
+---waits here until there is free space.
 ---@param ... any
 function mq:send(...) end
 
+---Send message without waiting.
+---@param ... any
+---@return boolean sent ``false`` if the message queue is full.
+function mq:trySend(...) end
+
 ---Receive message.
 ---
 ---When the message queue is empty, the current coroutine
----waits here until a message is received.
----@return ...
+---waits here until a message is received or the timeout expires.
+---Each message is received by only one coroutine.
+---
+---A message without values is received as nothing, the same as a timeout,
+---send at least one value if the receiver has to tell them apart.
+---@param timeout? integer Timeout in milliseconds, ``nil`` to wait forever, ``0`` to not wait.
+---@return ... The values of the message, nothing if the timeout expires.
 ---@nodiscard
-function mq:recv() end
+function mq:recv(timeout) end
 
 ---Create a message queue.
 ---@param size integer Queue size.
@@ -57,4 +81,132 @@ function mq:recv() end
 ---@nodiscard
 function core.createMQ(size) end
 
+---Run a function in a new task.
+---
+---The task runs at once until it waits for the first time,
+---then ``core.spawn()`` returns and the task continues in the background.
+---@param func async fun(...): ... Function to run.
+---@param ... any Arguments passed to the function.
+---@return Task task
+function core.spawn(func, ...) end
+
+---Wait for the task to finish.
+---
+---If the function of the task raised an error, the error is raised again here.
+---Any number of coroutines can join the same task.
+---@return ... The values returned by the function of the task.
+function task:join() end
+
+---Whether the task has finished.
+---@return boolean
+---@nodiscard
+function task:done() end
+
+---@alias GCMode
+---| '"incremental"'   # Incremental mode.
+---| '"generational"'  # Generational mode.
+
+---@class GCConfig:table GC configuration, the fields not present are left unchanged.
+---
+---@field mode GCMode GC mode.
+---@field stepSize integer Step size in KB, ``0`` means a basic step.
+---@field tickBudget integer Time budget in milliseconds for the steps at the end of each callback.
+---@field idleDelay integer Run loop idle time in milliseconds before the idle collection, ``0`` disables it.
+---@field idleBudget integer Time budget in milliseconds for each idle slice.
+---@field pressure integer Heap size in KB that triggers a full collection, ``0`` disables it.
+
+---@class GCPolicyStats:table GC policy statistics.
+---
+---@field count integer Number of runs.
+---@field steps integer Number of steps.
+---@field time integer Time spent in milliseconds.
+
+---@class GCStats:table GC statistics.
+---
+---@field cycles integer Number of completed cycles.
+---@field heap integer Current heap size in KB.
+---@field pressure integer Current heap size in KB that triggers a full collection, ``0`` if disabled.
+---@field tick GCPolicyStats Steps at the end of each callback.
+---@field idle GCPolicyStats Steps when the run loop is idle.
+---@field full GCPolicyStats Full collections under memory pressure.
+---@field emergency GCPolicyStats Collections after the heap crosses the soft limit.
+
+---Set GC configuration.
+---@param config GCConfig
+function core.setGCConfig(config) end
+
+---Get GC statistics.
+---@return GCStats stats
+---@nodiscard
+function core.getGCStats() end
+
+---@class ThreadPoolConfig:table Coroutine pool configuration, the fields not present are left unchanged.
+---
+---@field maxIdle integer Maximum number of idle coroutines kept for reuse.
+---@field trimInterval integer The idle coroutines not used for a whole interval in milliseconds are released, ``0`` disables it.
+
+---@class ThreadPoolStats:table Coroutine pool statistics.
+---
+---@field creates integer Number of coroutines created.
+---@field reuses integer Number of coroutines reused from the pool.
+---@field trims integer Number of idle coroutines released.
+---@field active integer Number of coroutines in use.
+---@field peakActive integer Peak number of coroutines in use.
+---@field idle integer Number of idle coroutines in the pool.
+
+---Set coroutine pool configuration.
+---@param config ThreadPoolConfig
+function core.setThreadPoolConfig(config) end
+
+---Get coroutine pool statistics.
+---@return ThreadPoolStats stats
+---@nodiscard
+function core.getThreadPoolStats() end
+
+---@class HeapClassStats:table Statistics of a size class of the Lua heap.
+---
+---@field size integer Block size in bytes, ``0`` for the blocks from the system allocator.
+---@field live integer Bytes in use.
+---@field peak integer Peak bytes in use.
+---@field slabs integer Number of slabs.
+
+---Get the statistics of the size classes of the Lua heap.
+---@return HeapClassStats[] stats
+---@nodiscard
+function core.getHeapStats() end
+
+---@class HeapConfig:table Heap budget configuration, the fields not present are left unchanged.
+---
+---@field softLimit integer Heap size in KB that triggers an emergency collection, ``0`` disables it.
+---@field hardLimit integer Heap size in KB above which allocations fail, ``0`` disables it.
+
+---@class HeapOwnerUsage:table Allocation churn of a heap owner, the freed bytes are not subtracted.
+---
+---@field bytes integer Total bytes allocated.
+---@field count integer Total number of allocations.
+
+---@class HeapUsage:table Heap usage.
+---
+---@field used integer Bytes in use.
+---@field peak integer Peak bytes in use.
+---@field softCrossings integer Number of times the heap crossed the soft limit.
+---@field failures integer Number of failed allocations.
+---@field owners table<string, HeapOwnerUsage> Usage of the heap owners, the bytes allocated by no owner are attributed to ``core``.
+
+---Set heap budget configuration.
+---@param config HeapConfig
+function core.setHeapConfig(config) end
+
+---Get heap usage.
+---@return HeapUsage usage
+---@nodiscard
+function core.getHeapUsage() end
+
+---Set the heap owner of the current coroutine.
+---
+---The coroutines and timers created later, and the callbacks of the accessories
+---created later by the current coroutine inherit the owner.
+---@param name? string Owner name, ``nil`` for the default owner ``core``.
+function core.setHeapOwner(name) end
+
 return core
@@ -41,6 +41,22 @@ function characteristic:setContraints(minVal, maxVal, stepVal) end
 ---@return HAPCharacteristic self
 function characteristic:setValidVals(...) end
 
+---Get the statistics of the value cache.
+---@return integer hits Number of reads served from the cache.
+---@return integer misses Number of reads passed to the read callback.
+---@nodiscard
+function characteristic:getCacheStats() end
+
+---Push the value of the characteristic.
+---
+---The value is stored in C, the following reads are served from it without calling the read callback,
+---and an event is raised if the value is changed. A successful write updates the pushed value.
+---The value is rejected with an error if it cannot be read in the format of the characteristic,
+---or it is out of the constraints, so set the constraints first.
+---@param value? any The value in the format of the characteristic, ``nil`` to go back to the read callback.
+---@return HAPCharacteristic self
+function characteristic:setValue(value) end
+
 ---Valid values ranges, is an array of length 2.
 ---Element 1 represents the ``start`` value.
 ---Element 2 represents the ``end`` value.
@@ -95,6 +111,51 @@ function characteristic:setValidValsRanges(...) end
 ---@field supportsAuthorizationData boolean The characteristic requires additional authorization data.
 ---@field ip HAPCharacteristicPropertiesIP
 ---@field ble HAPCharacteristicPropertiesBLE
+---@field cacheTTL integer Time to live in milliseconds of the cached value returned by the read callback, ``0`` or absent disables the cache. The cache is invalidated by writes and ``raiseEvent``.
+
+---@class HAPStartOptions:table Accessory server options.
+---
+---@field maxReads integer Maximum number of read callbacks in progress, default ``32``.
+---@field maxReadsPerAccessory integer Maximum number of read callbacks in progress per accessory, default ``4``.
+---@field maxQueuedReads integer Maximum number of queued read requests, default ``128``.
+---@field foregroundTimeout integer How long in milliseconds the controller stays in the foreground after a write, its read requests are dispatched first, default ``10000``.
+---@field eventWindow integer Coalescing window of events in milliseconds, the events raised in the window are sent together and the repeated events of the same characteristic are merged, default ``0`` (no coalescing).
+---@field ip HAPStartOptionsIP IP server storage options.
+
+---@class HAPStartOptionsIP:table IP server storage options, each session costs the sum of the buffer sizes plus the characteristic contexts.
+---
+---@field numSessions integer Maximum number of concurrent sessions (controller connections), default ``5``.
+---@field inboundBufferSize integer Size in bytes of the inbound buffer of a session, default ``1500``, at least ``1042``.
+---@field outboundBufferSize integer Size in bytes of the outbound buffer of a session, default ``1500``, at least ``1042``.
+---@field scratchBufferSize integer Size in bytes of the scratch buffer of a session, default ``1500``, at least ``1042``.
+
+---@class HAPIPStorageStats:table Memory in bytes used by the IP server storage.
+---
+---@field numSessions integer Maximum number of concurrent sessions.
+---@field sessions integer Memory used by the session structures.
+---@field buffers integer Memory used by the inbound, outbound and scratch buffers.
+---@field contexts integer Memory used by the characteristic contexts.
+---@field notifications integer Memory used by the event notification states.
+---@field total integer Total memory.
+
+---@class HAPReadStats:table Read scheduler statistics.
+---
+---@field reads integer Number of read callbacks in progress.
+---@field peakReads integer Peak number of read callbacks in progress.
+---@field queued integer Number of queued read requests.
+---@field peakQueued integer Peak number of queued read requests.
+---@field dispatched integer Number of queued read requests that have been dispatched.
+---@field coalesced integer Number of read requests served by a read callback already in progress.
+---@field rejected integer Number of read requests rejected because the queue is full.
+---@field totalWait integer Total time in milliseconds the dispatched requests spent in the queue.
+---@field maxWait integer Maximum time in milliseconds a dispatched request spent in the queue.
+
+---@class HAPDBStats:table Statistics of the characteristic index used by the event lookups.
+---
+---@field accessories integer Number of accessories.
+---@field services integer Number of services created by Lua.
+---@field characteristics integer Number of characteristics created by Lua.
+---@field indexSize integer Size in bytes of the attribute index.
 
 ---@class HAPCharacteristicPropertiesIP:table These properties only affect connections over IP (Ethernet / Wi-Fi).
 ---
@@ -329,6 +390,20 @@ M.HAPProtocolInformationService = {}
 ---@type HAPService
 M.PairingService = {}
 
+---@class HAPServiceTypeHandle:lightuserdata Service type handle.
+
+---@class HAPCharacteristicTypeHandle:lightuserdata Characteristic type handle.
+
+---Service type handles, indexed by the type name.
+---Passing a handle to ``hap.newService()`` avoids looking up the type name.
+---@type table<HAPServiceType, HAPServiceTypeHandle>
+M.ServiceType = {}
+
+---Characteristic type handles, indexed by the type name.
+---Passing a handle to ``hap.newCharacteristic()`` avoids looking up the type name.
+---@type table<HAPCharacteristicType, HAPCharacteristicTypeHandle>
+M.CharType = {}
+
 ---New a accessory.
 ---@param aid integer Accessory instance ID.
 ---@param category HAPAccessoryCategory Category information for the accessory.
@@ -340,12 +415,13 @@ M.PairingService = {}
 ---@param hardwareVersion string The hardware version of the accessory.
 ---@param services HAPService[] The services of the accessory.
 ---@param identify? async fun(request: HAPAccessoryIdentifyRequest) The callback used to invoke the identify routine.
+---@param readBatch? async fun(requests: HAPCharacteristicReadRequest[]): any[]? The callback used to handle the read requests of the accessory received in one transaction, it returns values in the order of the requests, the requests with ``nil`` value are passed to the read callbacks of the characteristics.
 ---@return HAPAccessory
-function M.newAccessory(aid, category, name, manufacturer, model, serialNumber, firmwareVersion, hardwareVersion, services, identify) end
+function M.newAccessory(aid, category, name, manufacturer, model, serialNumber, firmwareVersion, hardwareVersion, services, identify, readBatch) end
 
 ---New a service.
 ---@param iid integer Instance ID.
----@param type HAPServiceType The type of the service.
+---@param type HAPServiceType|HAPServiceTypeHandle The type of the service.
 ---@param primary boolean The service is the primary service on the accessory.
 ---@param hidden boolean The service should be hidden from the user.
 ---@param characteristics HAPCharacteristic[] The characteristics of the service.
@@ -355,7 +431,7 @@ function M.newService(iid, type, primary, hidden, characteristics) end
 ---New a characteristic.
 ---@param iid integer Instance ID.
 ---@param format HAPCharacteristicFormat Characteristic format.
----@param type HAPCharacteristicType The type of the characteristic.
+---@param type HAPCharacteristicType|HAPCharacteristicTypeHandle The type of the characteristic.
 ---@param props HAPCharacteristicProperties Characteristic properties.
 ---@param read? async fun(request: HAPCharacteristicReadRequest): any The callback used to handle read requests, it returns value.
 ---@param write? async fun(request: HAPCharacteristicWriteRequest, value: any) The callback used to handle write requests.
@@ -375,7 +451,8 @@ function M.accessoryIsValid(accessory, bridged) end
 ---@param confChanged boolean Whether or not the bridge configuration changed since the last start.
 ---@param sessionAccept? async fun(session: HAPSession) The callback used when a HomeKit Session is accepted.
 ---@param sessionInvalidate? async fun(session: HAPSession) The callback used when a HomeKit Session is invalidated.
-function M.start(primaryAccessory, bridgedAccessories, confChanged, sessionAccept, sessionInvalidate) end
+---@param options? HAPStartOptions Accessory server options.
+function M.start(primaryAccessory, bridgedAccessories, confChanged, sessionAccept, sessionInvalidate, options) end
 
 ---Stop accessory server.
 function M.stop() end
@@ -389,6 +466,30 @@ function M.stop() end
 ---@param session? HAPSession The session on which to raise the event.
 function M.raiseEvent(aid, sid, cid, session) end
 
+---Get the statistics of the read scheduler.
+---@return HAPReadStats
+---@nodiscard
+function M.getReadStats() end
+
+---Get the memory used by the IP server storage.
+---@return HAPIPStorageStats
+---@nodiscard
+function M.getIPStorageStats() end
+
+---Get the statistics of the characteristic index built at start.
+---
+---The index is not a snapshot of the ``/accessories`` document,
+---the document is still serialized by the ADK for each request.
+---@return HAPDBStats
+---@nodiscard
+function M.getDBStats() end
+
+---Raises event notifications for a list of characteristics.
+---The events are sent in one message per session, and the repeated events of the same characteristic are merged.
+---@param events integer[][] List of ``{aid, sid, cid}``.
+---@param session? HAPSession The session on which to raise the events.
+function M.raiseEvents(events, session) end
+
 ---Get a new Instance ID for bridged accessory or service or characteristic.
 ---@param bridgedAccessory? boolean Whether or not to get new IID for bridged accessory.
 ---@return integer iid Instance ID.
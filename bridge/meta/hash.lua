@@ -39,4 +39,15 @@ function hash:hexdigest() end
 ---@nodiscard
 function M.create(type, key) end
 
+---Return the digest of the data in one call.
+---
+---It reuses a cached hash context, which is cheaper than ``create()``
+---for one-shot digests.
+---@param type HashType
+---@param data string
+---@param key? string If key is set, HMAC will be used.
+---@return string digest
+---@nodiscard
+function M.digest(type, data, key) end
+
 return M
@@ -0,0 +1,31 @@
+---@meta
+
+---@class miiolib miIO binary protocol library.
+local M = {}
+
+---@class MiioCodec:userdata miIO codec, packs and encrypts the packets of a device.
+local codec = {}
+
+---Encrypt the data and pack it to a binary package.
+---@param devid integer Device ID: 32-bit.
+---@param stamp integer Stamp: 32 bit unsigned int.
+---@param data string The data to encrypt, usually a JSON string.
+---@return string package
+---@nodiscard
+function codec:encode(devid, stamp, data) end
+
+---Verify the checksum of a binary package and decrypt the data.
+---@param package string A binary package.
+---@return integer devid Device ID.
+---@return integer stamp Stamp.
+---@return string|nil data The decrypted data, ``nil`` if the package has no data.
+---@nodiscard
+function codec:decode(package) end
+
+---Create a codec.
+---@param token string Device token: 128-bit.
+---@return MiioCodec codec
+---@nodiscard
+function M.create(token) end
+
+return M
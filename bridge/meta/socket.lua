@@ -66,6 +66,21 @@ function socket:recv(maxlen) end
 ---@nodiscard
 function socket:recvfrom(maxlen) end
 
+---@class SocketMessage:table A received message.
+---
+---@field data string The received message.
+---@field addr string The remote address.
+---@field port integer The remote port.
+
+---Receive multiple messages from a UDP socket at once.
+---
+---Wait for the first message, then receive all the queued messages without waiting.
+---@param maxcount integer The max number of the messages, up to 64.
+---@param maxlen integer The max length of each message.
+---@return SocketMessage[] msgs The received messages.
+---@nodiscard
+function socket:recvmany(maxcount, maxlen) end
+
 --Whether the socket is readable.
 ---@return boolean
 function socket:readable() end
@@ -11,7 +11,7 @@ return {
     ---@param read fun(request: HAPCharacteristicReadRequest): integer
     ---@return HAPCharacteristic characteristic
     new = function (iid, read)
-        return hap.newCharacteristic(iid, "UInt8", "CurrentFanState", {
+        return hap.newCharacteristic(iid, "UInt8", hap.CharType.CurrentFanState, {
             readable = true,
             writable = false,
             supportsEventNotification = true
@@ -12,7 +12,7 @@ return {
     ---@param read fun(request: HAPCharacteristicReadRequest): integer
     ---@return HAPCharacteristic characteristic
     new = function (iid, read)
-        return hap.newCharacteristic(iid, "UInt8", "CurrentHumidifierDehumidifierState", {
+        return hap.newCharacteristic(iid, "UInt8", hap.CharType.CurrentHumidifierDehumidifierState, {
             readable = true,
             writable = false,
             supportsEventNotification = true
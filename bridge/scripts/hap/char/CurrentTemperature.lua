@@ -6,7 +6,7 @@ return {
     ---@param read fun(request: HAPCharacteristicReadRequest): number
     ---@return HAPCharacteristic characteristic
     new = function (iid, read)
-        return hap.newCharacteristic(iid, "Float", "CurrentTemperature", {
+        return hap.newCharacteristic(iid, "Float", hap.CharType.CurrentTemperature, {
             readable = true,
             writable = false,
             supportsEventNotification = true
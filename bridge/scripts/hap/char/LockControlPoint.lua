@@ -6,7 +6,7 @@ return {
     ---@param write fun(request: HAPCharacteristicWriteRequest, value: string)
     ---@return HAPCharacteristic characteristic
     new = function (iid, write)
-        return hap.newCharacteristic(iid, "TLV8", "LockControlPoint", {
+        return hap.newCharacteristic(iid, "TLV8", hap.CharType.LockControlPoint, {
             readable = false,
             writable = true,
             supportsEventNotification = false,
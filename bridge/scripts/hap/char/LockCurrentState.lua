@@ -12,7 +12,7 @@ return {
     ---@param read fun(request: HAPCharacteristicReadRequest): integer
     ---@return HAPCharacteristic characteristic
     new = function (iid, read)
-        return hap.newCharacteristic(iid, "UInt8", "LockCurrentState", {
+        return hap.newCharacteristic(iid, "UInt8", hap.CharType.LockCurrentState, {
             readable = true,
             writable = false,
             supportsEventNotification = true
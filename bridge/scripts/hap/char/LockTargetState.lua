@@ -11,7 +11,7 @@ return {
     ---@param write fun(request: HAPCharacteristicWriteRequest, value: integer)
     ---@return HAPCharacteristic characteristic
     new = function (iid, read, write)
-        return hap.newCharacteristic(iid, "UInt8", "LockTargetState", {
+        return hap.newCharacteristic(iid, "UInt8", hap.CharType.LockTargetState, {
             readable = true,
             writable = true,
             supportsEventNotification = true,
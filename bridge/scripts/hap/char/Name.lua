@@ -6,7 +6,7 @@ return {
     ---@param name string Service name.
     ---@return HAPCharacteristic characteristic
     new = function (iid, name)
-        return hap.newCharacteristic(iid, "String", "Name", {
+        return hap.newCharacteristic(iid, "String", hap.CharType.Name, {
             readable = true,
             writable = false,
             supportsEventNotification = false
@@ -7,7 +7,7 @@ return {
     ---@param write fun(request: HAPCharacteristicWriteRequest, value: boolean)
     ---@return HAPCharacteristic characteristic
     new = function (iid, read, write)
-        return hap.newCharacteristic(iid, "Bool", "On", {
+        return hap.newCharacteristic(iid, "Bool", hap.CharType.On, {
             readable = true,
             writable = true,
             supportsEventNotification = true
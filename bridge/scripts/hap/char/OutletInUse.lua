@@ -6,7 +6,7 @@ return {
     ---@param read fun(request: HAPCharacteristicReadRequest): boolean
     ---@return HAPCharacteristic characteristic
     new = function (iid, read)
-        return hap.newCharacteristic(iid, "Bool", "OutletInUse", {
+        return hap.newCharacteristic(iid, "Bool", hap.CharType.OutletInUse, {
             readable = true,
             writable = false,
             supportsEventNotification = true
@@ -7,7 +7,7 @@ return {
     ---@param write fun(request: HAPCharacteristicWriteRequest, value: number)
     ---@return HAPCharacteristic characteristic
     new = function (iid, read, write)
-        return hap.newCharacteristic(iid, "Float", "RelativeHumidityHumidifierThreshold", {
+        return hap.newCharacteristic(iid, "Float", hap.CharType.RelativeHumidityHumidifierThreshold, {
             readable = true,
             writable = true,
             supportsEventNotification = true
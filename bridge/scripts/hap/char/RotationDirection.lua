@@ -11,7 +11,7 @@ return {
     ---@param write fun(request: HAPCharacteristicWriteRequest, value: integer)
     ---@return HAPCharacteristic characteristic
     new = function (iid, read, write)
-        return hap.newCharacteristic(iid, "Int", "RotationDirection", {
+        return hap.newCharacteristic(iid, "Int", hap.CharType.RotationDirection, {
             readable = true,
             writable = true,
             supportsEventNotification = true
@@ -5,7 +5,7 @@ return {
     ---@param iid integer Instance ID.
     ---@return HAPCharacteristic characteristic
     new = function (iid)
-        return hap.newCharacteristic(iid, "Data", "ServiceSignature", {
+        return hap.newCharacteristic(iid, "Data", hap.CharType.ServiceSignature, {
             readable = true,
             writable = false,
             supportsEventNotification = false,
@@ -12,7 +12,7 @@ return {
     ---@param write? fun(request: HAPCharacteristicWriteRequest, value: integer)
     ---@return HAPCharacteristic characteristic
     new = function (iid, read, write)
-        return hap.newCharacteristic(iid, "UInt8", "TargetHumidifierDehumidifierState", {
+        return hap.newCharacteristic(iid, "UInt8", hap.CharType.TargetHumidifierDehumidifierState, {
             readable = true,
             writable = write and true or false,
             supportsEventNotification = true
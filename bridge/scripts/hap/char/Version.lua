@@ -6,7 +6,7 @@ return {
     ---@param read fun(request:HAPCharacteristicReadRequest): string
     ---@return HAPCharacteristic characteristic
     new = function (iid, read)
-        return hap.newCharacteristic(iid, "String", "Version", {
+        return hap.newCharacteristic(iid, "String", hap.CharType.Version, {
             readable = true,
             writable = false,
             supportsEventNotification = false,
@@ -6,6 +6,9 @@ local M = {}
 
 local logger = log.getLogger("hap.plugins")
 
+---Default max number of plugins initialized at the same time.
+local parallelismDft = 8
+
 ---@class Plugin:table Plugin.
 ---
 ---@field init fun() Initialize plugin and generate accessories in initialization.
@@ -39,27 +42,50 @@ local function loadPlugin(name)
         end
     end
     logger:info(("Plugin '%s' initializing ..."):format(name))
+    local start = core.time()
     local accessories = plugin.init()
-    logger:info(("Plugin '%s' initialized."):format(name))
+    logger:info(("Plugin '%s' initialized in %d ms."):format(name, core.time() - start))
     priv.plugins[name] = plugin
     return accessories
 end
 
+---Get the max number of plugins initialized at the same time.
+---@return integer parallelism
+---@nodiscard
+local function getParallelism()
+    local parallelism = math.tointeger(tonumber(config.get("bridge.parallelism")))
+    if parallelism == nil or parallelism < 1 then
+        return parallelismDft
+    end
+    return parallelism
+end
+
 ---Load plugins and generate bridged accessories.
+---
+---The plugins are initialized concurrently, see ``getParallelism()``.
 ---@return HAPAccessory[] bridgedAccessories # Bridges Accessories.
 function M.init()
     local names = config.getall("bridge.plugins")
     local accessories = {}
     if names then
-        for _, name in ipairs(names) do
+        local start = core.time()
+        local results = util.parallel(names, getParallelism(), function (name)
+            -- The bytes allocated by the plugin and its callbacks are attributed to it.
+            core.setHeapOwner(name)
             local success, result = xpcall(loadPlugin, traceback, name)
+            core.setHeapOwner()
             if success == false then
                 logger:error(result)
+                return {}
             end
-            for _, accessory in ipairs(result) do
+            return result
+        end)
+        for _, result in ipairs(results) do
+            for _, accessory in ipairs(result[2]) do
                 table.insert(accessories, accessory)
             end
         end
+        logger:info(("%d plugins initialized in %d ms."):format(#names, core.time() - start))
         local loaded = package.loaded
         for name, _ in pairs(loaded) do
             loaded[name] = nil
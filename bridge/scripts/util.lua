@@ -22,6 +22,37 @@ function M.searchKey(t, v)
     return nil
 end
 
+---Call ``fn`` on each item in concurrent tasks.
+---
+---At most ``limit`` calls are in progress at the same time.
+---An error raised by a call does not stop the others, it is returned
+---in the result of the item.
+---@param items any[] Items.
+---@param limit integer Max number of concurrent calls.
+---@param fn async fun(item: any, i: integer): any Function to call.
+---@return table[] results ``{ success, result }`` of each item, the result is the error with the traceback on failure.
+function M.parallel(items, limit, fn)
+    local results = {}
+    local n = #items
+    local nextIndex = 1
+    local function worker()
+        while nextIndex <= n do
+            local i = nextIndex
+            nextIndex = nextIndex + 1
+            results[i] = { xpcall(fn, debug.traceback, items[i], i) }
+        end
+    end
+
+    local tasks = {}
+    for i = 1, math.min(limit, n), 1 do
+        tasks[i] = core.spawn(worker)
+    end
+    for _, task in ipairs(tasks) do
+        task:join()
+    end
+    return results
+end
+
 ---Split a string.
 ---@param s string
 ---@param c string
@@ -8,8 +8,8 @@
 #include <lauxlib.h>
 #include <lualib.h>
 #include <embedfs.h>
-#include <pal/mem.h>
 #include <pal/err.h>
+#include <pal/mem.h>
 #include <app.h>
 
 #include "app_int.h"
@@ -66,6 +66,7 @@ static const luaL_Reg dynamiclibs[] = {
     {LUA_BASE64_NAME, luaopen_base64},
     {LUA_ARC4_NAME, luaopen_arc4},
     {LUA_NETIF_NAME, luaopen_netif},
+    {LUA_MIIO_NAME, luaopen_miio},
     {NULL, NULL}
 };
 
@@ -163,16 +164,6 @@ static int searcher_json(lua_State *L) {
     return 1;
 }
 
-static void *app_lua_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
-    (void)ud; (void)osize; /* not used */
-    if (nsize == 0) {
-        pal_mem_free(ptr);
-        return NULL;
-    } else {
-        return pal_mem_realloc(ptr, nsize);
-    }
-}
-
 // app_pinit(dir: lightuserdata)
 static int app_pinit(lua_State *L) {
     const char *dir = lua_touserdata(L, 1);
@@ -185,8 +176,8 @@ static int app_pinit(lua_State *L) {
         lua_pop(L, 1);  /* remove lib */
     }
 
-    // GC in generational mode
-    lua_gc(L, LUA_GCGEN, 0, 0);
+    // GC policy engine, in generational mode by default
+    lc_initgc(L);
 
     // package.path = "${dir}/?.lua;${dir}/?.luac"
     lua_getglobal(L, "package");
@@ -243,12 +234,13 @@ static int panic(lua_State *L) {
 void app_init(const char *dir) {
     HAPPrecondition(dir);
 
-    L = lua_newstate(app_lua_alloc, NULL);
+    L = lua_newstate(lc_alloc, NULL);
     if (luai_unlikely(!L)) {
         HAPLogError(&kHAPLog_Default,
             "%s: Cannot create state: not enough memory", __func__);
         HAPFatalError();
     }
+    lc_setheapowner(L, 0);
 
     lua_atpanic(L, &panic);
 
@@ -270,8 +262,10 @@ void app_init(const char *dir) {
 
 void app_deinit() {
     if (L) {
+        lc_deinitgc();
         lua_close(L);
         L = NULL;
+        pal_mem_heap_trim();
     }
 }
 
@@ -58,6 +58,9 @@ LUAMOD_API int luaopen_arc4(lua_State *L);
 #define LUA_NETIF_NAME "netif"
 LUAMOD_API int luaopen_netif(lua_State *L);
 
+#define LUA_MIIO_NAME "miio"
+LUAMOD_API int luaopen_miio(lua_State *L);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,43 +7,180 @@
 #include <string.h>
 #include <lauxlib.h>
 
+#include <HAPPlatformTimer.h>
+#include <pal/mem.h>
+
 #include "app_int.h"
 #include "lc.h"
 
-#define THREAD_POOL_SIZE 8
+// Delay of the next idle slice when the cycle is not finished.
+#define LC_GC_IDLE_SLICE_DELAY 10
+
+// Time budget of the emergency collection.
+#define LC_GC_EMERGENCY_BUDGET 20
 
 static const HAPLogObject lc_log = {
     .subsystem = APP_BRIDGE_LOG_SUBSYSTEM,
     .category = "lc",
 };
 
+/**
+ * Heap budget.
+ *
+ * The owner of a coroutine is stored in the extra space of the coroutine,
+ * and the owner of the running coroutine is kept in "owner".
+ */
+static struct {
+    lc_heap_config config;
+    lc_heap_stats stats;
+    bool soft_armed;            /* the heap is below the soft limit */
+    bool emergency;             /* an emergency collection is pending */
+    int owner;                  /* owner of the running coroutine */
+    size_t num_owners;
+    lc_heap_owner owners[LC_HEAP_OWNERS_MAX];
+} gv_lc_heap = {
+    .soft_armed = true,
+    .num_owners = 1,
+    .owners = {
+        { .name = "core" },
+    },
+};
+
+/**
+ * Pool of the coroutines.
+ *
+ * Every coroutine is anchored in the registry, and the key is the pointer of the coroutine.
+ * The idle coroutines are kept in an array in the registry, and the key is the pointer of the pool,
+ * the last freed one is reused first.
+ */
+static struct {
+    lc_thread_pool_config config;
+    lc_thread_pool_stats stats;
+    size_t low_idle;            /* lowest number of idle coroutines since the last trim */
+    HAPTime last_trim;          /* time of the last trim */
+} gv_lc_thread_pool = {
+    .config = {
+        .max_idle = 32,
+        .trim_interval = 10000,
+    },
+};
+
 static struct {
-    size_t head, tail;
-    lua_State *pool[THREAD_POOL_SIZE + 1];
-} thread_pool;
+    lua_State *L;
+    lc_gc_config config;
+    lc_gc_stats stats;
+    HAPTime last_tick;          /* time of the last tick */
+    HAPPlatformTimerRef idle_timer;
+} gv_lc_gc = {
+    .config = {
+        .mode = LC_GC_MODE_GEN,
+        .step_size = 0,
+        .tick_budget = 1,
+        .idle_delay = 1000,
+        .idle_budget = 5,
+        .pressure = 0,
+    },
+};
+
+void *lc_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    (void)ud; /* not used */
+    lc_heap_stats *stats = &gv_lc_heap.stats;
+
+    if (!ptr) {
+        osize = 0;  // osize is the type of the object
+    }
+    if (nsize > osize && gv_lc_heap.config.hard_limit &&
+        stats->used + (nsize - osize) > gv_lc_heap.config.hard_limit * 1024) {
+        // Lua runs a full collection and retries before raising a memory error.
+        stats->failures++;
+        return NULL;
+    }
+
+    void *nptr = pal_mem_heap_realloc(ptr, osize, nsize);
+    if (nsize == 0) {
+        stats->used -= osize;
+    } else if (nptr) {
+        stats->used = stats->used - osize + nsize;
+        if (stats->used > stats->peak) {
+            stats->peak = stats->used;
+        }
+        if (nsize > osize) {
+            lc_heap_owner *owner = &gv_lc_heap.owners[gv_lc_heap.owner];
+            owner->bytes += nsize - osize;
+            owner->count++;
+        }
+    } else {
+        stats->failures++;
+        return NULL;
+    }
 
-static inline size_t thread_pool_size() {
-    return (HAPArrayCount(thread_pool.pool) + thread_pool.tail - thread_pool.head)
-        % HAPArrayCount(thread_pool.pool);
+    // The collection can not run in the allocator, it is run at the next tick.
+    if (gv_lc_heap.config.soft_limit) {
+        if (stats->used > gv_lc_heap.config.soft_limit * 1024) {
+            if (gv_lc_heap.soft_armed) {
+                gv_lc_heap.soft_armed = false;
+                gv_lc_heap.emergency = true;
+                stats->soft_crossings++;
+            }
+        } else {
+            gv_lc_heap.soft_armed = true;
+        }
+    }
+    return nptr;
 }
 
-static inline bool thread_pool_full() {
-    return thread_pool_size() == THREAD_POOL_SIZE;
+void lc_setheapconfig(const lc_heap_config *config) {
+    HAPPrecondition(config);
+
+    gv_lc_heap.config = *config;
+    gv_lc_heap.soft_armed = true;
 }
 
-static inline bool thread_pool_empty() {
-    return thread_pool.head == thread_pool.tail;
+const lc_heap_config *lc_getheapconfig(void) {
+    return &gv_lc_heap.config;
 }
 
-static lua_State *thread_pool_deque() {
-    lua_State *L = thread_pool.pool[thread_pool.head];
-    thread_pool.head = (thread_pool.head + 1) % HAPArrayCount(thread_pool.pool);
-    return L;
+const lc_heap_stats *lc_getheapstats(void) {
+    return &gv_lc_heap.stats;
 }
 
-static void thread_pool_enque(lua_State *L) {
-    thread_pool.pool[thread_pool.tail] = L;
-    thread_pool.tail = (thread_pool.tail + 1) % HAPArrayCount(thread_pool.pool);
+const lc_heap_owner *lc_getheapowners(size_t *count) {
+    HAPPrecondition(count);
+    *count = gv_lc_heap.num_owners;
+    return gv_lc_heap.owners;
+}
+
+int lc_heapowner(const char *name) {
+    HAPPrecondition(name);
+
+    for (size_t i = 0; i < gv_lc_heap.num_owners; i++) {
+        if (!strcmp(gv_lc_heap.owners[i].name, name)) {
+            return i;
+        }
+    }
+    if (gv_lc_heap.num_owners == LC_HEAP_OWNERS_MAX) {
+        HAPLogError(&lc_log, "%s: Too many heap owners, '%s' is attributed to '%s'.",
+            __func__, name, gv_lc_heap.owners[0].name);
+        return 0;
+    }
+    lc_heap_owner *owner = &gv_lc_heap.owners[gv_lc_heap.num_owners];
+    HAPRawBufferZero(owner, sizeof(*owner));
+    strncpy(owner->name, name, sizeof(owner->name) - 1);
+    return gv_lc_heap.num_owners++;
+}
+
+int lc_getheapowner(lua_State *L) {
+    return *(int *)lua_getextraspace(L);
+}
+
+void lc_setheapowner(lua_State *L, int owner) {
+    HAPPrecondition(owner >= 0 && (size_t)owner < gv_lc_heap.num_owners);
+    *(int *)lua_getextraspace(L) = owner;
+}
+
+void lc_setrunningheapowner(lua_State *L, int owner) {
+    lc_setheapowner(L, owner);
+    gv_lc_heap.owner = owner;
 }
 
 static const lc_table_kv *
@@ -165,8 +302,170 @@ lua_State *lc_getmainthread(lua_State *L) {
     return mL;
 }
 
-void lc_collectgarbage(lua_State *L) {
+static void lc_gc_idle_timer_cb(HAPPlatformTimerRef timer, void *context);
+
+static void lc_gc_idle_timer_start(HAPTime deadline) {
+    if (HAPPlatformTimerRegister(&gv_lc_gc.idle_timer, deadline,
+        lc_gc_idle_timer_cb, NULL) != kHAPError_None) {
+        HAPLogError(&lc_log, "%s: Failed to start the idle timer.", __func__);
+        gv_lc_gc.idle_timer = 0;
+    }
+}
+
+static void lc_gc_idle_timer_stop(void) {
+    if (gv_lc_gc.idle_timer) {
+        HAPPlatformTimerDeregister(gv_lc_gc.idle_timer);
+        gv_lc_gc.idle_timer = 0;
+    }
+}
+
+/**
+ * Recompute the pressure threshold from the configuration and the live data.
+ *
+ * The threshold follows the live data after each cycle, it falls back to
+ * the configured one once a peak is collected.
+ */
+static void lc_gc_update_pressure(lua_State *L) {
+    if (!gv_lc_gc.config.pressure) {
+        return;
+    }
+    // Keep the threshold above the live data,
+    // otherwise every tick would run a full collection.
+    size_t live = lua_gc(L, LUA_GCCOUNT);
+    gv_lc_gc.stats.pressure = HAPMax(gv_lc_gc.config.pressure, live + live / 2);
+}
+
+/**
+ * Run GC steps until the cycle is finished or the budget is exhausted.
+ *
+ * @returns true if the cycle is finished.
+ */
+static bool lc_gc_step(lua_State *L, lc_gc_policy policy, HAPTime budget) {
+    HAPTime start = HAPPlatformClockGetCurrent();
+    HAPTime now;
+    bool done;
+    size_t steps = 0;
+
+    do {
+        // In generational mode, a step is a whole (young) collection.
+        done = lua_gc(L, LUA_GCSTEP, (int)gv_lc_gc.config.step_size) ||
+            gv_lc_gc.config.mode == LC_GC_MODE_GEN;
+        steps++;
+        now = HAPPlatformClockGetCurrent();
+    } while (!done && now - start < budget);
+
+    gv_lc_gc.stats.policies[policy].count++;
+    gv_lc_gc.stats.policies[policy].steps += steps;
+    gv_lc_gc.stats.policies[policy].time += now - start;
+    if (done) {
+        gv_lc_gc.stats.cycles++;
+        lc_gc_update_pressure(L);
+    }
+    return done;
+}
+
+static void lc_gc_full(lua_State *L) {
+    HAPTime start = HAPPlatformClockGetCurrent();
     lua_gc(L, LUA_GCCOLLECT);
+    gv_lc_gc.stats.policies[LC_GC_POLICY_FULL].count++;
+    gv_lc_gc.stats.policies[LC_GC_POLICY_FULL].steps++;
+    gv_lc_gc.stats.policies[LC_GC_POLICY_FULL].time += HAPPlatformClockGetCurrent() - start;
+    gv_lc_gc.stats.cycles++;
+    lc_gc_update_pressure(L);
+}
+
+static void lc_gc_idle_timer_cb(HAPPlatformTimerRef timer, void *context) {
+    gv_lc_gc.idle_timer = 0;
+
+    lua_State *L = gv_lc_gc.L;
+    HAPAssert(L);
+
+    // The run loop was busy, wait for another idle period.
+    HAPTime now = HAPPlatformClockGetCurrent();
+    HAPTime deadline = gv_lc_gc.last_tick + gv_lc_gc.config.idle_delay;
+    if (deadline > now) {
+        lc_gc_idle_timer_start(deadline);
+        return;
+    }
+
+    if (!lc_gc_step(L, LC_GC_POLICY_IDLE, gv_lc_gc.config.idle_budget)) {
+        // Yield to the run loop and continue the cycle later.
+        lc_gc_idle_timer_start(now + LC_GC_IDLE_SLICE_DELAY);
+    }
+}
+
+void lc_initgc(lua_State *L) {
+    gv_lc_gc.L = lc_getmainthread(L);
+    lc_setgcconfig(L, &gv_lc_gc.config);
+}
+
+void lc_deinitgc(void) {
+    lc_gc_idle_timer_stop();
+    gv_lc_gc.L = NULL;
+}
+
+void lc_setgcconfig(lua_State *L, const lc_gc_config *config) {
+    HAPPrecondition(config);
+
+    gv_lc_gc.config = *config;
+    gv_lc_gc.stats.pressure = config->pressure;
+    switch (config->mode) {
+    case LC_GC_MODE_INC:
+        lua_gc(L, LUA_GCINC, 0, 0, 0);
+        break;
+    case LC_GC_MODE_GEN:
+        lua_gc(L, LUA_GCGEN, 0, 0);
+        break;
+    default:
+        HAPFatalError();
+    }
+    lc_gc_idle_timer_stop();
+}
+
+const lc_gc_config *lc_getgcconfig(void) {
+    return &gv_lc_gc.config;
+}
+
+const lc_gc_stats *lc_getgcstats(void) {
+    return &gv_lc_gc.stats;
+}
+
+/**
+ * Collect garbage after the heap crosses the soft limit.
+ */
+static void lc_gc_emergency(lua_State *L) {
+    if (gv_lc_gc.config.mode == LC_GC_MODE_INC) {
+        lc_gc_step(L, LC_GC_POLICY_EMERGENCY, LC_GC_EMERGENCY_BUDGET);
+        return;
+    }
+
+    // In generational mode, a step is only a young collection.
+    HAPTime start = HAPPlatformClockGetCurrent();
+    lua_gc(L, LUA_GCCOLLECT);
+    gv_lc_gc.stats.policies[LC_GC_POLICY_EMERGENCY].count++;
+    gv_lc_gc.stats.policies[LC_GC_POLICY_EMERGENCY].steps++;
+    gv_lc_gc.stats.policies[LC_GC_POLICY_EMERGENCY].time += HAPPlatformClockGetCurrent() - start;
+    gv_lc_gc.stats.cycles++;
+    lc_gc_update_pressure(L);
+}
+
+static void lc_thread_pool_tick(lua_State *L, HAPTime now);
+
+void lc_collectgarbage(lua_State *L) {
+    if (gv_lc_heap.emergency) {
+        gv_lc_heap.emergency = false;
+        lc_gc_emergency(L);
+    } else if (gv_lc_gc.stats.pressure && (size_t)lua_gc(L, LUA_GCCOUNT) >= gv_lc_gc.stats.pressure) {
+        lc_gc_full(L);
+    } else {
+        lc_gc_step(L, LC_GC_POLICY_TICK, gv_lc_gc.config.tick_budget);
+    }
+
+    gv_lc_gc.last_tick = HAPPlatformClockGetCurrent();
+    if (gv_lc_gc.L && gv_lc_gc.config.idle_delay && !gv_lc_gc.idle_timer) {
+        lc_gc_idle_timer_start(gv_lc_gc.last_tick + gv_lc_gc.config.idle_delay);
+    }
+    lc_thread_pool_tick(L, gv_lc_gc.last_tick);
 }
 
 static int traceback(lua_State *L) {
@@ -183,24 +482,116 @@ void lc_pushtraceback(lua_State *L) {
     lua_pushcfunction(L, traceback);
 }
 
-lua_State *lc_newthread(lua_State *L) {
-    if (!thread_pool_empty()) {
-        return thread_pool_deque();
+/**
+ * Push the array of the idle coroutines onto the stack.
+ */
+static void lc_thread_pool_push(lua_State *L) {
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &gv_lc_thread_pool) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_createtable(L, gv_lc_thread_pool.config.max_idle, 0);
+        lua_pushvalue(L, -1);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &gv_lc_thread_pool);
     }
-    lua_State *co = lua_newthread(L);
-    lua_pushthread(co);
-    lua_rawsetp(co, LUA_REGISTRYINDEX, co);
-    return co;
 }
 
-static void lc_freethread(lua_State *L, lua_State *from) {
-    if (thread_pool_full()) {
+/**
+ * Release the idle coroutines until the number of idle coroutines is not greater than max.
+ */
+static void lc_thread_pool_trim(lua_State *L, size_t max) {
+    lc_thread_pool_stats *stats = &gv_lc_thread_pool.stats;
+    if (stats->idle <= max) {
+        return;
+    }
+    lc_thread_pool_push(L);
+    for (; stats->idle > max; stats->idle--) {
+        lua_rawgeti(L, -1, stats->idle);
+        lua_pushnil(L);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, lua_tothread(L, -2));
+        lua_pop(L, 1);
         lua_pushnil(L);
-        lua_rawsetp(L, LUA_REGISTRYINDEX, L);
+        lua_rawseti(L, -2, stats->idle);
+        stats->trims++;
+    }
+    lua_pop(L, 1);
+    if (gv_lc_thread_pool.low_idle > stats->idle) {
+        gv_lc_thread_pool.low_idle = stats->idle;
+    }
+}
+
+/**
+ * Release the coroutines which stay idle during the whole trim interval.
+ */
+static void lc_thread_pool_tick(lua_State *L, HAPTime now) {
+    if (!gv_lc_thread_pool.config.trim_interval ||
+        now - gv_lc_thread_pool.last_trim < gv_lc_thread_pool.config.trim_interval) {
+        return;
+    }
+    lc_thread_pool_stats *stats = &gv_lc_thread_pool.stats;
+    lc_thread_pool_trim(L, stats->idle - gv_lc_thread_pool.low_idle);
+    gv_lc_thread_pool.low_idle = stats->idle;
+    gv_lc_thread_pool.last_trim = now;
+}
+
+void lc_setthreadpoolconfig(lua_State *L, const lc_thread_pool_config *config) {
+    HAPPrecondition(config);
+
+    gv_lc_thread_pool.config = *config;
+    lc_thread_pool_trim(L, config->max_idle);
+}
+
+const lc_thread_pool_config *lc_getthreadpoolconfig(void) {
+    return &gv_lc_thread_pool.config;
+}
+
+const lc_thread_pool_stats *lc_getthreadpoolstats(void) {
+    return &gv_lc_thread_pool.stats;
+}
+
+lua_State *lc_newthread(lua_State *L) {
+    lc_thread_pool_stats *stats = &gv_lc_thread_pool.stats;
+    lua_State *co;
+
+    if (stats->idle) {
+        lc_thread_pool_push(L);
+        lua_rawgeti(L, -1, stats->idle);
+        co = lua_tothread(L, -1);
+        lua_pushnil(L);
+        lua_rawseti(L, -3, stats->idle);
+        lua_pop(L, 2);
+        stats->idle--;
+        stats->reuses++;
+        if (gv_lc_thread_pool.low_idle > stats->idle) {
+            gv_lc_thread_pool.low_idle = stats->idle;
+        }
     } else {
-        thread_pool_enque(L);
+        co = lua_newthread(L);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, co);
+        stats->creates++;
     }
+    stats->active++;
+    if (stats->active > stats->peak_active) {
+        stats->peak_active = stats->active;
+    }
+    lc_setheapowner(co, gv_lc_heap.owner);
+    return co;
+}
+
+static void lc_freethread(lua_State *L, lua_State *from) {
+    lc_thread_pool_stats *stats = &gv_lc_thread_pool.stats;
+
+    // Resetting the coroutine also shrinks its stack to the minimum size.
     lua_closethread(L, from);
+    stats->active--;
+    if (stats->idle >= gv_lc_thread_pool.config.max_idle) {
+        lua_pushnil(from);
+        lua_rawsetp(from, LUA_REGISTRYINDEX, L);
+        return;
+    }
+    lc_thread_pool_push(from);
+    lua_pushthread(L);
+    lua_xmove(L, from, 1);
+    lua_rawseti(from, -2, ++stats->idle);
+    lua_pop(from, 1);
 }
 
 int lc_resume(lua_State *L, lua_State *from, int narg, int *nres) {
@@ -209,7 +600,10 @@ int lc_resume(lua_State *L, lua_State *from, int narg, int *nres) {
         luaL_error(L, "invalid coroutine status");
     }
 
+    int owner = gv_lc_heap.owner;
+    gv_lc_heap.owner = lc_getheapowner(L);
     int status = lua_resume(L, from, narg, nres);
+    gv_lc_heap.owner = owner;
     switch (status) {
     case LUA_OK:
         if (luai_unlikely(!lua_checkstack(L, *nres))) {
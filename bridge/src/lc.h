@@ -12,6 +12,7 @@ extern "C" {
 #endif
 
 #include <lua.h>
+#include <HAPBase.h>
 
 #define LC_TNONE            0                           // none
 #define LC_TNIL             (1 << LUA_TNIL)             // nil
@@ -66,8 +67,81 @@ bool lc_traverse_array(lua_State *L, int idx,
  */
 lua_State *lc_getmainthread(lua_State *L);
 
+/**
+ * GC mode.
+ */
+typedef enum {
+    LC_GC_MODE_INC,     /* incremental mode */
+    LC_GC_MODE_GEN,     /* generational mode */
+} lc_gc_mode;
+
+/**
+ * GC policy, each one keeps its own counters.
+ */
+typedef enum {
+    LC_GC_POLICY_TICK,  /* bounded steps at the end of a callback */
+    LC_GC_POLICY_IDLE,  /* steps when the run loop is idle */
+    LC_GC_POLICY_FULL,  /* full collection under memory pressure */
+    LC_GC_POLICY_EMERGENCY, /* collection after the heap crosses the soft limit */
+
+    LC_GC_POLICY_MAX,
+} lc_gc_policy;
+
+/**
+ * GC configuration.
+ */
+typedef struct lc_gc_config {
+    lc_gc_mode mode;        /* GC mode */
+    size_t step_size;       /* step size in KB, 0 means a basic step */
+    HAPTime tick_budget;    /* time budget for each tick in milliseconds */
+    HAPTime idle_delay;     /* run loop idle time before the idle collection, 0 disables it */
+    HAPTime idle_budget;    /* time budget for each idle slice in milliseconds */
+    size_t pressure;        /* heap size in KB that triggers a full collection, 0 disables it */
+} lc_gc_config;
+
+/**
+ * GC statistics.
+ */
+typedef struct lc_gc_stats {
+    struct {
+        size_t count;       /* number of runs */
+        size_t steps;       /* number of steps, a full collection counts as one */
+        HAPTime time;       /* time spent in milliseconds */
+    } policies[LC_GC_POLICY_MAX];
+    size_t cycles;          /* number of completed cycles (collections in generational mode) */
+    size_t pressure;        /* current pressure threshold in KB, 0 if disabled */
+} lc_gc_stats;
+
+/**
+ * Initialize the GC policy engine with the default configuration.
+ */
+void lc_initgc(lua_State *L);
+
+/**
+ * De-initialize the GC policy engine.
+ */
+void lc_deinitgc(void);
+
+/**
+ * Set GC configuration.
+ */
+void lc_setgcconfig(lua_State *L, const lc_gc_config *config);
+
+/**
+ * Get GC configuration.
+ */
+const lc_gc_config *lc_getgcconfig(void);
+
+/**
+ * Get GC statistics.
+ */
+const lc_gc_stats *lc_getgcstats(void);
+
 /**
  * Collect garbage.
+ *
+ * Run a tick of the GC policy engine, it must be called at the end of
+ * every entry from C to Lua.
  */
 void lc_collectgarbage(lua_State *L);
 
@@ -77,7 +151,127 @@ void lc_collectgarbage(lua_State *L);
 void lc_pushtraceback(lua_State *L);
 
 /**
- * New a coroutine.
+ * Maximum number of heap owners, including the default owner "core".
+ */
+#define LC_HEAP_OWNERS_MAX 16
+
+/**
+ * Heap budget configuration.
+ */
+typedef struct lc_heap_config {
+    size_t soft_limit;      /* heap size in KB that triggers an emergency collection, 0 disables it */
+    size_t hard_limit;      /* heap size in KB above which allocations fail, 0 disables it */
+} lc_heap_config;
+
+/**
+ * Heap statistics.
+ */
+typedef struct lc_heap_stats {
+    size_t used;            /* bytes in use */
+    size_t peak;            /* peak bytes in use */
+    size_t soft_crossings;  /* number of times the heap crossed the soft limit */
+    size_t failures;        /* number of failed allocations */
+} lc_heap_stats;
+
+/**
+ * Heap owner, the bytes allocated while its coroutines run are attributed to it.
+ *
+ * The allocator does not know the owner of a freed block, so the counters
+ * measure the allocation churn of the owner rather than its live bytes.
+ */
+typedef struct lc_heap_owner {
+    char name[32];          /* owner name */
+    size_t bytes;           /* total bytes allocated, the freed bytes are not subtracted */
+    size_t count;           /* total number of allocations */
+} lc_heap_owner;
+
+/**
+ * Lua allocator, it enforces the heap budget.
+ */
+void *lc_alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+/**
+ * Set heap budget configuration.
+ */
+void lc_setheapconfig(const lc_heap_config *config);
+
+/**
+ * Get heap budget configuration.
+ */
+const lc_heap_config *lc_getheapconfig(void);
+
+/**
+ * Get heap statistics.
+ */
+const lc_heap_stats *lc_getheapstats(void);
+
+/**
+ * Get heap owners.
+ *
+ * @param count The number of owners.
+ * @returns the array of the owners.
+ */
+const lc_heap_owner *lc_getheapowners(size_t *count);
+
+/**
+ * Find the heap owner with the name, it is added if it does not exist.
+ *
+ * @returns the index of the owner, or 0 (the default owner) if there are too many owners.
+ */
+int lc_heapowner(const char *name);
+
+/**
+ * Get the heap owner of the coroutine.
+ */
+int lc_getheapowner(lua_State *L);
+
+/**
+ * Set the heap owner of the coroutine.
+ */
+void lc_setheapowner(lua_State *L, int owner);
+
+/**
+ * Set the heap owner of the running coroutine, it takes effect immediately.
+ */
+void lc_setrunningheapowner(lua_State *L, int owner);
+
+/**
+ * Coroutine pool configuration.
+ */
+typedef struct lc_thread_pool_config {
+    size_t max_idle;        /* maximum number of idle coroutines kept for reuse */
+    HAPTime trim_interval;  /* the coroutines idle for a whole interval are released, 0 disables it */
+} lc_thread_pool_config;
+
+/**
+ * Coroutine pool statistics.
+ */
+typedef struct lc_thread_pool_stats {
+    size_t creates;         /* number of coroutines created */
+    size_t reuses;          /* number of coroutines reused from the pool */
+    size_t trims;           /* number of idle coroutines released */
+    size_t active;          /* number of coroutines in use */
+    size_t peak_active;     /* peak number of coroutines in use */
+    size_t idle;            /* number of idle coroutines in the pool */
+} lc_thread_pool_stats;
+
+/**
+ * Set coroutine pool configuration.
+ */
+void lc_setthreadpoolconfig(lua_State *L, const lc_thread_pool_config *config);
+
+/**
+ * Get coroutine pool configuration.
+ */
+const lc_thread_pool_config *lc_getthreadpoolconfig(void);
+
+/**
+ * Get coroutine pool statistics.
+ */
+const lc_thread_pool_stats *lc_getthreadpoolstats(void);
+
+/**
+ * New a coroutine, it is taken from the pool if there is an idle one.
  */
 lua_State *lc_newthread(lua_State *L);
 
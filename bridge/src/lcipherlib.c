@@ -113,6 +113,56 @@ static int lcipher_create(lua_State *L) {
     return 1;
 }
 
+static int lcipher_crypt(lua_State *L) {
+    pal_cipher_type type = luaL_checkoption(L, 1, NULL, lcipher_type_strs);
+    pal_cipher_operation op = luaL_checkoption(L, 2, NULL, lcipher_op_strs);
+    size_t keylen;
+    const char *key = luaL_checklstring(L, 3, &keylen);
+    size_t ivlen = 0;
+    const char *iv = luaL_optlstring(L, 4, NULL, &ivlen);
+    size_t inlen;
+    const char *in = luaL_checklstring(L, 5, &inlen);
+
+    pal_cipher_ctx *ctx = pal_cipher_ctx_get_cached(type);
+    if (luai_unlikely(!ctx)) {
+        luaL_error(L, "failed to get a %s cipher", lcipher_type_strs[type]);
+    }
+    if (pal_cipher_get_key_len(ctx) != keylen) {
+        luaL_error(L, "invalid key length");
+    }
+    if (pal_cipher_get_iv_len(ctx) == 0) {
+        iv = NULL;
+    } else if (pal_cipher_get_iv_len(ctx) != ivlen) {
+        luaL_error(L, "invalid IV length");
+    }
+    if (!lua_isnoneornil(L, 6)) {
+        pal_cipher_padding padding = luaL_checkoption(L, 6, NULL, lcipher_padding_strs);
+        if (luai_unlikely(!pal_cipher_set_padding(ctx, padding))) {
+            luaL_error(L, "failed to set padding to the cipher");
+        }
+    }
+    if (luai_unlikely(!pal_cipher_begin(ctx, op, (const uint8_t *)key, (const uint8_t *)iv))) {
+        luaL_error(L, "failed to begin a %s process", lcipher_op_strs[op]);
+    }
+
+    size_t blocksize = pal_cipher_get_block_size(ctx);
+    luaL_Buffer B;
+    char *out = luaL_buffinitsize(L, &B, inlen + blocksize * 2);
+    size_t outlen = 0;
+    if (inlen) {
+        outlen = inlen + blocksize;
+        if (luai_unlikely(!pal_cipher_update(ctx, in, inlen, out, &outlen))) {
+            luaL_error(L, "failed to update data to the cipher");
+        }
+    }
+    size_t finlen = blocksize;
+    if (luai_unlikely(!pal_cipher_finish(ctx, out + outlen, &finlen))) {
+        luaL_error(L, "failed to finish the process");
+    }
+    luaL_pushresultsize(&B, outlen + finlen);
+    return 1;
+}
+
 static int lcipher_ctx_gc(lua_State *L) {
     lcipher_ctx *ctx = LCIPHER_GET_CTX(L, 1);
     pal_cipher_ctx_deinit(&ctx->ctx);
@@ -223,6 +273,7 @@ static const luaL_Reg lcipher_ctx_meth[] = {
 
 static const luaL_Reg lcipher_funcs[] = {
     {"create", lcipher_create},
+    {"crypt", lcipher_crypt},
     {NULL, NULL}
 };
 
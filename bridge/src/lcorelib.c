@@ -4,42 +4,604 @@
 // you may not use this file except in compliance with the License.
 // See [CONTRIBUTORS.md] for the list of homekit-bridge project authors.
 
+#include <limits.h>
 #include <lauxlib.h>
 #include <HAPLog.h>
 #include <HAPPlatformTimer.h>
+#include <pal/mem.h>
 
 #include "app_int.h"
 #include "lc.h"
 
 #define LUA_TIMER_NAME "Timer*"
 #define LUA_MQ_OBJ_NAME "MQ*"
+#define LUA_TASK_NAME "Task*"
 #define LCORE_ATEXITS "_ATEXITS"
+#define LCORE_SLEEPS "_SLEEPS"
+
+#define LCORE_TW_BITS 6
+#define LCORE_TW_SLOTS (1 << LCORE_TW_BITS)
+#define LCORE_TW_MASK (LCORE_TW_SLOTS - 1)
+#define LCORE_TW_LEVELS 4
+#define LCORE_TW_SPAN(level) ((HAPTime)1 << (LCORE_TW_BITS * (level)))
+
+#define LCORE_TIMER_TOLERANCE_DFT 0
 
 static const HAPLogObject lcore_log = {
     .subsystem = APP_BRIDGE_LOG_SUBSYSTEM,
     .category = "core",
 };
 
+/**
+ * Node of the timer wheel.
+ */
+typedef struct lcore_tw_node {
+    HAPTime expire;         /* Expiration time in milliseconds. */
+    void (*cb)(struct lcore_tw_node *node);
+    struct lcore_tw_node *next;
+    struct lcore_tw_node **pprev;   /* NULL if the node is not in the wheel. */
+} lcore_tw_node;
+
+struct lcore_sleep_ctx;
+
+/**
+ * Hierarchical timer wheel.
+ *
+ * Each level has LCORE_TW_SLOTS slots, a slot of level N covers LCORE_TW_SPAN(N) milliseconds.
+ * The nodes of a higher level are moved to the lower levels when the wheel reaches their slot,
+ * so starting and stopping a timer is O(1). The wheel uses only one platform timer,
+ * which is armed at the next expiration. If a tolerance is set, a future expiration is
+ * rounded up to it, so that the timers due close together fire in one run loop wakeup.
+ * The nodes added after their expiration are kept in the due list and fire at once.
+ */
+typedef struct lcore_tw {
+    HAPTime now;                /* The next millisecond to process. */
+    HAPTime tolerance;          /* Tolerance in milliseconds. */
+    size_t num_nodes;           /* Number of nodes in the wheel. */
+    HAPPlatformTimerRef timer;  /* Platform timer. */
+    HAPTime deadline;           /* Deadline of the platform timer. */
+    lcore_tw_node *slots[LCORE_TW_LEVELS][LCORE_TW_SLOTS];
+    lcore_tw_node *due;         /* Nodes expired before the wheel time, fired at the next advance. */
+    struct lcore_sleep_ctx *free_sleeps;    /* Free sleep contexts. */
+    size_t num_sleeps;          /* Number of sleep contexts created. */
+} lcore_tw;
+
 /**
  * Timer object context.
  */
 typedef struct {
+    lcore_tw_node node;
     int nargs;
     lua_State *mL;
-    HAPPlatformTimerRef timer;  /* Timer ID. Start from 1. */
+    HAPTime period;     /* Period in milliseconds, 0 means the timer fires once. */
+    int owner;          /* Heap owner of the callback. */
 } lcore_timer_ctx;
 
-typedef struct {
-    size_t first;
-    size_t last;
-    size_t size;
+/**
+ * Sleep context.
+ *
+ * The contexts are userdata kept in the registry and reused.
+ */
+typedef struct lcore_sleep_ctx {
+    lcore_tw_node node;
+    lua_State *co;      /* The sleeping coroutine. */
+    struct lcore_sleep_ctx *next;
+} lcore_sleep_ctx;
+
+struct lcore_mq;
+
+/**
+ * Coroutine waiting on the message queue.
+ *
+ * The waiters are userdata kept in the waiter table of the message queue and reused,
+ * the waiting coroutine is stored in the registry, and the key is the pointer of the waiter.
+ */
+typedef struct lcore_mq_waiter {
+    lcore_tw_node node;         /* Timer of the receive timeout. */
+    struct lcore_mq *mq;
+    struct lcore_mq_list *list; /* The list where the waiter is, NULL if the waiter is free. */
+    struct lcore_mq_waiter *next;
+    struct lcore_mq_waiter **pprev;
+} lcore_mq_waiter;
+
+typedef struct lcore_mq_list {
+    lcore_mq_waiter *head;
+    lcore_mq_waiter **ptail;
+} lcore_mq_list;
+
+/**
+ * Message queue.
+ *
+ * The values of the messages are stored in a ring in the array part of a table,
+ * and the number of values of each message is stored after the structure.
+ */
+typedef struct lcore_mq {
+    lua_State *mL;
+    size_t size;            /* Maximum number of messages. */
+    size_t first;           /* Index of the first message. */
+    size_t count;           /* Number of messages. */
+    size_t vcap;            /* Capacity of the value ring. */
+    size_t vfirst;          /* Index of the first value. */
+    size_t vcount;          /* Number of values. */
+    size_t num_waiters;     /* Number of waiters created. */
+    lcore_mq_waiter *free;  /* Free waiters. */
+    lcore_mq_list recvers;  /* Coroutines waiting for messages. */
+    lcore_mq_list senders;  /* Coroutines waiting for free space. */
+    int nvals[];            /* Number of values of each message. */
 } lcore_mq;
 
+/* User values of the message queue. */
+#define LCORE_MQ_UV_VALS 1
+#define LCORE_MQ_UV_WAITERS 2
+
+static lcore_tw gv_lcore_tw;
+
+static void lcore_tw_timer_cb(HAPPlatformTimerRef timer, void *context);
+static void lcore_timer_cb(lcore_tw_node *node);
+static void lcore_mq_timeout_cb(lcore_tw_node *node);
+
+static inline bool lcore_tw_pending(const lcore_tw_node *node) {
+    return node->pprev != NULL;
+}
+
+static void lcore_tw_link(lcore_tw_node **pslot, lcore_tw_node *node) {
+    node->next = *pslot;
+    if (node->next) {
+        node->next->pprev = &node->next;
+    }
+    node->pprev = pslot;
+    *pslot = node;
+}
+
+static void lcore_tw_unlink(lcore_tw_node *node) {
+    *(node->pprev) = node->next;
+    if (node->next) {
+        node->next->pprev = node->pprev;
+    }
+    node->next = NULL;
+    node->pprev = NULL;
+}
+
+/**
+ * Put the node into the slot of its expiration time.
+ */
+static void lcore_tw_place(lcore_tw *tw, lcore_tw_node *node) {
+    HAPTime expire = node->expire;
+    if (expire < tw->now) {
+        lcore_tw_link(&tw->due, node);
+        return;
+    }
+    if (expire - tw->now >= LCORE_TW_SPAN(LCORE_TW_LEVELS)) {
+        // Too far, the node is placed again when the last level reaches its slot.
+        expire = tw->now + LCORE_TW_SPAN(LCORE_TW_LEVELS) - 1;
+    }
+    int level = 0;
+    while (expire - tw->now >= LCORE_TW_SPAN(level + 1)) {
+        level++;
+    }
+    lcore_tw_link(&tw->slots[level][(expire >> (LCORE_TW_BITS * level)) & LCORE_TW_MASK], node);
+}
+
+/**
+ * Get the next millisecond when the wheel has work to do,
+ * either the expiration of a node in level 0 or moving the nodes of a higher level slot.
+ */
+static HAPTime lcore_tw_next_tick(lcore_tw *tw) {
+    HAPTime next = UINT64_MAX;
+    for (HAPTime i = 0; i < LCORE_TW_SLOTS; i++) {
+        if (tw->slots[0][(tw->now + i) & LCORE_TW_MASK]) {
+            next = tw->now + i;
+            break;
+        }
+    }
+    for (int level = 1; level < LCORE_TW_LEVELS; level++) {
+        HAPTime span = LCORE_TW_SPAN(level);
+        HAPTime base = tw->now & ~(span - 1);
+        for (HAPTime k = base == tw->now ? 0 : 1; k <= LCORE_TW_SLOTS; k++) {
+            HAPTime tick = base + k * span;
+            if (tick >= next) {
+                break;
+            }
+            if (tw->slots[level][(tick >> (LCORE_TW_BITS * level)) & LCORE_TW_MASK]) {
+                next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * Get the earliest expiration time of the nodes,
+ * or the time when a too far node is placed again if it is earlier.
+ */
+static HAPTime lcore_tw_next_expire(lcore_tw *tw) {
+    if (tw->due) {
+        return 0;
+    }
+    HAPTime next = UINT64_MAX;
+    for (int level = 0; level < LCORE_TW_LEVELS; level++) {
+        HAPTime span = LCORE_TW_SPAN(level);
+        HAPTime base = tw->now & ~(span - 1);
+        // Once the current slot of a higher level is moved, it only holds the nodes of the next round,
+        // so it is scanned last, the same as lcore_tw_next_tick().
+        HAPTime first = base == tw->now ? 0 : 1;
+        for (HAPTime k = first; k < first + LCORE_TW_SLOTS; k++) {
+            HAPTime tick = base + k * span;
+            if (tick >= next) {
+                break;
+            }
+            lcore_tw_node *node = tw->slots[level][(tick >> (LCORE_TW_BITS * level)) & LCORE_TW_MASK];
+            if (!node) {
+                continue;
+            }
+            // The nodes in the first non-empty slot expire before the ones in the following slots.
+            for (; node; node = node->next) {
+                HAPTime expire = node->expire < tick + span ? node->expire : tick;
+                if (expire < next) {
+                    next = expire;
+                }
+            }
+            break;
+        }
+    }
+    return next;
+}
+
+/**
+ * Arm the platform timer, if it is not armed at an earlier deadline.
+ */
+static bool lcore_tw_arm(lcore_tw *tw, HAPTime expire) {
+    HAPTime deadline = 0;
+    if (expire > HAPPlatformClockGetCurrent()) {
+        deadline = expire;
+        if (tw->tolerance > 1) {
+            deadline = (expire + tw->tolerance - 1) / tw->tolerance * tw->tolerance;
+        }
+    }
+    if (tw->timer) {
+        if (tw->deadline <= deadline) {
+            return true;
+        }
+        HAPPlatformTimerDeregister(tw->timer);
+        tw->timer = 0;
+    }
+    if (HAPPlatformTimerRegister(&tw->timer, deadline, lcore_tw_timer_cb, tw) != kHAPError_None) {
+        HAPLogError(&lcore_log, "%s: Failed to register the timer.", __func__);
+        return false;
+    }
+    tw->deadline = deadline;
+    return true;
+}
+
+/**
+ * Add the node into the wheel.
+ *
+ * @returns false if the platform timer cannot be armed.
+ */
+static bool lcore_tw_add(lcore_tw_node *node, HAPTime expire) {
+    lcore_tw *tw = &gv_lcore_tw;
+    HAPPrecondition(!lcore_tw_pending(node));
+
+    if (tw->num_nodes == 0) {
+        // Catch up with the clock, the wheel is not advanced when it is empty.
+        HAPTime now = HAPPlatformClockGetCurrent();
+        if (now > tw->now) {
+            tw->now = now;
+        }
+    }
+    node->expire = expire;
+    lcore_tw_place(tw, node);
+    tw->num_nodes++;
+    if (!lcore_tw_arm(tw, expire)) {
+        lcore_tw_unlink(node);
+        tw->num_nodes--;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Remove the node from the wheel.
+ *
+ * The platform timer is left armed, it finds nothing to do if the node was the earliest.
+ */
+static void lcore_tw_remove(lcore_tw_node *node) {
+    if (lcore_tw_pending(node)) {
+        lcore_tw_unlink(node);
+        gv_lcore_tw.num_nodes--;
+    }
+}
+
+/**
+ * Fire the nodes of the list, the nodes added by the callbacks are processed later.
+ */
+static void lcore_tw_fire(lcore_tw *tw, lcore_tw_node **plist) {
+    lcore_tw_node *expired = *plist;
+    if (!expired) {
+        return;
+    }
+    *plist = NULL;
+    expired->pprev = &expired;
+    while (expired) {
+        lcore_tw_node *node = expired;
+        lcore_tw_unlink(node);
+        tw->num_nodes--;
+        node->cb(node);
+    }
+}
+
+/**
+ * Fire the nodes which expire before or at the target time.
+ */
+static void lcore_tw_advance(lcore_tw *tw, HAPTime target) {
+    lcore_tw_fire(tw, &tw->due);
+    while (tw->num_nodes) {
+        HAPTime now = lcore_tw_next_tick(tw);
+        if (now > target) {
+            break;
+        }
+        tw->now = now;
+
+        // Move the nodes of the higher levels which reach their slots.
+        for (int level = 1; level < LCORE_TW_LEVELS && !(now & (LCORE_TW_SPAN(level) - 1)); level++) {
+            lcore_tw_node **pslot = &tw->slots[level][(now >> (LCORE_TW_BITS * level)) & LCORE_TW_MASK];
+            lcore_tw_node *node = *pslot;
+            *pslot = NULL;
+            while (node) {
+                lcore_tw_node *next = node->next;
+                lcore_tw_place(tw, node);
+                node = next;
+            }
+        }
+
+        tw->now = now + 1;
+        lcore_tw_fire(tw, &tw->slots[0][now & LCORE_TW_MASK]);
+    }
+    if (tw->now <= target) {
+        tw->now = target + 1;
+    }
+}
+
+static void lcore_tw_timer_cb(HAPPlatformTimerRef timer, void *context) {
+    lcore_tw *tw = context;
+    tw->timer = 0;
+
+    lcore_tw_advance(tw, HAPPlatformClockGetCurrent());
+    if (tw->num_nodes && !lcore_tw_arm(tw, lcore_tw_next_expire(tw))) {
+        HAPFatalError();
+    }
+}
+
+static void lcore_tw_reset(lcore_tw *tw) {
+    if (tw->timer) {
+        HAPPlatformTimerDeregister(tw->timer);
+    }
+    HAPRawBufferZero(tw, sizeof(*tw));
+    tw->tolerance = LCORE_TIMER_TOLERANCE_DFT;
+}
+
 static int lcore_time(lua_State *L) {
     lua_pushnumber(L, HAPPlatformClockGetCurrent());
     return 1;
 }
 
+static const char *lcore_gc_mode_strs[] = {
+    "incremental",
+    "generational",
+    NULL,
+};
+
+static const char *lcore_gc_policy_strs[] = {
+    "tick",
+    "idle",
+    "full",
+    "emergency",
+};
+
+static bool lcore_gc_config_mode_cb(lua_State *L, void *arg) {
+    lc_gc_config *config = arg;
+    config->mode = luaL_checkoption(L, -1, NULL, lcore_gc_mode_strs);
+    return true;
+}
+
+#define LCORE_GC_CONFIG_INTEGER_CB(field) \
+static bool lcore_gc_config_##field##_cb(lua_State *L, void *arg) { \
+    lc_gc_config *config = arg; \
+    lua_Integer val = lua_tointeger(L, -1); \
+    if (val < 0) { \
+        return false; \
+    } \
+    config->field = val; \
+    return true; \
+}
+
+LCORE_GC_CONFIG_INTEGER_CB(step_size)
+LCORE_GC_CONFIG_INTEGER_CB(tick_budget)
+LCORE_GC_CONFIG_INTEGER_CB(idle_delay)
+LCORE_GC_CONFIG_INTEGER_CB(idle_budget)
+LCORE_GC_CONFIG_INTEGER_CB(pressure)
+
+static const lc_table_kv lcore_gc_config_kvs[] = {
+    {"mode", LC_TSTRING, lcore_gc_config_mode_cb},
+    {"stepSize", LC_TNUMBER, lcore_gc_config_step_size_cb},
+    {"tickBudget", LC_TNUMBER, lcore_gc_config_tick_budget_cb},
+    {"idleDelay", LC_TNUMBER, lcore_gc_config_idle_delay_cb},
+    {"idleBudget", LC_TNUMBER, lcore_gc_config_idle_budget_cb},
+    {"pressure", LC_TNUMBER, lcore_gc_config_pressure_cb},
+    {NULL, 0, NULL},
+};
+
+static int lcore_set_gc_config(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    lc_gc_config config = *lc_getgcconfig();
+    if (!lc_traverse_table(L, 1, lcore_gc_config_kvs, &config)) {
+        luaL_error(L, "failed to parse the GC configuration");
+    }
+    lc_setgcconfig(L, &config);
+    return 0;
+}
+
+static int lcore_get_gc_stats(lua_State *L) {
+    const lc_gc_stats *stats = lc_getgcstats();
+
+    lua_createtable(L, 0, LC_GC_POLICY_MAX + 3);
+    lua_pushinteger(L, stats->cycles);
+    lua_setfield(L, -2, "cycles");
+    lua_pushinteger(L, lua_gc(L, LUA_GCCOUNT));
+    lua_setfield(L, -2, "heap");
+    lua_pushinteger(L, stats->pressure);
+    lua_setfield(L, -2, "pressure");
+    for (int i = 0; i < LC_GC_POLICY_MAX; i++) {
+        lua_createtable(L, 0, 3);
+        lua_pushinteger(L, stats->policies[i].count);
+        lua_setfield(L, -2, "count");
+        lua_pushinteger(L, stats->policies[i].steps);
+        lua_setfield(L, -2, "steps");
+        lua_pushinteger(L, stats->policies[i].time);
+        lua_setfield(L, -2, "time");
+        lua_setfield(L, -2, lcore_gc_policy_strs[i]);
+    }
+    return 1;
+}
+
+#define LCORE_THREAD_POOL_CONFIG_INTEGER_CB(field) \
+static bool lcore_thread_pool_config_##field##_cb(lua_State *L, void *arg) { \
+    lc_thread_pool_config *config = arg; \
+    lua_Integer val = lua_tointeger(L, -1); \
+    if (val < 0) { \
+        return false; \
+    } \
+    config->field = val; \
+    return true; \
+}
+
+LCORE_THREAD_POOL_CONFIG_INTEGER_CB(max_idle)
+LCORE_THREAD_POOL_CONFIG_INTEGER_CB(trim_interval)
+
+static const lc_table_kv lcore_thread_pool_config_kvs[] = {
+    {"maxIdle", LC_TNUMBER, lcore_thread_pool_config_max_idle_cb},
+    {"trimInterval", LC_TNUMBER, lcore_thread_pool_config_trim_interval_cb},
+    {NULL, 0, NULL},
+};
+
+static int lcore_set_thread_pool_config(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    lc_thread_pool_config config = *lc_getthreadpoolconfig();
+    if (!lc_traverse_table(L, 1, lcore_thread_pool_config_kvs, &config)) {
+        luaL_error(L, "failed to parse the coroutine pool configuration");
+    }
+    lc_setthreadpoolconfig(L, &config);
+    return 0;
+}
+
+static int lcore_get_thread_pool_stats(lua_State *L) {
+    const lc_thread_pool_stats *stats = lc_getthreadpoolstats();
+
+    lua_createtable(L, 0, 6);
+    lua_pushinteger(L, stats->creates);
+    lua_setfield(L, -2, "creates");
+    lua_pushinteger(L, stats->reuses);
+    lua_setfield(L, -2, "reuses");
+    lua_pushinteger(L, stats->trims);
+    lua_setfield(L, -2, "trims");
+    lua_pushinteger(L, stats->active);
+    lua_setfield(L, -2, "active");
+    lua_pushinteger(L, stats->peak_active);
+    lua_setfield(L, -2, "peakActive");
+    lua_pushinteger(L, stats->idle);
+    lua_setfield(L, -2, "idle");
+    return 1;
+}
+
+static int lcore_get_heap_stats(lua_State *L) {
+    size_t count;
+    const pal_mem_class_stats *stats = pal_mem_heap_get_stats(&count);
+
+    lua_createtable(L, count, 0);
+    for (size_t i = 0; i < count; i++) {
+        lua_createtable(L, 0, 4);
+        lua_pushinteger(L, stats[i].size);
+        lua_setfield(L, -2, "size");
+        lua_pushinteger(L, stats[i].live);
+        lua_setfield(L, -2, "live");
+        lua_pushinteger(L, stats[i].peak);
+        lua_setfield(L, -2, "peak");
+        lua_pushinteger(L, stats[i].slabs);
+        lua_setfield(L, -2, "slabs");
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+#define LCORE_HEAP_CONFIG_INTEGER_CB(field) \
+static bool lcore_heap_config_##field##_cb(lua_State *L, void *arg) { \
+    lc_heap_config *config = arg; \
+    lua_Integer val = lua_tointeger(L, -1); \
+    if (val < 0) { \
+        return false; \
+    } \
+    config->field = val; \
+    return true; \
+}
+
+LCORE_HEAP_CONFIG_INTEGER_CB(soft_limit)
+LCORE_HEAP_CONFIG_INTEGER_CB(hard_limit)
+
+static const lc_table_kv lcore_heap_config_kvs[] = {
+    {"softLimit", LC_TNUMBER, lcore_heap_config_soft_limit_cb},
+    {"hardLimit", LC_TNUMBER, lcore_heap_config_hard_limit_cb},
+    {NULL, 0, NULL},
+};
+
+static int lcore_set_heap_config(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    lc_heap_config config = *lc_getheapconfig();
+    if (!lc_traverse_table(L, 1, lcore_heap_config_kvs, &config)) {
+        luaL_error(L, "failed to parse the heap configuration");
+    }
+    luaL_argcheck(L, !config.hard_limit || config.soft_limit < config.hard_limit, 1,
+        "soft limit must be less than hard limit");
+    lc_setheapconfig(&config);
+    return 0;
+}
+
+static int lcore_get_heap_usage(lua_State *L) {
+    const lc_heap_stats *stats = lc_getheapstats();
+    size_t count;
+    const lc_heap_owner *owners = lc_getheapowners(&count);
+
+    lua_createtable(L, 0, 5);
+    lua_pushinteger(L, stats->used);
+    lua_setfield(L, -2, "used");
+    lua_pushinteger(L, stats->peak);
+    lua_setfield(L, -2, "peak");
+    lua_pushinteger(L, stats->soft_crossings);
+    lua_setfield(L, -2, "softCrossings");
+    lua_pushinteger(L, stats->failures);
+    lua_setfield(L, -2, "failures");
+    lua_createtable(L, 0, count);
+    for (size_t i = 0; i < count; i++) {
+        lua_createtable(L, 0, 2);
+        lua_pushinteger(L, owners[i].bytes);
+        lua_setfield(L, -2, "bytes");
+        lua_pushinteger(L, owners[i].count);
+        lua_setfield(L, -2, "count");
+        lua_setfield(L, -2, owners[i].name);
+    }
+    lua_setfield(L, -2, "owners");
+    return 1;
+}
+
+static int lcore_set_heap_owner(lua_State *L) {
+    int owner = lua_isnoneornil(L, 1) ? 0 : lc_heapowner(luaL_checkstring(L, 1));
+    lc_setrunningheapowner(L, owner);
+    return 0;
+}
+
 static int lcore_exit_finish(lua_State *L, int status, lua_KContext extra) {
     if (luai_unlikely(status != LUA_OK && status != LUA_YIELD)) {
         HAPPlatformRunLoopStop();
@@ -94,10 +656,16 @@ static int lcore_sleep_resume(lua_State *L) {
     return 0;
 }
 
-static void lcore_sleep_cb(HAPPlatformTimerRef timer, void *context) {
-    lua_State *co = context;
+static void lcore_sleep_cb(lcore_tw_node *node) {
+    lcore_sleep_ctx *ctx = (lcore_sleep_ctx *)node;
+    lcore_tw *tw = &gv_lcore_tw;
+    lua_State *co = ctx->co;
     lua_State *L = lc_getmainthread(co);
 
+    ctx->co = NULL;
+    ctx->next = tw->free_sleeps;
+    tw->free_sleeps = ctx;
+
     HAPAssert(lua_gettop(L) == 0);
 
     lua_pushcfunction(L, lcore_sleep_resume);
@@ -115,15 +683,35 @@ static int lcore_sleep(lua_State *L) {
     lua_Integer ms = luaL_checkinteger(L, 1);
     luaL_argcheck(L, ms >= 0, 1, "ms out of range");
 
-    HAPPlatformTimerRef timer;
-    if (HAPPlatformTimerRegister(&timer,
-        ms ? (HAPTime)ms + HAPPlatformClockGetCurrent() : 0,
-        lcore_sleep_cb, L) != kHAPError_None) {
+    lcore_tw *tw = &gv_lcore_tw;
+    lcore_sleep_ctx *ctx = tw->free_sleeps;
+    if (ctx) {
+        tw->free_sleeps = ctx->next;
+    } else {
+        luaL_getsubtable(L, LUA_REGISTRYINDEX, LCORE_SLEEPS);
+        ctx = lua_newuserdatauv(L, sizeof(*ctx), 0);
+        HAPRawBufferZero(ctx, sizeof(*ctx));
+        ctx->node.cb = lcore_sleep_cb;
+        lua_rawseti(L, -2, ++tw->num_sleeps);
+        lua_pop(L, 1);
+    }
+    ctx->co = L;
+    if (!lcore_tw_add(&ctx->node, (HAPTime)ms + HAPPlatformClockGetCurrent())) {
+        ctx->co = NULL;
+        ctx->next = tw->free_sleeps;
+        tw->free_sleeps = ctx;
         luaL_error(L, "failed to create a timer");
     }
     return lua_yield(L, 0);
 }
 
+static int lcore_set_timer_tolerance(lua_State *L) {
+    lua_Integer ms = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, ms >= 0, 1, "ms out of range");
+    gv_lcore_tw.tolerance = ms;
+    return 0;
+}
+
 static int lcore_create_timer(lua_State *L) {
     luaL_checktype(L, 1, LUA_TFUNCTION);
 
@@ -134,22 +722,29 @@ static int lcore_create_timer(lua_State *L) {
     for (int i = n; i >= 1; i--) {
         lua_setiuservalue(L, 1, i);
     }
+    HAPRawBufferZero(ctx, sizeof(*ctx));
+    ctx->node.cb = lcore_timer_cb;
     ctx->nargs = n - 1;
-    ctx->timer = 0;
     ctx->mL = lc_getmainthread(L);
+    ctx->owner = lc_getheapowner(L);
     return 1;
 }
 
 static int lcore_create_mq(lua_State *L) {
-    size_t size = luaL_checkinteger(L, 1);
-    luaL_argcheck(L, size > 0, 1, "size out of range");
-    lcore_mq *obj = lua_newuserdatauv(L, sizeof(*obj), 1);
+    lua_Integer size = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, size > 0 && size <= INT_MAX, 1, "size out of range");
+    lcore_mq *mq = lua_newuserdatauv(L, sizeof(*mq) + sizeof(int) * size, 2);
     luaL_setmetatable(L, LUA_MQ_OBJ_NAME);
-    obj->first = 1;
-    obj->last = 1;
-    obj->size = size;
-    lua_createtable(L, 0, 1);
-    lua_setuservalue(L, -2);
+    HAPRawBufferZero(mq, sizeof(*mq));
+    mq->mL = lc_getmainthread(L);
+    mq->size = size;
+    mq->vcap = size;
+    mq->recvers.ptail = &mq->recvers.head;
+    mq->senders.ptail = &mq->senders.head;
+    lua_createtable(L, size, 0);
+    lua_setiuservalue(L, -2, LCORE_MQ_UV_VALS);
+    lua_createtable(L, 0, 0);
+    lua_setiuservalue(L, -2, LCORE_MQ_UV_WAITERS);
     return 1;
 }
 
@@ -159,6 +754,7 @@ static int lcore_timer_resume(lua_State *L) {
 
     int nres, status;
     lua_State *co = lc_newthread(L);
+    lc_setheapowner(co, ctx->owner);
     if (luai_unlikely(lua_rawgetp(co, LUA_REGISTRYINDEX, ctx) != LUA_TUSERDATA)) {
         HAPFatalError();
     }
@@ -169,8 +765,10 @@ static int lcore_timer_resume(lua_State *L) {
         lua_getiuservalue(co, 1, i);
     }
     lua_remove(co, 1);
-    lua_pushnil(co);
-    lua_rawsetp(co, LUA_REGISTRYINDEX, ctx);
+    if (!lcore_tw_pending(&ctx->node)) {
+        lua_pushnil(co);
+        lua_rawsetp(co, LUA_REGISTRYINDEX, ctx);
+    }
     status = lc_resume(co, L, ctx->nargs, &nres);
     if (luai_unlikely(status != LUA_OK && status != LUA_YIELD)) {
         HAPLogError(&lcore_log, "%s: %s", __func__, lua_tostring(L, -1));
@@ -178,11 +776,21 @@ static int lcore_timer_resume(lua_State *L) {
     return 0;
 }
 
-static void lcore_timer_cb(HAPPlatformTimerRef timer, void *context) {
-    lcore_timer_ctx *ctx = context;
+static void lcore_timer_cb(lcore_tw_node *node) {
+    lcore_timer_ctx *ctx = (lcore_timer_ctx *)node;
     lua_State *L = ctx->mL;
 
-    ctx->timer = 0;
+    if (ctx->period) {
+        // Keep the phase of the periodic timer, unless it is late for more than one period.
+        HAPTime expire = node->expire + ctx->period;
+        HAPTime now = HAPPlatformClockGetCurrent();
+        if (expire <= now) {
+            expire = now + ctx->period;
+        }
+        if (!lcore_tw_add(node, expire)) {
+            HAPLogError(&lcore_log, "%s: Failed to restart the periodic timer.", __func__);
+        }
+    }
 
     HAPAssert(lua_gettop(L) == 0);
 
@@ -202,17 +810,17 @@ static int lcore_timer_start(lua_State *L) {
 
     lua_Integer ms = luaL_checkinteger(L, 2);
     luaL_argcheck(L, ms >= 0, 2, "ms out of range");
+    bool periodic = lua_toboolean(L, 3);
+    luaL_argcheck(L, !periodic || ms > 0, 2, "period must be greater than 0");
 
-    if (ctx->timer) {
-        HAPPlatformTimerDeregister(ctx->timer);
-    }
-
-    if (HAPPlatformTimerRegister(&ctx->timer,
-        ms ? (HAPTime)ms + HAPPlatformClockGetCurrent() : 0,
-        lcore_timer_cb, ctx) != kHAPError_None) {
+    lcore_tw_remove(&ctx->node);
+    ctx->period = periodic ? ms : 0;
+    if (!lcore_tw_add(&ctx->node, (HAPTime)ms + HAPPlatformClockGetCurrent())) {
+        lua_pushnil(L);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, ctx);
         luaL_error(L, "failed to start the timer");
     }
-    lua_pop(L, 1);
+    lua_settop(L, 1);
     lua_rawsetp(L, LUA_REGISTRYINDEX, ctx);
     return 0;
 }
@@ -220,9 +828,8 @@ static int lcore_timer_start(lua_State *L) {
 static int lcore_timer_stop(lua_State *L) {
     lcore_timer_ctx *ctx = luaL_checkudata(L, 1, LUA_TIMER_NAME);
 
-    if (ctx->timer) {
-        HAPPlatformTimerDeregister(ctx->timer);
-        ctx->timer = 0;
+    if (lcore_tw_pending(&ctx->node)) {
+        lcore_tw_remove(&ctx->node);
         lua_pushnil(L);
         lua_rawsetp(L, LUA_REGISTRYINDEX, ctx);
     }
@@ -232,8 +839,8 @@ static int lcore_timer_stop(lua_State *L) {
 static int lcore_timer_tostring(lua_State *L) {
     lcore_timer_ctx *ctx = luaL_checkudata(L, 1, LUA_TIMER_NAME);
 
-    if (ctx->timer) {
-        lua_pushfstring(L, "timer (%u)", ctx->timer);
+    if (lcore_tw_pending(&ctx->node)) {
+        lua_pushfstring(L, "timer (%p)", ctx);
     } else {
         lua_pushliteral(L, "timer (expired)");
     }
@@ -268,100 +875,254 @@ static void lcore_timer_createmeta(lua_State *L) {
     lua_pop(L, 1);  /* pop metatable */
 }
 
-static size_t lcore_mq_size(lcore_mq *obj) {
-    return obj->first > obj->last ? obj->size - obj->first + obj->last : obj->last - obj->first;
+static void lcore_mq_list_append(lcore_mq_list *list, lcore_mq_waiter *waiter) {
+    waiter->list = list;
+    waiter->next = NULL;
+    waiter->pprev = list->ptail;
+    *(list->ptail) = waiter;
+    list->ptail = &waiter->next;
 }
 
-static int lcore_mq_send(lua_State *L) {
-    lcore_mq *obj = luaL_checkudata(L, 1, LUA_MQ_OBJ_NAME);
-    int narg = lua_gettop(L) - 1;
-    int status, nres;
-
-    lua_getuservalue(L, 1);
+static void lcore_mq_list_remove(lcore_mq_waiter *waiter) {
+    lcore_mq_list *list = waiter->list;
+    *(waiter->pprev) = waiter->next;
+    if (waiter->next) {
+        waiter->next->pprev = waiter->pprev;
+    } else {
+        list->ptail = waiter->pprev;
+    }
+    waiter->list = NULL;
+}
 
-    if (lua_getfield(L, -1, "wait") == LUA_TTABLE) {
-        lua_pushnil(L);
-        lua_setfield(L, -3, "wait");  // que.wait = nil
-        int waiting = luaL_len(L, -1);
-        for (int i = 1; i <= waiting; i++) {
-            HAPAssert(lua_geti(L, -1, i) == LUA_TTHREAD);
-            lua_State *co = lua_tothread(L, -1);
-            lua_pop(L, 1);
-            int max = 1 + narg;
-            if (luai_unlikely(!lua_checkstack(L, narg))) {
-                luaL_error(L, "stack overflow");
-            }
-            for (int i = 2; i <= max; i++) {
-                lua_pushvalue(L, i);
-            }
-            lua_xmove(L, co, narg);
-            status = lc_resume(co, L, narg, &nres);
-            if (luai_unlikely(status != LUA_OK && status != LUA_YIELD)) {
-                HAPLogError(&lcore_log, "%s: %s", __func__, lua_tostring(L, -1));
-            }
-            lua_pop(L, nres);
-        }
+/**
+ * Put the running coroutine into the wait list.
+ *
+ * The message queue must be at index 1.
+ */
+static lcore_mq_waiter *lcore_mq_wait(lua_State *L, lcore_mq *mq, lcore_mq_list *list) {
+    if (luai_unlikely(!lua_isyieldable(L))) {
+        luaL_error(L, "attempt to wait on the message queue outside a coroutine");
+    }
+    lcore_mq_waiter *waiter = mq->free;
+    if (waiter) {
+        mq->free = waiter->next;
     } else {
-        if (lcore_mq_size(obj) == obj->size) {
-            luaL_error(L, "the message queue is full");
-        }
+        lua_getiuservalue(L, 1, LCORE_MQ_UV_WAITERS);
+        waiter = lua_newuserdatauv(L, sizeof(*waiter), 0);
+        HAPRawBufferZero(waiter, sizeof(*waiter));
+        waiter->node.cb = lcore_mq_timeout_cb;
+        waiter->mq = mq;
+        lua_rawseti(L, -2, ++mq->num_waiters);
         lua_pop(L, 1);
-        lua_insert(L, 2);
-        lua_createtable(L, narg, 0);
-        lua_insert(L, 3);
-        for (int i = narg; i >= 1; i--) {
-            lua_seti(L, 3, i);
+    }
+    lua_pushthread(L);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, waiter);
+    lcore_mq_list_append(list, waiter);
+    return waiter;
+}
+
+/**
+ * Remove the waiter from the wait list and push the waiting coroutine onto the stack.
+ */
+static lua_State *lcore_mq_wakeup(lua_State *L, lcore_mq_waiter *waiter) {
+    lcore_mq *mq = waiter->mq;
+    lcore_mq_list_remove(waiter);
+    lcore_tw_remove(&waiter->node);
+    HAPAssert(lua_rawgetp(L, LUA_REGISTRYINDEX, waiter) == LUA_TTHREAD);
+    lua_pushnil(L);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, waiter);
+    waiter->next = mq->free;
+    mq->free = waiter;
+    return lua_tothread(L, -1);
+}
+
+/**
+ * Resume the coroutine on the top of the stack with the values on its stack, and pop it.
+ */
+static void lcore_mq_resume(lua_State *L, lua_State *co, int narg) {
+    int status, nres;
+    status = lc_resume(co, L, narg, &nres);
+    switch (status) {
+    case LUA_OK:
+        lua_pop(L, nres);
+        break;
+    case LUA_YIELD:
+        lua_pop(co, nres);
+        break;
+    default:
+        HAPLogError(&lcore_log, "%s: %s", __func__, lua_tostring(L, -1));
+        lua_pop(L, 1);
+        break;
+    }
+    lua_pop(L, 1);
+}
+
+/**
+ * Move the values of the ring into a larger ring.
+ *
+ * The ring is at the top of the stack, and it is replaced by the new ring.
+ */
+static void lcore_mq_grow(lua_State *L, lcore_mq *mq, size_t need) {
+    size_t cap = mq->vcap * 2;
+    if (cap < need) {
+        cap = need;
+    }
+    lua_createtable(L, cap, 0);
+    for (size_t i = 0; i < mq->vcount; i++) {
+        lua_rawgeti(L, -2, (mq->vfirst + i) % mq->vcap + 1);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_pushvalue(L, -1);
+    lua_setiuservalue(L, 1, LCORE_MQ_UV_VALS);
+    lua_remove(L, -2);
+    mq->vfirst = 0;
+    mq->vcap = cap;
+}
+
+/**
+ * Send the values from index 2 to the top of the stack.
+ *
+ * The message is handed over to the first receiver if there is one,
+ * otherwise it is put into the ring.
+ *
+ * @returns false if the message queue is full.
+ */
+static bool lcore_mq_push(lua_State *L, lcore_mq *mq) {
+    int narg = lua_gettop(L) - 1;
+
+    if (mq->recvers.head) {
+        lua_State *co = lcore_mq_wakeup(L, mq->recvers.head);
+        if (luai_unlikely(!lua_checkstack(L, narg) || !lua_checkstack(co, narg))) {
+            luaL_error(L, "stack overflow");
         }
-        lua_seti(L, 2, obj->last);
-        obj->last++;
-        if (obj->last > obj->size + 1) {
-            obj->last = 1;
+        for (int i = 2; i <= narg + 1; i++) {
+            lua_pushvalue(L, i);
         }
+        lua_xmove(L, co, narg);
+        lcore_mq_resume(L, co, narg);
+        return true;
+    }
+
+    if (mq->count == mq->size) {
+        return false;
+    }
+    lua_getiuservalue(L, 1, LCORE_MQ_UV_VALS);
+    if (mq->vcount + narg > mq->vcap) {
+        lcore_mq_grow(L, mq, mq->vcount + narg);
+    }
+    for (int i = 0; i < narg; i++) {
+        lua_pushvalue(L, i + 2);
+        lua_rawseti(L, -2, (mq->vfirst + mq->vcount + i) % mq->vcap + 1);
+    }
+    lua_pop(L, 1);
+    mq->vcount += narg;
+    mq->nvals[(mq->first + mq->count) % mq->size] = narg;
+    mq->count++;
+    return true;
+}
+
+/**
+ * Push the values of the first message onto the stack, and wake up the first sender.
+ *
+ * @returns the number of values.
+ */
+static int lcore_mq_pop(lua_State *L, lcore_mq *mq) {
+    int n = mq->nvals[mq->first];
+    if (luai_unlikely(!lua_checkstack(L, n + 2))) {
+        luaL_error(L, "stack overflow");
+    }
+    lua_getiuservalue(L, 1, LCORE_MQ_UV_VALS);
+    int vals = lua_gettop(L);
+    for (int i = 0; i < n; i++) {
+        lua_Integer idx = (mq->vfirst + i) % mq->vcap + 1;
+        lua_rawgeti(L, vals, idx);
+        lua_pushnil(L);
+        lua_rawseti(L, vals, idx);
     }
+    lua_remove(L, vals);
+    mq->vfirst = (mq->vfirst + n) % mq->vcap;
+    mq->vcount -= n;
+    mq->first = (mq->first + 1) % mq->size;
+    mq->count--;
+
+    if (mq->senders.head) {
+        lcore_mq_resume(L, lcore_mq_wakeup(L, mq->senders.head), 0);
+    }
+    return n;
+}
+
+static int lcore_mq_send_finish(lua_State *L, int status, lua_KContext extra) {
+    lcore_mq *mq = lua_touserdata(L, 1);
+    if (lcore_mq_push(L, mq)) {
+        return 0;
+    }
+    lcore_mq_wait(L, mq, &mq->senders);
+    return lua_yieldk(L, 0, 0, lcore_mq_send_finish);
+}
+
+static int lcore_mq_send(lua_State *L) {
+    luaL_checkudata(L, 1, LUA_MQ_OBJ_NAME);
+    return lcore_mq_send_finish(L, LUA_OK, 0);
+}
+
+static int lcore_mq_try_send(lua_State *L) {
+    lcore_mq *mq = luaL_checkudata(L, 1, LUA_MQ_OBJ_NAME);
+    bool sent = lcore_mq_push(L, mq);
+    lua_pushboolean(L, sent);
+    return 1;
+}
+
+static int lcore_mq_timeout_resume(lua_State *L) {
+    lcore_mq_waiter *waiter = lua_touserdata(L, 1);
+    lua_pop(L, 1);
+
+    lcore_mq_resume(L, lcore_mq_wakeup(L, waiter), 0);
     return 0;
 }
 
+static void lcore_mq_timeout_cb(lcore_tw_node *node) {
+    lcore_mq_waiter *waiter = (lcore_mq_waiter *)node;
+    lua_State *L = waiter->mq->mL;
+
+    HAPAssert(lua_gettop(L) == 0);
+
+    lua_pushcfunction(L, lcore_mq_timeout_resume);
+    lua_pushlightuserdata(L, waiter);
+    int status = lua_pcall(L, 1, 0, 0);
+    if (luai_unlikely(status != LUA_OK)) {
+        HAPLogError(&lcore_log, "%s: %s", __func__, lua_tostring(L, -1));
+    }
+
+    lua_settop(L, 0);
+    lc_collectgarbage(L);
+}
+
 static int lcore_mq_recv(lua_State *L) {
-    lcore_mq *obj = luaL_checkudata(L, 1, LUA_MQ_OBJ_NAME);
-    if (lua_gettop(L) != 1) {
-        luaL_error(L, "invalid arguements");
+    lcore_mq *mq = luaL_checkudata(L, 1, LUA_MQ_OBJ_NAME);
+    lua_Integer ms = -1;
+    if (!lua_isnoneornil(L, 2)) {
+        ms = luaL_checkinteger(L, 2);
+        luaL_argcheck(L, ms >= 0, 2, "ms out of range");
     }
-    lua_getuservalue(L, 1);
-    if (obj->last == obj->first) {
-        int type = lua_getfield(L, 2, "wait");
-        if (type == LUA_TNIL) {
-            lua_pop(L, 1);
-            lua_createtable(L, 1, 0);
-            lua_pushthread(L);
-            lua_seti(L, 3, 1);
-            lua_setfield(L, 2, "wait");
-        } else {
-            HAPAssert(type == LUA_TTABLE);
-            lua_pushthread(L);
-            lua_seti(L, 3, luaL_len(L, 3) + 1);
-            lua_pop(L, 1);
-        }
-        lua_pop(L, 1);
-        return lua_yield(L, 0);
-    } else {
-        lua_geti(L, 2, obj->first);
-        lua_pushnil(L);
-        lua_seti(L, 2, obj->first);
-        obj->first++;
-        if (obj->first > obj->size + 1) {
-            obj->first = 1;
-        }
-        int nargs = luaL_len(L, 3);
-        for (int i = 1; i <= nargs; i++) {
-            lua_geti(L, 3, i);
-        }
-        return nargs;
+    lua_settop(L, 1);
+
+    if (mq->count) {
+        return lcore_mq_pop(L, mq);
     }
+    if (ms == 0) {
+        return 0;
+    }
+    lcore_mq_waiter *waiter = lcore_mq_wait(L, mq, &mq->recvers);
+    if (ms > 0 && !lcore_tw_add(&waiter->node, (HAPTime)ms + HAPPlatformClockGetCurrent())) {
+        lcore_mq_wakeup(L, waiter);
+        luaL_error(L, "failed to create a timer");
+    }
+    return lua_yield(L, 0);
 }
 
 static int lcore_mq_tostring(lua_State *L) {
-    lcore_mq *obj = luaL_checkudata(L, 1, LUA_MQ_OBJ_NAME);
-    lua_pushfstring(L, "message queue (%p)", obj);
+    lcore_mq *mq = luaL_checkudata(L, 1, LUA_MQ_OBJ_NAME);
+    lua_pushfstring(L, "message queue (%d/%d)", (int)mq->count, (int)mq->size);
     return 1;
 }
 
@@ -379,6 +1140,7 @@ static const luaL_Reg lcore_mq_metameth[] = {
  */
 static const luaL_Reg lcore_mq_meth[] = {
     {"send", lcore_mq_send},
+    {"trySend", lcore_mq_try_send},
     {"recv", lcore_mq_recv},
     {NULL, NULL},
 };
@@ -392,19 +1154,223 @@ static void lcore_mq_createmeta(lua_State *L) {
     lua_pop(L, 1);  /* pop metatable */
 }
 
+/**
+ * Task state.
+ */
+typedef enum {
+    LCORE_TASK_RUNNING,
+    LCORE_TASK_DONE,
+    LCORE_TASK_FAILED,
+} lcore_task_state;
+
+#define LCORE_TASK_UV_MQ 1      /* message queue on which the joiners wait */
+#define LCORE_TASK_UV_RESULT 2  /* array of the results, or the error object */
+
+/**
+ * Task object context.
+ *
+ * The task runs in its own coroutine, the joiners are woken up through
+ * the receivers of the message queue when the task finishes.
+ */
+typedef struct {
+    lcore_task_state state;
+    int nres;       /* Number of results. */
+    bool joined;    /* Whether the result has been taken by a joiner. */
+} lcore_task;
+
+static int lcore_task_finish(lua_State *L, int status, lua_KContext extra) {
+    // stack: task, traceback, results... or error object
+    lcore_task *task = lua_touserdata(L, 1);
+    if (status == LUA_OK || status == LUA_YIELD) {
+        int n = lua_gettop(L) - 2;
+        lua_createtable(L, n, 0);
+        lua_insert(L, 3);
+        for (int i = n; i >= 1; i--) {
+            lua_rawseti(L, 3, i);
+        }
+        task->state = LCORE_TASK_DONE;
+        task->nres = n;
+    } else {
+        task->state = LCORE_TASK_FAILED;
+    }
+    lua_setiuservalue(L, 1, LCORE_TASK_UV_RESULT);
+
+    // Wake up all the joiners.
+    lua_getiuservalue(L, 1, LCORE_TASK_UV_MQ);
+    lua_replace(L, 1);
+    lua_settop(L, 1);
+    lcore_mq *mq = lua_touserdata(L, 1);
+    while (mq->recvers.head) {
+        lcore_mq_push(L, mq);
+    }
+    return 0;
+}
+
+// lcore_task_main(task, func, ...)
+static int lcore_task_main(lua_State *L) {
+    lc_pushtraceback(L);
+    lua_insert(L, 2);
+    int status = lua_pcallk(L, lua_gettop(L) - 3, LUA_MULTRET, 2, 0, lcore_task_finish);
+    return lcore_task_finish(L, status, 0);
+}
+
+static int lcore_spawn(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+
+    int n = lua_gettop(L);
+    lcore_task *task = lua_newuserdatauv(L, sizeof(*task), 2);
+    luaL_setmetatable(L, LUA_TASK_NAME);
+    HAPRawBufferZero(task, sizeof(*task));
+    task->state = LCORE_TASK_RUNNING;
+    lua_pushcfunction(L, lcore_create_mq);
+    lua_pushinteger(L, 1);
+    lua_call(L, 1, 1);
+    lua_setiuservalue(L, -2, LCORE_TASK_UV_MQ);
+    lua_insert(L, 1);  // put the task at index 1
+
+    lua_State *co = lc_newthread(L);
+    if (luai_unlikely(!lua_checkstack(co, n + 2))) {
+        luaL_error(L, "stack overflow");
+    }
+    lua_pushcfunction(co, lcore_task_main);
+    for (int i = 1; i <= n + 1; i++) {
+        lua_pushvalue(L, i);
+    }
+    lua_xmove(L, co, n + 1);
+
+    // Run the task until it waits for the first time.
+    int nres;
+    int status = lc_resume(co, L, n + 1, &nres);
+    switch (status) {
+    case LUA_OK:
+        lua_pop(L, nres);
+        break;
+    case LUA_YIELD:
+        lua_pop(co, nres);
+        break;
+    default:
+        lua_error(L);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+static int lcore_task_join_finish(lua_State *L, int status, lua_KContext extra) {
+    // stack: message queue, task
+    lcore_task *task = lua_touserdata(L, 2);
+    if (task->state == LCORE_TASK_RUNNING) {
+        lcore_mq *mq = lua_touserdata(L, 1);
+        lcore_mq_wait(L, mq, &mq->recvers);
+        return lua_yieldk(L, 0, 0, lcore_task_join_finish);
+    }
+
+    task->joined = true;
+    lua_settop(L, 2);
+    lua_getiuservalue(L, 2, LCORE_TASK_UV_RESULT);
+    if (task->state == LCORE_TASK_FAILED) {
+        return lua_error(L);
+    }
+    if (luai_unlikely(!lua_checkstack(L, task->nres))) {
+        luaL_error(L, "too many results to join");
+    }
+    for (int i = 1; i <= task->nres; i++) {
+        lua_rawgeti(L, 3, i);
+    }
+    return task->nres;
+}
+
+static int lcore_task_join(lua_State *L) {
+    lcore_task *task = luaL_checkudata(L, 1, LUA_TASK_NAME);
+    if (task->state == LCORE_TASK_RUNNING && luai_unlikely(!lua_isyieldable(L))) {
+        luaL_error(L, "attempt to join a task outside a coroutine");
+    }
+    lua_settop(L, 1);
+    lua_getiuservalue(L, 1, LCORE_TASK_UV_MQ);
+    lua_insert(L, 1);
+    return lcore_task_join_finish(L, LUA_OK, 0);
+}
+
+static int lcore_task_done(lua_State *L) {
+    lcore_task *task = luaL_checkudata(L, 1, LUA_TASK_NAME);
+    lua_pushboolean(L, task->state != LCORE_TASK_RUNNING);
+    return 1;
+}
+
+static int lcore_task_gc(lua_State *L) {
+    lcore_task *task = luaL_checkudata(L, 1, LUA_TASK_NAME);
+    if (task->state == LCORE_TASK_FAILED && !task->joined) {
+        lua_getiuservalue(L, 1, LCORE_TASK_UV_RESULT);
+        const char *err = lua_tostring(L, -1);
+        HAPLogError(&lcore_log, "%s: Unjoined task failed: %s", __func__,
+            err ? err : "(error object is not a string)");
+    }
+    return 0;
+}
+
+static int lcore_task_tostring(lua_State *L) {
+    lcore_task *task = luaL_checkudata(L, 1, LUA_TASK_NAME);
+    static const char *states[] = {
+        [LCORE_TASK_RUNNING] = "running",
+        [LCORE_TASK_DONE] = "done",
+        [LCORE_TASK_FAILED] = "failed",
+    };
+    lua_pushfstring(L, "task (%s) (%p)", states[task->state], task);
+    return 1;
+}
+
+/*
+ * metamethods for task object
+ */
+static const luaL_Reg lcore_task_metameth[] = {
+    {"__index", NULL},  /* place holder */
+    {"__gc", lcore_task_gc},
+    {"__tostring", lcore_task_tostring},
+    {NULL, NULL}
+};
+
+/*
+ * methods for task object
+ */
+static const luaL_Reg lcore_task_meth[] = {
+    {"join", lcore_task_join},
+    {"done", lcore_task_done},
+    {NULL, NULL},
+};
+
+static void lcore_task_createmeta(lua_State *L) {
+    luaL_newmetatable(L, LUA_TASK_NAME);  /* metatable for task object */
+    luaL_setfuncs(L, lcore_task_metameth, 0);  /* add metamethods to new metatable */
+    luaL_newlibtable(L, lcore_task_meth);  /* create method table */
+    luaL_setfuncs(L, lcore_task_meth, 0);  /* add task object methods to method table */
+    lua_setfield(L, -2, "__index");  /* metatable.__index = method table */
+    lua_pop(L, 1);  /* pop metatable */
+}
+
 static const luaL_Reg lcore_funcs[] = {
     {"time", lcore_time},
     {"exit", lcore_exit},
     {"atexit", lcore_atexit},
     {"sleep", lcore_sleep},
     {"createTimer", lcore_create_timer},
+    {"setTimerTolerance", lcore_set_timer_tolerance},
     {"createMQ", lcore_create_mq},
+    {"spawn", lcore_spawn},
+    {"setGCConfig", lcore_set_gc_config},
+    {"getGCStats", lcore_get_gc_stats},
+    {"setThreadPoolConfig", lcore_set_thread_pool_config},
+    {"getThreadPoolStats", lcore_get_thread_pool_stats},
+    {"getHeapStats", lcore_get_heap_stats},
+    {"setHeapConfig", lcore_set_heap_config},
+    {"getHeapUsage", lcore_get_heap_usage},
+    {"setHeapOwner", lcore_set_heap_owner},
     {NULL, NULL},
 };
 
 LUAMOD_API int luaopen_core(lua_State *L) {
+    lcore_tw_reset(&gv_lcore_tw);
     luaL_newlib(L, lcore_funcs);
     lcore_timer_createmeta(L);
     lcore_mq_createmeta(L);
+    lcore_task_createmeta(L);
     return 1;
 }
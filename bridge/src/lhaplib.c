@@ -4,6 +4,8 @@
 // you may not use this file except in compliance with the License.
 // See [CONTRIBUTORS.md] for the list of homekit-bridge project authors.
 
+#include <stdlib.h>
+#include <string.h>
 #include <lualib.h>
 #include <lauxlib.h>
 #include <pal/hap.h>
@@ -16,7 +18,13 @@
 #include "app_int.h"
 #include "lc.h"
 
-#define LHAP_READ_REQUESTS_MAX 32
+/**
+ * Default configuration of the read scheduler.
+ */
+#define LHAP_READS_MAX_DFT ((size_t) 32)
+#define LHAP_ACC_READS_MAX_DFT ((size_t) 4)
+#define LHAP_READ_REQUESTS_MAX_DFT ((size_t) 128)
+#define LHAP_FOREGROUND_TIMEOUT_DFT ((HAPTime) 10000)
 
 #define lhap_optfunction(L, n) luaL_opt(L, lhap_checkfunction, n, false)
 #define lhap_optarray(L, n) luaL_opt(L, lhap_checkarray, n, 0)
@@ -520,47 +528,50 @@ typedef struct lhap_service_type {
 #define LHAP_SERVICE_TYPE_FORMAT(type) \
     { #type, &kHAPServiceType_##type, kHAPServiceDebugDescription_##type }
 
+/**
+ * Service types, sorted by name.
+ */
 static const lhap_service_type lhap_service_type_tab[] = {
     LHAP_SERVICE_TYPE_FORMAT(AccessoryInformation),
-    LHAP_SERVICE_TYPE_FORMAT(GarageDoorOpener),
-    LHAP_SERVICE_TYPE_FORMAT(LightBulb),
-    LHAP_SERVICE_TYPE_FORMAT(LockManagement),
-    LHAP_SERVICE_TYPE_FORMAT(LockMechanism),
-    LHAP_SERVICE_TYPE_FORMAT(Outlet),
-    LHAP_SERVICE_TYPE_FORMAT(Switch),
-    LHAP_SERVICE_TYPE_FORMAT(Thermostat),
-    LHAP_SERVICE_TYPE_FORMAT(Pairing),
-    LHAP_SERVICE_TYPE_FORMAT(SecuritySystem),
+    LHAP_SERVICE_TYPE_FORMAT(AirPurifier),
+    LHAP_SERVICE_TYPE_FORMAT(AirQualitySensor),
+    LHAP_SERVICE_TYPE_FORMAT(BatteryService),
+    LHAP_SERVICE_TYPE_FORMAT(CameraRTPStreamManagement),
+    LHAP_SERVICE_TYPE_FORMAT(CarbonDioxideSensor),
     LHAP_SERVICE_TYPE_FORMAT(CarbonMonoxideSensor),
     LHAP_SERVICE_TYPE_FORMAT(ContactSensor),
     LHAP_SERVICE_TYPE_FORMAT(Door),
+    LHAP_SERVICE_TYPE_FORMAT(Fan),
+    LHAP_SERVICE_TYPE_FORMAT(Faucet),
+    LHAP_SERVICE_TYPE_FORMAT(FilterMaintenance),
+    LHAP_SERVICE_TYPE_FORMAT(GarageDoorOpener),
+    LHAP_SERVICE_TYPE_FORMAT(HAPProtocolInformation),
+    LHAP_SERVICE_TYPE_FORMAT(HeaterCooler),
+    LHAP_SERVICE_TYPE_FORMAT(HumidifierDehumidifier),
     LHAP_SERVICE_TYPE_FORMAT(HumiditySensor),
+    LHAP_SERVICE_TYPE_FORMAT(IrrigationSystem),
     LHAP_SERVICE_TYPE_FORMAT(LeakSensor),
+    LHAP_SERVICE_TYPE_FORMAT(LightBulb),
     LHAP_SERVICE_TYPE_FORMAT(LightSensor),
+    LHAP_SERVICE_TYPE_FORMAT(LockManagement),
+    LHAP_SERVICE_TYPE_FORMAT(LockMechanism),
+    LHAP_SERVICE_TYPE_FORMAT(Microphone),
     LHAP_SERVICE_TYPE_FORMAT(MotionSensor),
     LHAP_SERVICE_TYPE_FORMAT(OccupancySensor),
+    LHAP_SERVICE_TYPE_FORMAT(Outlet),
+    LHAP_SERVICE_TYPE_FORMAT(Pairing),
+    LHAP_SERVICE_TYPE_FORMAT(SecuritySystem),
+    LHAP_SERVICE_TYPE_FORMAT(ServiceLabel),
+    LHAP_SERVICE_TYPE_FORMAT(Slat),
     LHAP_SERVICE_TYPE_FORMAT(SmokeSensor),
+    LHAP_SERVICE_TYPE_FORMAT(Speaker),
     LHAP_SERVICE_TYPE_FORMAT(StatelessProgrammableSwitch),
+    LHAP_SERVICE_TYPE_FORMAT(Switch),
     LHAP_SERVICE_TYPE_FORMAT(TemperatureSensor),
+    LHAP_SERVICE_TYPE_FORMAT(Thermostat),
+    LHAP_SERVICE_TYPE_FORMAT(Valve),
     LHAP_SERVICE_TYPE_FORMAT(Window),
     LHAP_SERVICE_TYPE_FORMAT(WindowCovering),
-    LHAP_SERVICE_TYPE_FORMAT(AirQualitySensor),
-    LHAP_SERVICE_TYPE_FORMAT(BatteryService),
-    LHAP_SERVICE_TYPE_FORMAT(CarbonDioxideSensor),
-    LHAP_SERVICE_TYPE_FORMAT(HAPProtocolInformation),
-    LHAP_SERVICE_TYPE_FORMAT(Fan),
-    LHAP_SERVICE_TYPE_FORMAT(Slat),
-    LHAP_SERVICE_TYPE_FORMAT(FilterMaintenance),
-    LHAP_SERVICE_TYPE_FORMAT(AirPurifier),
-    LHAP_SERVICE_TYPE_FORMAT(HeaterCooler),
-    LHAP_SERVICE_TYPE_FORMAT(HumidifierDehumidifier),
-    LHAP_SERVICE_TYPE_FORMAT(ServiceLabel),
-    LHAP_SERVICE_TYPE_FORMAT(IrrigationSystem),
-    LHAP_SERVICE_TYPE_FORMAT(Valve),
-    LHAP_SERVICE_TYPE_FORMAT(Faucet),
-    LHAP_SERVICE_TYPE_FORMAT(CameraRTPStreamManagement),
-    LHAP_SERVICE_TYPE_FORMAT(Microphone),
-    LHAP_SERVICE_TYPE_FORMAT(Speaker),
 };
 
 typedef struct lhap_characteristic_type {
@@ -576,120 +587,123 @@ typedef struct lhap_characteristic_type {
     kHAPCharacteristicDebugDescription_##type, \
 }
 
+/**
+ * Characteristic types, sorted by name.
+ */
 static const lhap_characteristic_type lhap_characteristic_type_tab[] = {
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ADKVersion),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(AccessoryFlags),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(Active),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ActiveIdentifier),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(AdministratorOnlyAccess),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(AirParticulateDensity),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(AirParticulateSize),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(AirQuality),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(AudioFeedback),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(BatteryLevel),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(Brightness),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonDioxideDetected),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonDioxideLevel),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonDioxidePeakLevel),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonMonoxideDetected),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonMonoxideLevel),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonMonoxidePeakLevel),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ChargingState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ColorTemperature),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ContactSensorState),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(CoolingThresholdTemperature),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentAirPurifierState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentAmbientLightLevel),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentDoorState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentFanState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentHeaterCoolerState),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentHeatingCoolingState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentHorizontalTiltAngle),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentHumidifierDehumidifierState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentPosition),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentRelativeHumidity),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentSlatState),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentTemperature),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentTiltAngle),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentVerticalTiltAngle),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(FilterChangeIndication),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(FilterLifeLevel),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(FirmwareRevision),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(HardwareRevision),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(HeatingThresholdTemperature),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(HoldPosition),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(Hue),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(Identify),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(InUse),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(IsConfigured),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(LeakDetected),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(LockControlPoint),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(LockManagementAutoSecurityTimeout),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(LockLastKnownAction),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(LockCurrentState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(LockLastKnownAction),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(LockManagementAutoSecurityTimeout),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(LockPhysicalControls),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(LockTargetState),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(Logs),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(Manufacturer),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(Model),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(MotionDetected),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(Name),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(NitrogenDioxideDensity),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(ObstructionDetected),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(OccupancyDetected),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(On),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(OutletInUse),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(RotationDirection),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(RotationSpeed),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(Saturation),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SerialNumber),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetDoorState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetHeatingCoolingState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetRelativeHumidity),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetTemperature),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TemperatureDisplayUnits),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(Version),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(OzoneDensity),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(PM10Density),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(PM2_5Density),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(PairSetup),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(PairVerify),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(PairingFeatures),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(PairingPairings),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(FirmwareRevision),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(HardwareRevision),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(AirParticulateDensity),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(AirParticulateSize),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SecuritySystemCurrentState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SecuritySystemTargetState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(BatteryLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonMonoxideDetected),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ContactSensorState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentAmbientLightLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentHorizontalTiltAngle),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentPosition),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentVerticalTiltAngle),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(HoldPosition),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(LeakDetected),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(OccupancyDetected),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(PositionState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ProgramMode),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(ProgrammableSwitchEvent),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(StatusActive),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(RelativeHumidityDehumidifierThreshold),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(RelativeHumidityHumidifierThreshold),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(RemainingDuration),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ResetFilterIndication),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(RotationDirection),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(RotationSpeed),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(Saturation),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SecuritySystemAlarmType),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SecuritySystemCurrentState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SecuritySystemTargetState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SerialNumber),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ServiceLabelIndex),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ServiceLabelNamespace),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(ServiceSignature),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SetDuration),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SlatType),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(SmokeDetected),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(StatusActive),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(StatusFault),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(StatusJammed),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(StatusLowBattery),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(StatusTampered),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetHorizontalTiltAngle),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetPosition),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetVerticalTiltAngle),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SecuritySystemAlarmType),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ChargingState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonMonoxideLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonMonoxidePeakLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonDioxideDetected),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonDioxideLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CarbonDioxidePeakLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(AirQuality),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ServiceSignature),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(AccessoryFlags),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(LockPhysicalControls),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SulphurDioxideDensity),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(SwingMode),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetAirPurifierState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentAirPurifierState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentSlatState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(FilterLifeLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(FilterChangeIndication),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ResetFilterIndication),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentFanState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(Active),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentHeaterCoolerState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetDoorState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetFanState),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetHeaterCoolerState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentHumidifierDehumidifierState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetHeatingCoolingState),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetHorizontalTiltAngle),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetHumidifierDehumidifierState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(WaterLevel),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SwingMode),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetFanState),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SlatType),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(CurrentTiltAngle),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetPosition),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetRelativeHumidity),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetTemperature),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetTiltAngle),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(OzoneDensity),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(NitrogenDioxideDensity),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SulphurDioxideDensity),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(PM2_5Density),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(PM10Density),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TargetVerticalTiltAngle),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(TemperatureDisplayUnits),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(VOCDensity),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(RelativeHumidityDehumidifierThreshold),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(RelativeHumidityHumidifierThreshold),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ServiceLabelIndex),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ServiceLabelNamespace),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ColorTemperature),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ProgramMode),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(InUse),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(SetDuration),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(RemainingDuration),
     LHAP_CHARACTERISTIC_TYPE_FORMAT(ValveType),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(IsConfigured),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ActiveIdentifier),
-    LHAP_CHARACTERISTIC_TYPE_FORMAT(ADKVersion),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(Version),
+    LHAP_CHARACTERISTIC_TYPE_FORMAT(WaterLevel),
 };
 
 #if LUA_MAXINTEGER < UINT32_MAX
@@ -711,6 +725,52 @@ static const struct lhap_char_integer_val_range {
 
 typedef struct lhap_desc lhap_desc;
 
+union lhap_char_value {
+    bool boolean;
+    lua_Integer integer;
+    lua_Number number;
+    struct {
+        const char *data;
+        size_t len;
+    } str;
+};
+
+/**
+ * Characteristic value cache.
+ *
+ * The cached value is stored in the registry, and the key is the pointer of the cache.
+ */
+typedef struct lhap_char_cache {
+    bool valid;         /* Whether the cached value is valid. */
+    HAPTime ttl;        /* Time to live in milliseconds, 0 means the cache is disabled. */
+    HAPTime expire;     /* Expiration time of the cached value. */
+    size_t hits;        /* Number of reads served from the cache. */
+    size_t misses;      /* Number of reads passed to the Lua read handler. */
+} lhap_char_cache;
+
+/**
+ * Value pushed by Lua with ``characteristic:setValue()``.
+ *
+ * While the value is valid, reads are served from it without calling the read handler,
+ * the value is stored in the registry, and the key is the pointer of the slot.
+ */
+typedef struct lhap_char_slot {
+    bool valid;         /* Whether a value is pushed. */
+    size_t hits;        /* Number of reads served from the pushed value. */
+} lhap_char_slot;
+
+/**
+ * Extra state of the characteristic created by Lua,
+ * it is placed after the characteristic structure.
+ */
+typedef struct lhap_char_ext {
+    lhap_char_cache cache;
+    lhap_char_slot slot;
+    struct lhap_attr *attr; /* Attribute in the database, NULL if the server is not started. */
+    bool reading;       /* Whether a read is in progress in Lua. */
+    struct lhap_read_request *waiters;  /* Read requests waiting for the result of the read in progress. */
+} lhap_char_ext;
+
 typedef struct lhap_read_request {
     lhap_desc *desc;
     HAPTransportType transportType;
@@ -719,9 +779,133 @@ typedef struct lhap_read_request {
     const HAPService *service;
     const HAPBaseCharacteristic *characteristic;
     const void *pfunc;
+    HAPTime time;       /* Time when the request is queued. */
     struct lhap_read_request *next;
 } lhap_read_request;
 
+/**
+ * Priority of the queued read requests.
+ */
+typedef enum {
+    LHAP_READ_PRIO_FOREGROUND,  /* Requests from the controller in the foreground. */
+    LHAP_READ_PRIO_BACKGROUND,  /* Other requests. */
+    LHAP_READ_PRIO_MAX,
+} lhap_read_prio;
+
+typedef struct lhap_read_queue {
+    lhap_read_request *head;
+    lhap_read_request **ptail;
+} lhap_read_queue;
+
+/**
+ * Extra state of the accessory created by Lua,
+ * it is placed after the accessory structure.
+ */
+typedef struct lhap_accessory_ext {
+    int owner;              /* Heap owner of the callbacks, it is the owner of the creator. */
+    bool has_read_batch;    /* Whether the accessory has a batch read callback. */
+    bool batching;          /* Whether the accessory is in the list of pending batches. */
+    lhap_read_queue batch;  /* Read requests of the pending batch. */
+    struct lhap_accessory_ext *batch_next;
+    lhap_read_queue queues[LHAP_READ_PRIO_MAX];     /* Queued read requests. */
+    bool ready[LHAP_READ_PRIO_MAX];                 /* Whether the accessory is in the ready list. */
+    struct lhap_accessory_ext *next[LHAP_READ_PRIO_MAX];
+    size_t num_reads;   /* Number of reads in progress. */
+} lhap_accessory_ext;
+
+typedef struct lhap_read_stats {
+    size_t queued;      /* Number of requests in the queues. */
+    size_t peak_queued; /* Peak number of requests in the queues. */
+    size_t peak_reads;  /* Peak number of reads in progress. */
+    size_t dispatched;  /* Number of queued requests that have been dispatched. */
+    size_t coalesced;   /* Number of requests attached to a read in progress. */
+    size_t rejected;    /* Number of requests rejected because the pool is exhausted. */
+    HAPTime total_wait; /* Total time the dispatched requests spent in the queues. */
+    HAPTime max_wait;   /* Maximum time a dispatched request spent in the queues. */
+} lhap_read_stats;
+
+/**
+ * Read scheduler.
+ *
+ * Reads exceeding the limits are queued per accessory, and the accessories
+ * with queued requests are dispatched in a round-robin way, so that a slow
+ * accessory only blocks its own reads. Requests from the controller in the
+ * foreground are dispatched first.
+ */
+typedef struct lhap_read_sched {
+    size_t max_reads;       /* Maximum number of reads in progress. */
+    size_t max_acc_reads;   /* Maximum number of reads in progress per accessory. */
+    size_t max_requests;    /* Size of the request pool. */
+    HAPTime fg_timeout;     /* How long a controller stays in the foreground after a write. */
+
+    HAPSessionRef *fg_session;
+    HAPTime fg_time;
+
+    lhap_read_request *pool;
+    lhap_read_request *free;
+    unsigned int gen;       /* Generation of the pool, increased at stop to orphan the reads in progress. */
+    size_t num_reads;
+    lhap_accessory_ext *ready_head[LHAP_READ_PRIO_MAX];
+    lhap_accessory_ext **ready_ptail[LHAP_READ_PRIO_MAX];
+    HAPPlatformTimerRef timer;
+    lhap_accessory_ext *batch_head;     /* Accessories with pending batches. */
+    lhap_accessory_ext **batch_ptail;
+    HAPPlatformTimerRef batch_timer;
+    lhap_read_stats stats;
+} lhap_read_sched;
+
+/**
+ * Entry of a characteristic created by Lua in the characteristic index.
+ */
+typedef struct lhap_attr {
+    uint64_t aid;
+    uint64_t iid;
+    const HAPService *service;
+    const HAPBaseCharacteristic *characteristic;
+    bool event_pending;             /* Whether an event is pending in the coalescing window. */
+    HAPSessionRef *event_session;   /* The session on which to raise the pending event, NULL means all sessions. */
+    struct lhap_attr *event_next;
+} lhap_attr;
+
+typedef struct lhap_db_stats {
+    size_t num_accessories;
+    size_t num_services;    /* Number of services created by Lua. */
+    size_t num_chars;       /* Number of characteristics created by Lua. */
+    size_t index_size;      /* Size in bytes of the index. */
+} lhap_db_stats;
+
+/**
+ * Index of the characteristics created by Lua, built when the server is started.
+ *
+ * It only serves the characteristic lookups of hap.raiseEvent() and hap.raiseEvents(),
+ * the /accessories document is still serialized by the ADK from the accessory graph.
+ */
+typedef struct lhap_db {
+    lhap_attr *attrs;       /* Attributes sorted by (aid, iid). */
+    size_t num_attrs;
+    lhap_db_stats stats;
+} lhap_db;
+
+/**
+ * Configuration of the IP accessory server storage.
+ */
+typedef struct lhap_ip_config {
+    size_t num_sessions;        /* Maximum number of concurrent sessions. */
+    size_t inbound_bufsize;     /* Size of the inbound buffer of a session. */
+    size_t outbound_bufsize;    /* Size of the outbound buffer of a session. */
+    size_t scratch_bufsize;     /* Size of the scratch buffer of a session. */
+} lhap_ip_config;
+
+/**
+ * Memory in bytes used by the IP accessory server storage.
+ */
+typedef struct lhap_ip_storage_stats {
+    size_t sessions;
+    size_t buffers;
+    size_t contexts;
+    size_t notifications;
+} lhap_ip_storage_stats;
+
 typedef struct lhap_desc {
     bool started;
 
@@ -736,15 +920,31 @@ typedef struct lhap_desc {
     HAPAccessoryServerOptions server_options;
     HAPAccessoryServerCallbacks server_cbs;
 
-    HAPPlatformTimerRef read_requests_timer;
-    lhap_read_request *read_requests_head;
-    lhap_read_request **read_requests_ptail;
-    size_t num_read_requests;
-    size_t max_read_requests;
+    lhap_read_sched read_sched;
+    lhap_ip_config ip_config;
+    lhap_ip_storage_stats ip_stats;
+    lhap_db db;
+
+    HAPTime event_window;       /* Coalescing window of events in milliseconds, 0 means no coalescing. */
+    HAPPlatformTimerRef event_timer;
+    lhap_attr *events_head;     /* Pending events. */
+    lhap_attr **events_ptail;
 } lhap_desc;
 
 static lhap_desc gv_lhap_desc;
 
+static inline lhap_char_ext *lhap_char_get_ext(const HAPBaseCharacteristic *characteristic) {
+    return (lhap_char_ext *)((uintptr_t)characteristic + lhap_characteristic_struct_size[characteristic->format]);
+}
+
+static inline lhap_accessory_ext *lhap_accessory_get_ext(const HAPAccessory *accessory) {
+    return (lhap_accessory_ext *)((uintptr_t)accessory + sizeof(HAPAccessory));
+}
+
+static inline const HAPAccessory *lhap_accessory_from_ext(const lhap_accessory_ext *ext) {
+    return (const HAPAccessory *)((uintptr_t)ext - sizeof(HAPAccessory));
+}
+
 static bool lhap_checkfunction(lua_State *L, int arg) {
     luaL_checktype(L, arg, LUA_TFUNCTION);
     return true;
@@ -756,21 +956,24 @@ static size_t lhap_checkarray(lua_State *L, int arg) {
 }
 
 static void
-lhap_init_ip(HAPAccessoryServerOptions *options, size_t num_contexts, size_t num_notify) {
+lhap_init_ip(HAPAccessoryServerOptions *options, const lhap_ip_config *config,
+    size_t num_contexts, size_t num_notify, lhap_ip_storage_stats *stats) {
     HAPPrecondition(options);
+    HAPPrecondition(config);
     HAPPrecondition(num_contexts);
     HAPPrecondition(num_notify);
+    HAPPrecondition(stats);
 
     static HAPIPAccessoryServerStorage serverStorage;
 
-    size_t num_sessions = PAL_HAP_IP_SESSION_STORAGE_NUM_ELEMENTS;
+    size_t num_sessions = config->num_sessions;
     HAPIPSession *sessions = pal_mem_alloc(sizeof(HAPIPSession) * num_sessions);
     HAPAssert(sessions);
-    char *inbounds = pal_mem_alloc(PAL_HAP_IP_SESSION_STORAGE_INBOUND_BUFSIZE * num_sessions);
+    char *inbounds = pal_mem_alloc(config->inbound_bufsize * num_sessions);
     HAPAssert(inbounds);
-    char *outbounds = pal_mem_alloc(PAL_HAP_IP_SESSION_STORAGE_OUTBOUND_BUFSIZE * num_sessions);
+    char *outbounds = pal_mem_alloc(config->outbound_bufsize * num_sessions);
     HAPAssert(outbounds);
-    char *scratches = pal_mem_alloc(PAL_HAP_IP_SESSION_STORAGE_SCRATCH_BUFSIZE * num_sessions);
+    char *scratches = pal_mem_alloc(config->scratch_bufsize * num_sessions);
     HAPAssert(scratches);
     HAPIPCharacteristicContextRef *contexts =
         pal_mem_alloc(sizeof(HAPIPCharacteristicContextRef) * num_contexts * num_sessions);
@@ -779,12 +982,12 @@ lhap_init_ip(HAPAccessoryServerOptions *options, size_t num_contexts, size_t num
         pal_mem_alloc(sizeof(HAPIPEventNotificationRef) * num_notify * num_sessions);
     HAPAssert(eventNotifications);
     for (size_t i = 0; i < num_sessions; i++) {
-        sessions[i].inboundBuffer.bytes = inbounds + PAL_HAP_IP_SESSION_STORAGE_INBOUND_BUFSIZE * i;
-        sessions[i].inboundBuffer.numBytes = PAL_HAP_IP_SESSION_STORAGE_INBOUND_BUFSIZE;
-        sessions[i].outboundBuffer.bytes = outbounds + PAL_HAP_IP_SESSION_STORAGE_OUTBOUND_BUFSIZE * i;
-        sessions[i].outboundBuffer.numBytes = PAL_HAP_IP_SESSION_STORAGE_OUTBOUND_BUFSIZE;
-        sessions[i].scratchBuffer.bytes = scratches + PAL_HAP_IP_SESSION_STORAGE_SCRATCH_BUFSIZE * i;
-        sessions[i].scratchBuffer.numBytes = PAL_HAP_IP_SESSION_STORAGE_SCRATCH_BUFSIZE;
+        sessions[i].inboundBuffer.bytes = inbounds + config->inbound_bufsize * i;
+        sessions[i].inboundBuffer.numBytes = config->inbound_bufsize;
+        sessions[i].outboundBuffer.bytes = outbounds + config->outbound_bufsize * i;
+        sessions[i].outboundBuffer.numBytes = config->outbound_bufsize;
+        sessions[i].scratchBuffer.bytes = scratches + config->scratch_bufsize * i;
+        sessions[i].scratchBuffer.numBytes = config->scratch_bufsize;
         sessions[i].contexts = contexts + num_contexts * i;
         sessions[i].numContexts = num_contexts;
         sessions[i].eventNotifications = eventNotifications + num_notify * i;
@@ -793,6 +996,16 @@ lhap_init_ip(HAPAccessoryServerOptions *options, size_t num_contexts, size_t num
     serverStorage.sessions = sessions;
     serverStorage.numSessions = num_sessions;
 
+    stats->sessions = sizeof(HAPIPSession) * num_sessions;
+    stats->buffers = (config->inbound_bufsize + config->outbound_bufsize + config->scratch_bufsize) * num_sessions;
+    stats->contexts = sizeof(HAPIPCharacteristicContextRef) * num_contexts * num_sessions;
+    stats->notifications = sizeof(HAPIPEventNotificationRef) * num_notify * num_sessions;
+    HAPLog(&lhap_log, "IP server storage: %zu sessions, %zu bytes "
+        "(sessions: %zu, buffers: %zu, contexts: %zu, notifications: %zu), %zu bytes per session.",
+        num_sessions, stats->sessions + stats->buffers + stats->contexts + stats->notifications,
+        stats->sessions, stats->buffers, stats->contexts, stats->notifications,
+        (stats->sessions + stats->buffers + stats->contexts + stats->notifications) / num_sessions);
+
     options->ip.transport = &kHAPAccessoryServerTransport_IP;
     options->ip.accessoryServerStorage = &serverStorage;
 }
@@ -837,43 +1050,51 @@ lhap_tointegerx(lua_State *L, int idx, int *isnum, HAPCharacteristicFormat forma
     return num;
 }
 
+/**
+ * Callback data of the characteristic properties.
+ */
+typedef struct lhap_char_props_ctx {
+    HAPCharacteristicProperties *props;
+    lhap_char_ext *ext;
+} lhap_char_props_ctx;
+
 static bool lhap_char_props_readable_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->readable = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->readable = lua_toboolean(L, -1);
     return true;
 }
 
 static bool lhap_char_props_writable_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->writable = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->writable = lua_toboolean(L, -1);
     return true;
 }
 
 static bool lhap_char_props_support_evt_notify_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->supportsEventNotification = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->supportsEventNotification = lua_toboolean(L, -1);
     return true;
 }
 
 static bool lhap_char_props_hidden_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->hidden = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->hidden = lua_toboolean(L, -1);
     return true;
 }
 
 static bool lhap_char_props_read_req_admin_pms_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->readRequiresAdminPermissions = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->readRequiresAdminPermissions = lua_toboolean(L, -1);
     return true;
 }
 
 static bool lhap_char_props_write_req_admin_pms_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->writeRequiresAdminPermissions = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->writeRequiresAdminPermissions = lua_toboolean(L, -1);
     return true;
 }
 
 static bool lhap_char_props_req_timed_write_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->requiresTimedWrite = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->requiresTimedWrite = lua_toboolean(L, -1);
     return true;
 }
 
 static bool lhap_char_props_support_auth_data_cb(lua_State *L, void *arg) {
-    ((HAPCharacteristicProperties *)arg)->supportsAuthorizationData = lua_toboolean(L, -1);
+    ((lhap_char_props_ctx *)arg)->props->supportsAuthorizationData = lua_toboolean(L, -1);
     return true;
 }
 
@@ -894,7 +1115,7 @@ static const lc_table_kv lhap_char_props_ip_kvs[] = {
 };
 
 static bool lhap_char_props_ip_cb(lua_State *L, void *arg) {
-    return lc_traverse_table(L, -1, lhap_char_props_ip_kvs, arg);
+    return lc_traverse_table(L, -1, lhap_char_props_ip_kvs, ((lhap_char_props_ctx *)arg)->props);
 }
 
 static bool lhap_char_props_ble_support_bc_notify_cb(lua_State *L, void *arg) {
@@ -946,7 +1167,17 @@ static const lc_table_kv lhap_char_props_ble_kvs[] = {
 };
 
 static bool lhap_char_props_ble_cb(lua_State *L, void *arg) {
-    return lc_traverse_table(L, -1, lhap_char_props_ble_kvs, arg);
+    return lc_traverse_table(L, -1, lhap_char_props_ble_kvs, ((lhap_char_props_ctx *)arg)->props);
+}
+
+static bool lhap_char_props_cache_ttl_cb(lua_State *L, void *arg) {
+    int isnum;
+    lua_Integer ttl = lua_tointegerx(L, -1, &isnum);
+    if (!isnum || ttl < 0) {
+        return false;
+    }
+    ((lhap_char_props_ctx *)arg)->ext->cache.ttl = ttl;
+    return true;
 }
 
 static const lc_table_kv lhap_char_props_kvs[] = {
@@ -960,6 +1191,7 @@ static const lc_table_kv lhap_char_props_kvs[] = {
     {"supportsAuthorizationData", LC_TBOOLEAN, lhap_char_props_support_auth_data_cb},
     {"ip", LC_TTABLE, lhap_char_props_ip_cb},
     {"ble", LC_TTABLE, lhap_char_props_ble_cb},
+    {"cacheTTL", LC_TNUMBER, lhap_char_props_cache_ttl_cb},
     {NULL, LC_TNONE, NULL},
 };
 
@@ -1001,18 +1233,9 @@ typedef struct lhap_call_context {
     const HAPAccessory *accessory;
     const HAPService *service;
     const HAPCharacteristic *characteristic;
+    unsigned int gen;   /* Generation of the read scheduler when the read is started. */
 } lhap_call_context;
 
-union lhap_char_value {
-    bool boolean;
-    lua_Integer integer;
-    lua_Number number;
-    struct {
-        const char *data;
-        size_t len;
-    } str;
-};
-
 static bool lhap_char_value_is_valid(lua_State *L, int idx, HAPCharacteristicFormat format) {
     bool is_valid = false;
     switch (format) {
@@ -1061,6 +1284,125 @@ lhap_char_value_get(lua_State *L, int idx, HAPCharacteristicFormat format, union
     return valid;
 }
 
+/**
+ * Check whether the value at the given index can be served by a read of the characteristic,
+ * it is converted in the same way as the value returned by the read callback,
+ * and must meet the constraints of the characteristic.
+ */
+static bool lhap_char_value_check(lua_State *L, int idx, const HAPBaseCharacteristic *characteristic) {
+    HAPCharacteristicFormat format = characteristic->format;
+    union lhap_char_value val;
+    if (!lhap_char_value_is_valid(L, idx, format) || !lhap_char_value_get(L, idx, format, &val)) {
+        return false;
+    }
+
+#define LHAP_CASE_CHAR_CHECK_RANGE(format, v) \
+    LHAP_CASE_CHAR_FORMAT_CODE(format, characteristic, \
+        valid = v >= p->constraints.minimumValue && v <= p->constraints.maximumValue)
+
+    bool valid = true;
+    switch (format) {
+    LHAP_CASE_CHAR_CHECK_RANGE(UInt8, val.integer)
+    LHAP_CASE_CHAR_CHECK_RANGE(UInt16, val.integer)
+    LHAP_CASE_CHAR_CHECK_RANGE(UInt32, val.integer)
+    LHAP_CASE_CHAR_CHECK_RANGE(UInt64, (uint64_t)val.integer)
+    LHAP_CASE_CHAR_CHECK_RANGE(Int, val.integer)
+    LHAP_CASE_CHAR_CHECK_RANGE(Float, val.number)
+    LHAP_CASE_CHAR_FORMAT_CODE(Data, characteristic, valid = val.str.len <= p->constraints.maxLength)
+    LHAP_CASE_CHAR_FORMAT_CODE(String, characteristic, valid = val.str.len <= p->constraints.maxLength)
+    default:
+        break;
+    }
+
+#undef LHAP_CASE_CHAR_CHECK_RANGE
+
+    return valid;
+}
+
+/**
+ * Push the cached value of the characteristic onto the stack.
+ *
+ * @returns true if the cached value is pushed.
+ */
+static bool lhap_char_cache_get(lua_State *L, const HAPBaseCharacteristic *characteristic) {
+    lhap_char_cache *cache = &lhap_char_get_ext(characteristic)->cache;
+    if (!cache->ttl) {
+        return false;
+    }
+    if (cache->valid && HAPPlatformClockGetCurrent() < cache->expire) {
+        HAPAssert(lua_rawgetp(L, LUA_REGISTRYINDEX, cache) != LUA_TNIL);
+        cache->hits++;
+        return true;
+    }
+    cache->misses++;
+    return false;
+}
+
+/**
+ * Cache the value at the given index.
+ */
+static void lhap_char_cache_set(lua_State *L, int idx, const HAPBaseCharacteristic *characteristic) {
+    lhap_char_cache *cache = &lhap_char_get_ext(characteristic)->cache;
+    if (!cache->ttl) {
+        return;
+    }
+    lua_pushvalue(L, idx);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, cache);
+    cache->valid = true;
+    cache->expire = HAPPlatformClockGetCurrent() + cache->ttl;
+}
+
+static void lhap_char_cache_invalidate(lua_State *L, const HAPBaseCharacteristic *characteristic) {
+    lhap_char_cache *cache = &lhap_char_get_ext(characteristic)->cache;
+    if (cache->valid) {
+        cache->valid = false;
+        lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, cache);
+    }
+}
+
+/**
+ * Push the value pushed by Lua onto the stack.
+ *
+ * @returns true if the value is pushed.
+ */
+static bool lhap_char_slot_get(lua_State *L, const HAPBaseCharacteristic *characteristic) {
+    lhap_char_slot *slot = &lhap_char_get_ext(characteristic)->slot;
+    if (!slot->valid) {
+        return false;
+    }
+    HAPAssert(lua_rawgetp(L, LUA_REGISTRYINDEX, slot) != LUA_TNIL);
+    slot->hits++;
+    return true;
+}
+
+/**
+ * Store the value at the given index into the slot.
+ *
+ * @returns true if the value is changed.
+ */
+static bool lhap_char_slot_set(lua_State *L, int idx, const HAPBaseCharacteristic *characteristic) {
+    lhap_char_slot *slot = &lhap_char_get_ext(characteristic)->slot;
+    idx = lua_absindex(L, idx);
+    bool changed = true;
+    if (slot->valid) {
+        lua_rawgetp(L, LUA_REGISTRYINDEX, slot);
+        changed = !lua_rawequal(L, -1, idx);
+        lua_pop(L, 1);
+    }
+    lua_pushvalue(L, idx);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, slot);
+    slot->valid = true;
+    return changed;
+}
+
+static void lhap_char_slot_reset(lua_State *L, const HAPBaseCharacteristic *characteristic) {
+    lhap_char_slot *slot = &lhap_char_get_ext(characteristic)->slot;
+    if (slot->valid) {
+        slot->valid = false;
+        lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, slot);
+    }
+}
+
 static HAPError lhap_char_response_read_request(
         HAPAccessoryServerRef *server,
         HAPTransportType transportType,
@@ -1125,11 +1467,197 @@ static HAPError lhap_char_response_read_request(
     return err;
 }
 
-static void lhap_schedule_read_requests_cb(HAPPlatformTimerRef timer, void* context);
+static void lhap_schedule_read_requests_cb(HAPPlatformTimerRef timer, void* context);
+
+static lhap_read_request *lhap_read_request_alloc(lhap_read_sched *sched) {
+    lhap_read_request *request = sched->free;
+    if (!request) {
+        sched->stats.rejected++;
+        HAPLogError(&lhap_log, "%s: Too many read requests.", __func__);
+        return NULL;
+    }
+    sched->free = request->next;
+    return request;
+}
+
+static void lhap_read_request_free(lhap_read_sched *sched, lhap_read_request *request) {
+    request->next = sched->free;
+    sched->free = request;
+}
+
+static void lhap_accessory_init_ext(HAPAccessory *accessory) {
+    lhap_accessory_ext *ext = lhap_accessory_get_ext(accessory);
+    int owner = ext->owner;
+    bool has_read_batch = ext->has_read_batch;
+    HAPRawBufferZero(ext, sizeof(*ext));
+    ext->owner = owner;
+    ext->has_read_batch = has_read_batch;
+    ext->batch.ptail = &ext->batch.head;
+    for (int prio = 0; prio < LHAP_READ_PRIO_MAX; prio++) {
+        ext->queues[prio].ptail = &ext->queues[prio].head;
+    }
+}
+
+static void lhap_read_sched_init(lhap_read_sched *sched, HAPAccessory *primary, HAPAccessory **bridged) {
+    sched->free = NULL;
+    for (size_t i = sched->max_requests; i > 0; i--) {
+        lhap_read_request_free(sched, sched->pool + i - 1);
+    }
+    sched->num_reads = 0;
+    sched->fg_session = NULL;
+    for (int prio = 0; prio < LHAP_READ_PRIO_MAX; prio++) {
+        sched->ready_head[prio] = NULL;
+        sched->ready_ptail[prio] = &sched->ready_head[prio];
+    }
+    sched->batch_head = NULL;
+    sched->batch_ptail = &sched->batch_head;
+    HAPRawBufferZero(&sched->stats, sizeof(sched->stats));
+
+    lhap_accessory_init_ext(primary);
+    if (bridged) {
+        for (HAPAccessory **pacc = bridged; *pacc; pacc++) {
+            lhap_accessory_init_ext(*pacc);
+        }
+    }
+}
+
+static lhap_read_prio lhap_read_sched_get_prio(lhap_read_sched *sched, HAPSessionRef *session) {
+    if (sched->fg_session == session && HAPPlatformClockGetCurrent() - sched->fg_time < sched->fg_timeout) {
+        return LHAP_READ_PRIO_FOREGROUND;
+    }
+    return LHAP_READ_PRIO_BACKGROUND;
+}
+
+/**
+ * Put the accessory into the ready list if it has queued requests and it can start a new read.
+ */
+static void lhap_read_sched_set_ready(lhap_read_sched *sched, lhap_accessory_ext *ext, lhap_read_prio prio) {
+    if (ext->ready[prio] || !ext->queues[prio].head || ext->num_reads >= sched->max_acc_reads) {
+        return;
+    }
+    ext->ready[prio] = true;
+    ext->next[prio] = NULL;
+    *(sched->ready_ptail[prio]) = ext;
+    sched->ready_ptail[prio] = &ext->next[prio];
+}
+
+static bool lhap_read_sched_has_ready(lhap_read_sched *sched) {
+    for (int prio = 0; prio < LHAP_READ_PRIO_MAX; prio++) {
+        if (sched->ready_head[prio]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Schedule the dispatching of the queued requests if there is a free slot.
+ */
+static void lhap_read_sched_kick(lhap_desc *desc) {
+    lhap_read_sched *sched = &desc->read_sched;
+    if (sched->timer || sched->num_reads >= sched->max_reads || !lhap_read_sched_has_ready(sched)) {
+        return;
+    }
+    if (HAPPlatformTimerRegister(&sched->timer, HAPPlatformClockGetCurrent(),
+        lhap_schedule_read_requests_cb, desc)) {
+        HAPLogError(&lhap_log, "%s: Failed to register schedule read requests timer.", __func__);
+        HAPFatalError();
+    }
+}
+
+static void lhap_read_sched_enqueue(lhap_read_sched *sched, lhap_read_request *request) {
+    lhap_accessory_ext *ext = lhap_accessory_get_ext(request->accessory);
+    lhap_read_prio prio = lhap_read_sched_get_prio(sched, request->session);
+    request->time = HAPPlatformClockGetCurrent();
+    request->next = NULL;
+    *(ext->queues[prio].ptail) = request;
+    ext->queues[prio].ptail = &request->next;
+    lhap_read_sched_set_ready(sched, ext, prio);
+
+    sched->stats.queued++;
+    if (sched->stats.queued > sched->stats.peak_queued) {
+        sched->stats.peak_queued = sched->stats.queued;
+    }
+}
+
+/**
+ * Pop the next request in round-robin order.
+ */
+static lhap_read_request *lhap_read_sched_dequeue(lhap_read_sched *sched) {
+    for (int prio = 0; prio < LHAP_READ_PRIO_MAX; prio++) {
+        lhap_accessory_ext *ext = sched->ready_head[prio];
+        if (!ext) {
+            continue;
+        }
+        sched->ready_head[prio] = ext->next[prio];
+        if (!sched->ready_head[prio]) {
+            sched->ready_ptail[prio] = &sched->ready_head[prio];
+        }
+        ext->ready[prio] = false;
+
+        lhap_read_queue *queue = &ext->queues[prio];
+        lhap_read_request *request = queue->head;
+        queue->head = request->next;
+        if (!queue->head) {
+            queue->ptail = &queue->head;
+        }
+
+        HAPTime wait = HAPPlatformClockGetCurrent() - request->time;
+        sched->stats.queued--;
+        sched->stats.dispatched++;
+        sched->stats.total_wait += wait;
+        if (wait > sched->stats.max_wait) {
+            sched->stats.max_wait = wait;
+        }
+        return request;
+    }
+    return NULL;
+}
+
+static void lhap_read_sched_begin(lhap_read_sched *sched, const HAPAccessory *accessory) {
+    lhap_accessory_get_ext(accessory)->num_reads++;
+    sched->num_reads++;
+    if (sched->num_reads > sched->stats.peak_reads) {
+        sched->stats.peak_reads = sched->num_reads;
+    }
+}
+
+static void lhap_read_sched_end(lhap_desc *desc, const HAPAccessory *accessory) {
+    lhap_read_sched *sched = &desc->read_sched;
+    lhap_accessory_ext *ext = lhap_accessory_get_ext(accessory);
+    HAPAssert(ext->num_reads > 0 && sched->num_reads > 0);
+    ext->num_reads--;
+    sched->num_reads--;
+    for (int prio = 0; prio < LHAP_READ_PRIO_MAX; prio++) {
+        lhap_read_sched_set_ready(sched, ext, prio);
+    }
+    lhap_read_sched_kick(desc);
+}
+
+/**
+ * Response the read requests waiting for the read in progress with the same result.
+ */
+static void lhap_char_response_waiters(lhap_desc *desc, lhap_char_ext *ext,
+    HAPError result, union lhap_char_value *val) {
+    while (ext->waiters) {
+        lhap_read_request *request = ext->waiters;
+        ext->waiters = request->next;
+        HAPError err = lhap_char_response_read_request(&desc->server, request->transportType,
+            request->session, request->accessory, request->service, request->characteristic, result, val);
+        if (err != kHAPError_None) {
+            HAPLogError(&lhap_log, "%s: Failed to response read request, error code: %d.", __func__, err);
+        }
+        lhap_read_request_free(&desc->read_sched, request);
+    }
+}
 
 int lhap_char_handle_read_finish(lua_State *L, int status, lua_KContext _ctx) {
     lhap_call_context *ctx = (lhap_call_context *)_ctx;
     lhap_desc *desc = ctx->desc;
+    if (ctx->in_progress && ctx->gen != desc->read_sched.gen) {
+        // HAP was stopped during the read, the requests and the characteristic are released.
+        return 0;
+    }
     HAPCharacteristicFormat format = ((HAPBaseCharacteristic *)ctx->characteristic)->format;
     HAPError err = kHAPError_None;
     if (status != LUA_OK && status != LUA_YIELD) {
@@ -1138,33 +1666,31 @@ int lhap_char_handle_read_finish(lua_State *L, int status, lua_KContext _ctx) {
     } else if (!lhap_char_value_is_valid(L, -1, format)) {
         err = kHAPError_InvalidData;
     }
-    if (ctx->in_progress == false) {
-        lua_pushinteger(L, err);
-        return 2;
-    }
     union lhap_char_value val;
     if (err == kHAPError_None) {
         int valid = lhap_char_value_get(L, -1, format, &val);
         if (!valid) {
             err = kHAPError_InvalidData;
+        } else {
+            lhap_char_cache_set(L, -1, ctx->characteristic);
         }
     }
+    if (ctx->in_progress == false) {
+        lua_pushinteger(L, err);
+        return 2;
+    }
+    HAPError result = err;
     err = lhap_char_response_read_request(&desc->server, ctx->transportType, ctx->session,
-        ctx->accessory, ctx->service, ctx->characteristic, err, &val);
+        ctx->accessory, ctx->service, ctx->characteristic, result, &val);
     if (err != kHAPError_None) {
         HAPLogError(&lhap_log, "%s: Failed to response read request, error code: %d.", __func__, err);
     }
-    desc->num_read_requests--;
-    if (desc->num_read_requests == 0) {
-        if (HAPPlatformTimerRegister(
-                &ctx->desc->read_requests_timer,
-                HAPPlatformClockGetCurrent(),
-                lhap_schedule_read_requests_cb,
-                desc)) {
-            HAPLogError(&lhap_log, "%s: Failed to register schedule read requests timer.", __func__);
-            HAPFatalError();
-        }
-    }
+
+    lhap_char_ext *ext = lhap_char_get_ext(ctx->characteristic);
+    ext->reading = false;
+    lhap_char_response_waiters(desc, ext, result, &val);
+
+    lhap_read_sched_end(desc, ctx->accessory);
     lua_pushinteger(L, err);
     return 1;
 }
@@ -1182,6 +1708,7 @@ static int lhap_char_handle_read_pcall(lua_State *L) {
     lua_pop(L, 2);
 
     lua_State *co = lc_newthread(L);
+    lc_setheapowner(co, lhap_accessory_get_ext(_call_ctx->accessory)->owner);
     lua_pushcfunction(co, lhap_char_handle_read);
     lhap_call_context *call_ctx = lua_newuserdata(co, sizeof(*call_ctx));
     *call_ctx = *_call_ctx;
@@ -1202,6 +1729,7 @@ static int lhap_char_handle_read_pcall(lua_State *L) {
         return nres;
     case LUA_YIELD:
         call_ctx->in_progress = true;
+        lhap_char_get_ext(call_ctx->characteristic)->reading = true;
         lua_pushinteger(L, kHAPError_InProgress);
         return 1;
     default:
@@ -1209,6 +1737,16 @@ static int lhap_char_handle_read_pcall(lua_State *L) {
     }
 }
 
+/**
+ * Attach the read request to the read in progress of the same characteristic.
+ */
+static void lhap_char_attach_read_request(lhap_read_sched *sched, lhap_char_ext *ext, lhap_read_request *request) {
+    HAPAssert(ext->reading);
+    request->next = ext->waiters;
+    ext->waiters = request;
+    sched->stats.coalesced++;
+}
+
 static HAP_RESULT_USE_CHECK
 HAPError lhap_char_raw_handleRead(
         bool in_progress,
@@ -1222,7 +1760,7 @@ HAPError lhap_char_raw_handleRead(
     lua_State *L = desc->mL;
     HAPAssert(lua_gettop(L) == 0);
 
-    desc->num_read_requests++;
+    lhap_read_sched_begin(&desc->read_sched, accessory);
 
     lhap_call_context call_ctx = {
         .in_progress = in_progress,
@@ -1232,6 +1770,7 @@ HAPError lhap_char_raw_handleRead(
         .accessory = accessory,
         .service = service,
         .characteristic = characteristic,
+        .gen = desc->read_sched.gen,
     };
 
     lua_pushcfunction(L, lhap_char_handle_read_pcall);
@@ -1240,13 +1779,14 @@ HAPError lhap_char_raw_handleRead(
     int status = lua_pcall(L, 2, LUA_MULTRET, 0);
     if (status != LUA_OK) {
         HAPLogError(&lhap_log, "%s: %s", __func__, lua_tostring(L, -1));
+        lhap_read_sched_end(desc, accessory);
         return kHAPError_Unknown;
     }
     HAPAssert(lua_isinteger(L, -1));
     HAPError err = lua_tointeger(L, -1);
 
     if (!in_progress && err != kHAPError_InProgress) {
-        desc->num_read_requests--;
+        lhap_read_sched_end(desc, accessory);
     }
 
     return err;
@@ -1254,26 +1794,222 @@ HAPError lhap_char_raw_handleRead(
 
 static void lhap_schedule_read_requests_cb(HAPPlatformTimerRef timer, void* context) {
     lhap_desc *desc = context;
+    lhap_read_sched *sched = &desc->read_sched;
+    sched->timer = 0;
+
+    while (sched->num_reads < sched->max_reads) {
+        lhap_read_request *request = lhap_read_sched_dequeue(sched);
+        if (!request) {
+            break;
+        }
+        lhap_accessory_ext *acc_ext = lhap_accessory_get_ext(request->accessory);
+        lhap_char_ext *ext = lhap_char_get_ext(request->characteristic);
+        if (ext->reading) {
+            lhap_char_attach_read_request(sched, ext, request);
+        } else {
+            HAPError err = lhap_char_raw_handleRead(true, desc, request->transportType, request->session,
+                request->accessory, request->service, request->characteristic, request->pfunc);
+            if (err != kHAPError_None && err != kHAPError_InProgress) {
+                HAPLogError(&lhap_log, "%s: Failed to handle read request, error code: %d.", __func__, err);
+                err = lhap_char_response_read_request(&desc->server, request->transportType, request->session,
+                    request->accessory, request->service, request->characteristic, err, NULL);
+                if (err != kHAPError_None) {
+                    HAPLogError(&lhap_log, "%s: Failed to response read request, error code: %d.", __func__, err);
+                }
+            }
+            lhap_read_request_free(sched, request);
+            lua_settop(desc->mL, 0);
+            lc_collectgarbage(desc->mL);
+        }
+        for (int prio = 0; prio < LHAP_READ_PRIO_MAX; prio++) {
+            lhap_read_sched_set_ready(sched, acc_ext, prio);
+        }
+    }
+}
+
+typedef struct lhap_read_batch_ctx {
+    lhap_desc *desc;
+    const HAPAccessory *accessory;
+    lhap_read_request *requests;
+    unsigned int gen;   /* Generation of the read scheduler when the batch is started. */
+} lhap_read_batch_ctx;
+
+static int lhap_read_batch_finish(lua_State *L, int status, lua_KContext extra) {
+    lhap_read_batch_ctx *ctx = (lhap_read_batch_ctx *)extra;
+    lhap_desc *desc = ctx->desc;
+    lhap_read_sched *sched = &desc->read_sched;
+    if (ctx->gen != sched->gen) {
+        // HAP was stopped during the batch, the requests in the pool are released.
+        return 0;
+    }
+
+    bool ok = true;
+    if (status != LUA_OK && status != LUA_YIELD) {
+        HAPLogError(&lhap_log, "%s: %s", __func__, lua_tostring(L, -1));
+        ok = false;
+    } else if (!lua_isnil(L, -1) && !lua_istable(L, -1)) {
+        HAPLogError(&lhap_log, "%s: Invalid results.", __func__);
+        ok = false;
+    }
+
+    int results = lua_gettop(L);
+    for (lua_Integer i = 1; ctx->requests; i++) {
+        lhap_read_request *request = ctx->requests;
+        ctx->requests = request->next;
+        lhap_char_ext *ext = lhap_char_get_ext(request->characteristic);
+        ext->reading = false;
+
+        HAPError err = kHAPError_None;
+        union lhap_char_value val;
+        if (!ok) {
+            err = kHAPError_Unknown;
+        } else if (lua_isnil(L, results) || lua_geti(L, results, i) == LUA_TNIL) {
+            // Fall back to the read callback of the characteristic.
+            lua_settop(L, results);
+            lhap_read_sched_enqueue(sched, request);
+            while (ext->waiters) {
+                lhap_read_request *waiter = ext->waiters;
+                ext->waiters = waiter->next;
+                lhap_read_sched_enqueue(sched, waiter);
+            }
+            continue;
+        } else {
+            HAPCharacteristicFormat format = request->characteristic->format;
+            if (!lhap_char_value_is_valid(L, -1, format) || !lhap_char_value_get(L, -1, format, &val)) {
+                err = kHAPError_InvalidData;
+            } else {
+                lhap_char_cache_set(L, -1, request->characteristic);
+            }
+        }
+
+        HAPError _err = lhap_char_response_read_request(&desc->server, request->transportType, request->session,
+            request->accessory, request->service, request->characteristic, err, &val);
+        if (_err != kHAPError_None) {
+            HAPLogError(&lhap_log, "%s: Failed to response read request, error code: %d.", __func__, _err);
+        }
+        lhap_char_response_waiters(desc, ext, err, &val);
+        lhap_read_request_free(sched, request);
+        lua_settop(L, results);
+    }
+
+    lhap_read_sched_end(desc, ctx->accessory);
+    return 0;
+}
+
+static int lhap_read_batch_handle(lua_State *L) {
+    // stack: <ctx, traceback, func, requests>
+    lua_KContext ctx = (lua_KContext)lua_touserdata(L, 1);
+    int status = lua_pcallk(L, 1, 1, 2, ctx, lhap_read_batch_finish);
+    return lhap_read_batch_finish(L, status, ctx);
+}
+
+static int lhap_read_batch_pcall(lua_State *L) {
+    lhap_read_batch_ctx *_ctx = lua_touserdata(L, 1);
+    lua_pop(L, 1);
+
+    lua_State *co = lc_newthread(L);
+    lc_setheapowner(co, lhap_accessory_get_ext(_ctx->accessory)->owner);
+    lua_pushcfunction(co, lhap_read_batch_handle);
+    lhap_read_batch_ctx *ctx = lua_newuserdata(co, sizeof(*ctx));
+    *ctx = *_ctx;
+
+    lc_pushtraceback(co);
+
+    // push the function
+    HAPAssert(lua_rawgetp(co, LUA_REGISTRYINDEX, &lhap_accessory_get_ext(ctx->accessory)->batch) == LUA_TFUNCTION);
+
+    // push the array of requests
+    lua_newtable(co);
+    lua_Integer i = 1;
+    for (lhap_read_request *request = ctx->requests; request; request = request->next, i++) {
+        lhap_create_request_table(co, request->transportType, request->session, NULL,
+            request->accessory, request->service, request->characteristic);
+        lua_rawseti(co, -2, i);
+    }
+
+    // The requests are owned by the coroutine from now on.
+    _ctx->requests = NULL;
+    lhap_read_sched_begin(&ctx->desc->read_sched, ctx->accessory);
+
+    int status, nres;
+    status = lc_resume(co, L, 4, &nres);
+    if (status != LUA_OK && status != LUA_YIELD) {
+        return lua_error(L);
+    }
+    return 0;
+}
+
+static void lhap_read_batch_cb(HAPPlatformTimerRef timer, void* context) {
+    lhap_desc *desc = context;
+    lhap_read_sched *sched = &desc->read_sched;
+    lua_State *L = desc->mL;
+    sched->batch_timer = 0;
 
-    while (desc->read_requests_ptail != &desc->read_requests_head) {
-        lhap_read_request *request = desc->read_requests_head;
-        desc->read_requests_head = request->next;
-        if (desc->read_requests_head == NULL) {
-            desc->read_requests_ptail = &desc->read_requests_head;
+    while (sched->batch_head) {
+        lhap_accessory_ext *ext = sched->batch_head;
+        sched->batch_head = ext->batch_next;
+        if (!sched->batch_head) {
+            sched->batch_ptail = &sched->batch_head;
         }
-        HAPError err = lhap_char_raw_handleRead(true, desc, request->transportType, request->session,
-            request->accessory, request->service, request->characteristic, request->pfunc);
-        if (err != kHAPError_None && err != kHAPError_InProgress) {
-            HAPLogError(&lhap_log, "%s: Failed to handle read request, error code: %d.", __func__, err);
-            err = lhap_char_response_read_request(&desc->server, request->transportType, request->session,
-                request->accessory, request->service, request->characteristic, err, NULL);
+        ext->batching = false;
+
+        lhap_read_batch_ctx ctx = {
+            .desc = desc,
+            .accessory = lhap_accessory_from_ext(ext),
+            .requests = ext->batch.head,
+            .gen = sched->gen,
+        };
+        ext->batch.head = NULL;
+        ext->batch.ptail = &ext->batch.head;
+
+        lua_pushcfunction(L, lhap_read_batch_pcall);
+        lua_pushlightuserdata(L, &ctx);
+        int status = lua_pcall(L, 1, 0, 0);
+        if (status != LUA_OK) {
+            HAPLogError(&lhap_log, "%s: %s", __func__, lua_tostring(L, -1));
+        }
+        // The batch failed before it was started.
+        while (ctx.requests) {
+            lhap_read_request *request = ctx.requests;
+            ctx.requests = request->next;
+            lhap_char_ext *char_ext = lhap_char_get_ext(request->characteristic);
+            char_ext->reading = false;
+            HAPError err = lhap_char_response_read_request(&desc->server, request->transportType,
+                request->session, request->accessory, request->service, request->characteristic,
+                kHAPError_Unknown, NULL);
             if (err != kHAPError_None) {
                 HAPLogError(&lhap_log, "%s: Failed to response read request, error code: %d.", __func__, err);
             }
+            lhap_char_response_waiters(desc, char_ext, kHAPError_Unknown, NULL);
+            lhap_read_request_free(sched, request);
+        }
+        lua_settop(L, 0);
+        lc_collectgarbage(L);
+    }
+}
+
+/**
+ * Add the read request to the pending batch of the accessory,
+ * the batch is handled after all requests of the current transaction are received.
+ */
+static void lhap_read_batch_add(lhap_desc *desc, lhap_accessory_ext *ext, lhap_read_request *request) {
+    lhap_read_sched *sched = &desc->read_sched;
+
+    request->next = NULL;
+    *(ext->batch.ptail) = request;
+    ext->batch.ptail = &request->next;
+    if (!ext->batching) {
+        ext->batching = true;
+        ext->batch_next = NULL;
+        *(sched->batch_ptail) = ext;
+        sched->batch_ptail = &ext->batch_next;
+    }
+    if (!sched->batch_timer) {
+        if (HAPPlatformTimerRegister(&sched->batch_timer, HAPPlatformClockGetCurrent(),
+            lhap_read_batch_cb, desc)) {
+            HAPLogError(&lhap_log, "%s: Failed to register read batch timer.", __func__);
+            HAPFatalError();
         }
-        pal_mem_free(request);
-        lua_settop(desc->mL, 0);
-        lc_collectgarbage(desc->mL);
     }
 }
 
@@ -1290,8 +2026,33 @@ HAPError lhap_char_base_handleRead(
     lua_State *L = desc->mL;
     HAPAssert(lua_gettop(L) == 0);
 
-    if (desc->num_read_requests == desc->max_read_requests) {
-        lhap_read_request *request = pal_mem_alloc(sizeof(*request));
+    if (lhap_char_slot_get(L, characteristic) || lhap_char_cache_get(L, characteristic)) {
+        lua_pushinteger(L, kHAPError_None);
+        return kHAPError_None;
+    }
+
+    lhap_read_sched *sched = &desc->read_sched;
+    lhap_char_ext *ext = lhap_char_get_ext(characteristic);
+    lhap_accessory_ext *acc_ext = lhap_accessory_get_ext(accessory);
+    if (acc_ext->has_read_batch && !ext->reading) {
+        lhap_read_request *request = lhap_read_request_alloc(sched);
+        if (!request) {
+            return kHAPError_OutOfResources;
+        }
+        request->desc = desc;
+        request->transportType = transportType;
+        request->session = session;
+        request->accessory = accessory;
+        request->service = service,
+        request->characteristic = characteristic;
+        request->pfunc = pfunc;
+        lhap_read_batch_add(desc, acc_ext, request);
+        ext->reading = true;
+        return kHAPError_InProgress;
+    }
+    if (ext->reading || sched->num_reads >= sched->max_reads || lhap_read_sched_has_ready(sched) ||
+        acc_ext->num_reads >= sched->max_acc_reads) {
+        lhap_read_request *request = lhap_read_request_alloc(sched);
         if (!request) {
             return kHAPError_OutOfResources;
         }
@@ -1302,9 +2063,12 @@ HAPError lhap_char_base_handleRead(
         request->service = service,
         request->characteristic = characteristic;
         request->pfunc = pfunc;
-        request->next = NULL;
-        *(desc->read_requests_ptail) = request;
-        desc->read_requests_ptail = &request->next;
+        if (ext->reading) {
+            lhap_char_attach_read_request(sched, ext, request);
+        } else {
+            lhap_read_sched_enqueue(sched, request);
+            lhap_read_sched_kick(desc);
+        }
         return kHAPError_InProgress;
     }
 
@@ -1507,9 +2271,13 @@ end:
 int lhap_char_handle_write_finish(lua_State *L, int status, lua_KContext _ctx) {
     lhap_call_context *ctx = (lhap_call_context *)_ctx;
     HAPError err = kHAPError_None;
+    lhap_char_cache_invalidate(L, ctx->characteristic);
     if (status != LUA_OK && status != LUA_YIELD) {
         HAPLogError(&lhap_log, "%s: %s", __func__, lua_tostring(L, -1));
         err = kHAPError_Unknown;
+    } else if (lhap_char_get_ext(ctx->characteristic)->slot.valid) {
+        // The written value becomes the pushed value.
+        lhap_char_slot_set(L, 3, ctx->characteristic);
     }
     if (ctx->in_progress == false) {
         lua_pushinteger(L, err);
@@ -1524,7 +2292,7 @@ int lhap_char_handle_write_finish(lua_State *L, int status, lua_KContext _ctx) {
 }
 
 static int lhap_char_handle_write(lua_State *L) {
-    // stack: <call_ctx, traceback, func, request, value>
+    // stack: <call_ctx, traceback, value, func, request, value>
     lua_KContext call_ctx = (lua_KContext)lua_touserdata(L, 1);
     int status = lua_pcallk(L, 2, 0, 2, call_ctx, lhap_char_handle_write_finish);
     return lhap_char_handle_write_finish(L, status, call_ctx);
@@ -1537,6 +2305,7 @@ static int lhap_char_handle_write_pcall(lua_State *L) {
     lua_pop(L, 3);
 
     lua_State *co = lc_newthread(L);
+    lc_setheapowner(co, lhap_accessory_get_ext(_call_ctx->accessory)->owner);
     lua_pushcfunction(co, lhap_char_handle_write);
     lhap_call_context *call_ctx = lua_newuserdata(co, sizeof(*call_ctx));
     *call_ctx = *_call_ctx;
@@ -1550,8 +2319,12 @@ static int lhap_char_handle_write_pcall(lua_State *L) {
     lua_xmove(L, co, 1);
     lua_pop(L, 1);
 
+    // Keep a copy of the value below the function, to update the pushed value after the write.
+    lua_pushvalue(co, -1);
+    lua_insert(co, 4);
+
     int status, nres;
-    status = lc_resume(co, L, 5, &nres);
+    status = lc_resume(co, L, 6, &nres);
     switch (status) {
     case LUA_OK:
         HAPAssert(nres == 1);
@@ -1578,6 +2351,12 @@ HAPError lhap_char_base_handleWrite(
         const void *pfunc) {
     lua_State *L = desc->mL;
 
+    lhap_char_cache_invalidate(L, characteristic);
+
+    // The controller writing a characteristic is considered to be in the foreground.
+    desc->read_sched.fg_session = session;
+    desc->read_sched.fg_time = HAPPlatformClockGetCurrent();
+
     lhap_call_context call_ctx = {
         .in_progress = false,
         .transportType = transportType,
@@ -1754,6 +2533,7 @@ static int lhap_accessory_pcall_identify(lua_State *L) {
 
     lua_State *co = lc_newthread(L);
     const HAPAccessory *accessory = request->accessory;
+    lc_setheapowner(co, lhap_accessory_get_ext(accessory)->owner);
 
     // push the identify function
     HAPAssert(lua_rawgetp(co, LUA_REGISTRYINDEX,
@@ -1944,8 +2724,11 @@ static int lhap_new_accessory(lua_State *L) {
     size_t nservices = lhap_checkarray(L, 9);
     luaL_argcheck(L, nservices, 9, "empty services");
     bool has_identify = lhap_optfunction(L, 10);
+    bool has_read_batch = lhap_optfunction(L, 11);
 
-    HAPAccessory *accessory = lua_newuserdatauv(L, sizeof(HAPAccessory), 7);
+    HAPAccessory *accessory = lua_newuserdatauv(L, sizeof(HAPAccessory) + sizeof(lhap_accessory_ext), 7);
+    lhap_accessory_ext *ext = lhap_accessory_get_ext(accessory);
+    HAPRawBufferZero(ext, sizeof(*ext));
     luaL_setmetatable(L, LHAP_ACCESSORY_NAME);
     for (size_t i = 3, j = 1; i <= 8; i++, j++) {
         lua_pushvalue(L, i);
@@ -1981,6 +2764,13 @@ static int lhap_new_accessory(lua_State *L) {
         lua_pushvalue(L, 10);
         lua_rawsetp(L, LUA_REGISTRYINDEX, &(accessory->callbacks.identify));
     }
+
+    ext->owner = lc_getheapowner(L);
+    ext->has_read_batch = has_read_batch;
+    if (has_read_batch) {
+        lua_pushvalue(L, 11);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &ext->batch);
+    }
     return 1;
 }
 
@@ -1990,23 +2780,49 @@ static int lhap_accessory_gc(lua_State *L) {
     if (accessory->callbacks.identify) {
         lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, &(accessory->callbacks.identify));
     }
+    lhap_accessory_ext *ext = lhap_accessory_get_ext(accessory);
+    if (ext->has_read_batch) {
+        lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, &ext->batch);
+    }
     return 0;
 }
 
 static const lhap_service_type *lhap_get_service_type(const char *s) {
-    for (int i = 0; i < HAPArrayCount(lhap_service_type_tab);
-        i++) {
-        if (HAPStringAreEqual(s, lhap_service_type_tab[i].name)) {
-            return lhap_service_type_tab + i;
+    int left = 0;
+    int right = HAPArrayCount(lhap_service_type_tab) - 1;
+    while (left <= right) {
+        int mid = left + (right - left) / 2;
+        int cmp = strcmp(lhap_service_type_tab[mid].name, s);
+        if (cmp > 0) {
+            right = mid - 1;
+        } else if (cmp < 0) {
+            left = mid + 1;
+        } else {
+            return lhap_service_type_tab + mid;
         }
     }
     return NULL;
 }
 
+/**
+ * Get the service type from a type name or a type handle in ``hap.ServiceType``.
+ */
+static const lhap_service_type *lhap_check_service_type(lua_State *L, int arg) {
+    const lhap_service_type *type;
+    if (lua_islightuserdata(L, arg)) {
+        type = lua_touserdata(L, arg);
+        luaL_argcheck(L, type >= lhap_service_type_tab &&
+            type < lhap_service_type_tab + HAPArrayCount(lhap_service_type_tab), arg, "unknown type");
+    } else {
+        type = lhap_get_service_type(luaL_checkstring(L, arg));
+        luaL_argcheck(L, type, arg, "unknown type");
+    }
+    return type;
+}
+
 static int lhap_new_service(lua_State *L) {
     uint64_t iid = luaL_checkinteger(L, 1);
-    const lhap_service_type *type = lhap_get_service_type(luaL_checkstring(L, 2));
-    luaL_argcheck(L, type, 2, "unknown type");
+    const lhap_service_type *type = lhap_check_service_type(L, 2);
     luaL_checktype(L, 3, LUA_TBOOLEAN);
     luaL_checktype(L, 4, LUA_TBOOLEAN);
     size_t nchars = lhap_checkarray(L, 5);
@@ -2068,33 +2884,60 @@ static int lhap_service_link_services(lua_State *L) {
 }
 
 static const lhap_characteristic_type *lhap_get_char_type(const char *s) {
-    for (int i = 0; i < HAPArrayCount(lhap_characteristic_type_tab);
-        i++) {
-        if (HAPStringAreEqual(s, lhap_characteristic_type_tab[i].name)) {
-            return lhap_characteristic_type_tab + i;
+    int left = 0;
+    int right = HAPArrayCount(lhap_characteristic_type_tab) - 1;
+    while (left <= right) {
+        int mid = left + (right - left) / 2;
+        int cmp = strcmp(lhap_characteristic_type_tab[mid].name, s);
+        if (cmp > 0) {
+            right = mid - 1;
+        } else if (cmp < 0) {
+            left = mid + 1;
+        } else {
+            return lhap_characteristic_type_tab + mid;
         }
     }
     return NULL;
 }
 
+/**
+ * Get the characteristic type from a type name or a type handle in ``hap.CharType``.
+ */
+static const lhap_characteristic_type *lhap_check_char_type(lua_State *L, int arg) {
+    const lhap_characteristic_type *type;
+    if (lua_islightuserdata(L, arg)) {
+        type = lua_touserdata(L, arg);
+        luaL_argcheck(L, type >= lhap_characteristic_type_tab &&
+            type < lhap_characteristic_type_tab + HAPArrayCount(lhap_characteristic_type_tab), arg, "unknown type");
+    } else {
+        type = lhap_get_char_type(luaL_checkstring(L, arg));
+        luaL_argcheck(L, type, arg, "unknown type");
+    }
+    return type;
+}
+
 static int lhap_new_char(lua_State *L) {
     uint64_t iid = luaL_checkinteger(L, 1);
     HAPCharacteristicFormat format = luaL_checkoption(L, 2, NULL, lhap_characteristic_format_strs);
-    const lhap_characteristic_type *type = lhap_get_char_type(luaL_checkstring(L, 3));
-    luaL_argcheck(L, type, 3, "unknown type");
+    const lhap_characteristic_type *type = lhap_check_char_type(L, 3);
     luaL_checktype(L, 4, LUA_TTABLE);
     bool has_read = lhap_optfunction(L, 5);
     bool has_write = lhap_optfunction(L, 6);
 
+    size_t size = lhap_characteristic_struct_size[format] + sizeof(lhap_char_ext);
     HAPBaseCharacteristic *characteristic = lua_newuserdatauv(L,
-        lhap_characteristic_struct_size[format], format == kHAPCharacteristicFormat_UInt8 ? 3 : 1);
+        size, format == kHAPCharacteristicFormat_UInt8 ? 3 : 1);
     luaL_setmetatable(L, LHAP_CHARACTERISTIC_NAME);
-    HAPRawBufferZero(characteristic, lhap_characteristic_struct_size[format]);
+    HAPRawBufferZero(characteristic, size);
     characteristic->iid = iid;
     characteristic->format = format;
     characteristic->characteristicType = type->type;
     characteristic->debugDescription = type->debugDescription;
-    lc_traverse_table(L, 4, lhap_char_props_kvs, &characteristic->properties);
+    lhap_char_props_ctx props_ctx = {
+        .props = &characteristic->properties,
+        .ext = lhap_char_get_ext(characteristic),
+    };
+    lc_traverse_table(L, 4, lhap_char_props_kvs, &props_ctx);
 
     if (has_read) {
 #define LHAP_CASE_CHAR_REGISTER_READ_CB(format) \
@@ -2166,9 +3009,19 @@ static int lhap_char_gc(lua_State *L) {
 
 #undef LHAP_RESET_CHAR_CBS
 
+    lhap_char_cache_invalidate(L, characteristic);
+    lhap_char_slot_reset(L, characteristic);
     return 0;
 }
 
+static int lhap_char_get_cache_stats(lua_State *L) {
+    HAPBaseCharacteristic *characteristic = luaL_checkudata(L, 1, LHAP_CHARACTERISTIC_NAME);
+    lhap_char_cache *cache = &lhap_char_get_ext(characteristic)->cache;
+    lua_pushinteger(L, cache->hits);
+    lua_pushinteger(L, cache->misses);
+    return 2;
+}
+
 static int lhap_char_set_mfg_desc(lua_State *L) {
     HAPBaseCharacteristic *characteristic = luaL_checkudata(L, 1, LHAP_CHARACTERISTIC_NAME);
     const char *mfgDesc = luaL_checkstring(L, 2);
@@ -2332,6 +3185,97 @@ static int lhap_set_valid_vals_ranges(lua_State *L) {
     return 1;
 }
 
+static inline bool lhap_service_is_builtin(const HAPService *service) {
+    return service == &accessoryInformationService || service == &pairingService ||
+        service == &hapProtocolInformationService;
+}
+
+static int lhap_attr_compare(const void *a, const void *b) {
+    const lhap_attr *x = a;
+    const lhap_attr *y = b;
+    if (x->aid != y->aid) {
+        return x->aid < y->aid ? -1 : 1;
+    }
+    if (x->iid != y->iid) {
+        return x->iid < y->iid ? -1 : 1;
+    }
+    return 0;
+}
+
+static size_t lhap_db_add_accessory(lhap_attr *attrs, const HAPAccessory *accessory, lhap_db_stats *stats) {
+    size_t n = 0;
+    stats->num_accessories++;
+    for (const HAPService * const *pserv = accessory->services; *pserv; pserv++) {
+        if (lhap_service_is_builtin(*pserv)) {
+            continue;
+        }
+        stats->num_services++;
+        for (const HAPBaseCharacteristic * const *pchar =
+            (const HAPBaseCharacteristic * const *)(*pserv)->characteristics; *pchar; pchar++, n++) {
+            if (attrs) {
+                attrs[n].aid = accessory->aid;
+                attrs[n].iid = (*pchar)->iid;
+                attrs[n].service = *pserv;
+                attrs[n].characteristic = *pchar;
+            }
+        }
+    }
+    return n;
+}
+
+/**
+ * Build the characteristic index sorted by (aid, iid).
+ *
+ * The index is a userdata stored in the registry, it is released when the server is stopped.
+ */
+static void lhap_db_build(lua_State *L, lhap_desc *desc) {
+    lhap_db *db = &desc->db;
+    lhap_db_stats stats = { 0 };
+
+    size_t num = lhap_db_add_accessory(NULL, desc->primary_acc, &stats);
+    for (size_t i = 0; i < desc->num_bridged_accs; i++) {
+        num += lhap_db_add_accessory(NULL, desc->bridged_accs[i], &stats);
+    }
+
+    db->attrs = lua_newuserdatauv(L, sizeof(lhap_attr) * num, 0);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &db->attrs);
+
+    HAPRawBufferZero(&stats, sizeof(stats));
+    size_t n = lhap_db_add_accessory(db->attrs, desc->primary_acc, &stats);
+    for (size_t i = 0; i < desc->num_bridged_accs; i++) {
+        n += lhap_db_add_accessory(db->attrs + n, desc->bridged_accs[i], &stats);
+    }
+    HAPAssert(n == num);
+    qsort(db->attrs, num, sizeof(lhap_attr), lhap_attr_compare);
+    db->num_attrs = num;
+    for (size_t i = 0; i < num; i++) {
+        lhap_char_get_ext(db->attrs[i].characteristic)->attr = db->attrs + i;
+    }
+
+    stats.num_chars = num;
+    stats.index_size = sizeof(lhap_attr) * num;
+    db->stats = stats;
+    HAPLog(&lhap_log, "Characteristic index: %zu accessories, %zu services, %zu characteristics.",
+        stats.num_accessories, stats.num_services, stats.num_chars);
+}
+
+static void lhap_db_release(lua_State *L, lhap_desc *desc) {
+    for (size_t i = 0; i < desc->db.num_attrs; i++) {
+        lhap_char_get_ext(desc->db.attrs[i].characteristic)->attr = NULL;
+    }
+    lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, &desc->db.attrs);
+    HAPRawBufferZero(&desc->db, sizeof(desc->db));
+}
+
+/**
+ * Find the attribute of the characteristic created by Lua.
+ */
+static lhap_attr *lhap_db_find(lhap_desc *desc, uint64_t aid, uint64_t iid) {
+    const lhap_db *db = &desc->db;
+    const lhap_attr key = { .aid = aid, .iid = iid };
+    return bsearch(&key, db->attrs, db->num_attrs, sizeof(lhap_attr), lhap_attr_compare);
+}
+
 static int lhap_start_finish(lua_State *L, int status, lua_KContext extra) {
     lhap_desc *desc = (lhap_desc *)extra;
     desc->co = NULL;
@@ -2347,12 +3291,93 @@ static int lhap_accessory_is_valid(lua_State *L) {
     return 1;
 }
 
+#define LHAP_START_OPTION_CB(name, field) \
+static bool lhap_start_option_##name##_cb(lua_State *L, void *arg) { \
+    lhap_desc *desc = arg; \
+    lua_Integer val = lua_tointeger(L, -1); \
+    if (val <= 0) { \
+        return false; \
+    } \
+    desc->field = val; \
+    return true; \
+}
+
+LHAP_START_OPTION_CB(max_reads, read_sched.max_reads)
+LHAP_START_OPTION_CB(max_acc_reads, read_sched.max_acc_reads)
+LHAP_START_OPTION_CB(max_requests, read_sched.max_requests)
+LHAP_START_OPTION_CB(fg_timeout, read_sched.fg_timeout)
+LHAP_START_OPTION_CB(ip_num_sessions, ip_config.num_sessions)
+
+#define LHAP_START_OPTION_BUFSIZE_CB(name, field) \
+static bool lhap_start_option_##name##_cb(lua_State *L, void *arg) { \
+    lhap_desc *desc = arg; \
+    lua_Integer val = lua_tointeger(L, -1); \
+    if (val < (lua_Integer)PAL_HAP_IP_SESSION_STORAGE_MIN_BUFSIZE) { \
+        return false; \
+    } \
+    desc->field = val; \
+    return true; \
+}
+
+LHAP_START_OPTION_BUFSIZE_CB(ip_inbound_bufsize, ip_config.inbound_bufsize)
+LHAP_START_OPTION_BUFSIZE_CB(ip_outbound_bufsize, ip_config.outbound_bufsize)
+LHAP_START_OPTION_BUFSIZE_CB(ip_scratch_bufsize, ip_config.scratch_bufsize)
+
+static bool lhap_start_option_event_window_cb(lua_State *L, void *arg) {
+    lhap_desc *desc = arg;
+    lua_Integer val = lua_tointeger(L, -1);
+    if (val < 0) {
+        return false;
+    }
+    desc->event_window = val;
+    return true;
+}
+
+static const lc_table_kv lhap_start_options_ip_kvs[] = {
+    {"numSessions", LC_TNUMBER, lhap_start_option_ip_num_sessions_cb},
+    {"inboundBufferSize", LC_TNUMBER, lhap_start_option_ip_inbound_bufsize_cb},
+    {"outboundBufferSize", LC_TNUMBER, lhap_start_option_ip_outbound_bufsize_cb},
+    {"scratchBufferSize", LC_TNUMBER, lhap_start_option_ip_scratch_bufsize_cb},
+    {NULL, 0, NULL},
+};
+
+static bool lhap_start_option_ip_cb(lua_State *L, void *arg) {
+    return lc_traverse_table(L, -1, lhap_start_options_ip_kvs, arg);
+}
+
+static const lc_table_kv lhap_start_options_kvs[] = {
+    {"maxReads", LC_TNUMBER, lhap_start_option_max_reads_cb},
+    {"maxReadsPerAccessory", LC_TNUMBER, lhap_start_option_max_acc_reads_cb},
+    {"maxQueuedReads", LC_TNUMBER, lhap_start_option_max_requests_cb},
+    {"foregroundTimeout", LC_TNUMBER, lhap_start_option_fg_timeout_cb},
+    {"eventWindow", LC_TNUMBER, lhap_start_option_event_window_cb},
+    {"ip", LC_TTABLE, lhap_start_option_ip_cb},
+    {NULL, 0, NULL},
+};
+
 static int lhap_start(lua_State *L) {
     lhap_desc *desc = &gv_lhap_desc;
     if (desc->started) {
         luaL_error(L, "HAP is already started");
     }
 
+    lhap_read_sched *sched = &desc->read_sched;
+    sched->max_reads = LHAP_READS_MAX_DFT;
+    sched->max_acc_reads = LHAP_ACC_READS_MAX_DFT;
+    sched->max_requests = LHAP_READ_REQUESTS_MAX_DFT;
+    sched->fg_timeout = LHAP_FOREGROUND_TIMEOUT_DFT;
+    desc->event_window = 0;
+    desc->ip_config.num_sessions = PAL_HAP_IP_SESSION_STORAGE_NUM_ELEMENTS;
+    desc->ip_config.inbound_bufsize = PAL_HAP_IP_SESSION_STORAGE_INBOUND_BUFSIZE;
+    desc->ip_config.outbound_bufsize = PAL_HAP_IP_SESSION_STORAGE_OUTBOUND_BUFSIZE;
+    desc->ip_config.scratch_bufsize = PAL_HAP_IP_SESSION_STORAGE_SCRATCH_BUFSIZE;
+    if (!lua_isnoneornil(L, 6)) {
+        luaL_checktype(L, 6, LUA_TTABLE);
+        if (!lc_traverse_table(L, 6, lhap_start_options_kvs, desc)) {
+            luaL_argerror(L, 6, "invalid options");
+        }
+    }
+
     desc->primary_acc = luaL_checkudata(L, 1, LHAP_ACCESSORY_NAME);
     luaL_argcheck(L, HAPRegularAccessoryIsValid(desc->primary_acc), 1, "invalid primary accessory");
     desc->num_bridged_accs = lhap_optarray(L, 2);
@@ -2419,13 +3444,15 @@ static int lhap_start(lua_State *L) {
     }
 
     pal_hap_init_platform(&desc->platform);
+    pal_hap_set_max_ip_sessions(&desc->platform, desc->ip_config.num_sessions);
 
     // Display setup code.
     HAPSetupCode setupCode;
     HAPPlatformAccessorySetupLoadSetupCode(desc->platform.accessorySetup, &setupCode);
     HAPLog(&lhap_log, "Setup code: %s", setupCode.stringValue);
 
-    lhap_init_ip(&desc->server_options, HAPMax(num_readable, num_writable), num_notify);
+    lhap_init_ip(&desc->server_options, &desc->ip_config,
+        HAPMax(num_readable, num_writable), num_notify, &desc->ip_stats);
     desc->server_options.maxPairings = kHAPPairingStorage_MinElements;
 
     // Initialize accessory server.
@@ -2444,10 +3471,13 @@ static int lhap_start(lua_State *L) {
         HAPAccessoryServerStart(&desc->server, desc->primary_acc);
     }
 
-    desc->num_read_requests = 0;
-    desc->max_read_requests = LHAP_READ_REQUESTS_MAX;
-    desc->read_requests_head = NULL;
-    desc->read_requests_ptail = &desc->read_requests_head;
+    lhap_db_build(L, desc);
+    desc->events_head = NULL;
+    desc->events_ptail = &desc->events_head;
+
+    sched->pool = lua_newuserdata(L, sizeof(lhap_read_request) * sched->max_requests);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &sched->pool);
+    lhap_read_sched_init(sched, desc->primary_acc, desc->bridged_accs);
 
     desc->mL = lc_getmainthread(L);
     desc->co = L;
@@ -2465,6 +3495,29 @@ static int lhap_stop_finish(lua_State *L, int status, lua_KContext extra) {
     lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, &desc->primary_acc);
     lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, &desc->bridged_accs);
 
+    if (desc->read_sched.timer) {
+        HAPPlatformTimerDeregister(desc->read_sched.timer);
+        desc->read_sched.timer = 0;
+    }
+    if (desc->read_sched.batch_timer) {
+        HAPPlatformTimerDeregister(desc->read_sched.batch_timer);
+        desc->read_sched.batch_timer = 0;
+    }
+    // Orphan the reads in progress, they must not return their requests to the released pool.
+    desc->read_sched.gen++;
+    lhap_rawsetp_reset(L, LUA_REGISTRYINDEX, &desc->read_sched.pool);
+    if (desc->event_timer) {
+        HAPPlatformTimerDeregister(desc->event_timer);
+        desc->event_timer = 0;
+    }
+    desc->events_head = NULL;
+    desc->events_ptail = &desc->events_head;
+    lhap_db_release(L, desc);
+    desc->read_sched.pool = NULL;
+    desc->read_sched.free = NULL;
+    // The session is released with the server, it must not match a session of the next start.
+    desc->read_sched.fg_session = NULL;
+
     lhap_reset_server_cb(L, &desc->server_cbs);
     HAPRawBufferZero(&desc->server_cbs, sizeof(desc->server_cbs));
 
@@ -2502,6 +3555,75 @@ static int lhap_at_exit(lua_State *L) {
     return lhap_stop(L);
 }
 
+/**
+ * Raise the pending events.
+ *
+ * The events raised in the same run loop turn are sent in one message per session by the server.
+ */
+static void lhap_flush_events(lhap_desc *desc) {
+    while (desc->events_head) {
+        lhap_attr *attr = desc->events_head;
+        desc->events_head = attr->event_next;
+        attr->event_pending = false;
+        HAPAccessoryServerRaiseEventByIID(&desc->server, attr->iid, attr->service->iid, attr->aid,
+            attr->event_session);
+    }
+    desc->events_ptail = &desc->events_head;
+}
+
+static void lhap_flush_events_cb(HAPPlatformTimerRef timer, void* context) {
+    lhap_desc *desc = context;
+    desc->event_timer = 0;
+    lhap_flush_events(desc);
+}
+
+/**
+ * Add an event of the attribute to the pending events,
+ * the repeated events of the same characteristic are merged.
+ */
+static void lhap_add_attr_event(lua_State *L, lhap_desc *desc, lhap_attr *attr, HAPSessionRef *session) {
+    lhap_char_cache_invalidate(L, attr->characteristic);
+
+    if (attr->event_pending) {
+        if (attr->event_session != session) {
+            attr->event_session = NULL;
+        }
+        return;
+    }
+    attr->event_pending = true;
+    attr->event_session = session;
+    attr->event_next = NULL;
+    *(desc->events_ptail) = attr;
+    desc->events_ptail = &attr->event_next;
+}
+
+/**
+ * Add an event to the pending events.
+ */
+static void lhap_add_event(lua_State *L, lhap_desc *desc,
+    uint64_t aid, uint64_t sid, uint64_t cid, HAPSessionRef *session) {
+    lhap_attr *attr = lhap_db_find(desc, aid, cid);
+    if (!attr || attr->service->iid != sid) {
+        HAPAccessoryServerRaiseEventByIID(&desc->server, cid, sid, aid, session);
+        return;
+    }
+    lhap_add_attr_event(L, desc, attr, session);
+}
+
+static void lhap_commit_events(lhap_desc *desc) {
+    if (desc->event_window == 0) {
+        lhap_flush_events(desc);
+        return;
+    }
+    if (desc->events_head && !desc->event_timer) {
+        if (HAPPlatformTimerRegister(&desc->event_timer, HAPPlatformClockGetCurrent() + desc->event_window,
+            lhap_flush_events_cb, desc)) {
+            HAPLogError(&lhap_log, "%s: Failed to register event timer.", __func__);
+            lhap_flush_events(desc);
+        }
+    }
+}
+
 static int lhap_raise_event(lua_State *L) {
     HAPSessionRef *session = NULL;
     lhap_desc *desc = &gv_lhap_desc;
@@ -2518,10 +3640,141 @@ static int lhap_raise_event(lua_State *L) {
         session = lua_touserdata(L, 4);
     }
 
-    HAPAccessoryServerRaiseEventByIID(&desc->server, cid, sid, aid, session);
+    lhap_add_event(L, desc, aid, sid, cid, session);
+    lhap_commit_events(desc);
+    return 0;
+}
+
+static int lhap_raise_events(lua_State *L) {
+    HAPSessionRef *session = NULL;
+    lhap_desc *desc = &gv_lhap_desc;
+
+    if (!desc->started) {
+        luaL_error(L, "HAP is not started.");
+    }
+
+    size_t n = lhap_checkarray(L, 1);
+    if (!lua_isnoneornil(L, 2)) {
+        luaL_checktype(L, 2, LUA_TLIGHTUSERDATA);
+        session = lua_touserdata(L, 2);
+    }
+
+    uint64_t iids[3];
+    for (size_t i = 1; i <= n; i++) {
+        if (luai_unlikely(lua_geti(L, 1, i) != LUA_TTABLE)) {
+            luaL_error(L, "events[%d]: invalid type", i);
+        }
+        for (int j = 0; j < 3; j++) {
+            lua_geti(L, -1, j + 1);
+            int isnum;
+            iids[j] = lua_tointegerx(L, -1, &isnum);
+            if (luai_unlikely(!isnum)) {
+                luaL_error(L, "events[%d][%d]: invalid instance ID", i, j + 1);
+            }
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+        lhap_add_event(L, desc, iids[0], iids[1], iids[2], session);
+    }
+    lhap_commit_events(desc);
     return 0;
 }
 
+static int lhap_char_set_value(lua_State *L) {
+    HAPBaseCharacteristic *characteristic = luaL_checkudata(L, 1, LHAP_CHARACTERISTIC_NAME);
+    lhap_desc *desc = &gv_lhap_desc;
+
+    if (lua_isnoneornil(L, 2)) {
+        lhap_char_slot_reset(L, characteristic);
+        lua_settop(L, 1);
+        return 1;
+    }
+    luaL_argcheck(L, lhap_char_value_check(L, 2, characteristic), 2, "invalid value");
+
+    lhap_attr *attr = lhap_char_get_ext(characteristic)->attr;
+    if (lhap_char_slot_set(L, 2, characteristic) && desc->started && attr) {
+        lhap_add_attr_event(L, desc, attr, NULL);
+        lhap_commit_events(desc);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+static int lhap_get_read_stats(lua_State *L) {
+    lhap_desc *desc = &gv_lhap_desc;
+
+    if (!desc->started) {
+        luaL_error(L, "HAP is not started.");
+    }
+
+    const lhap_read_sched *sched = &desc->read_sched;
+    const lhap_read_stats *stats = &sched->stats;
+    lua_createtable(L, 0, 9);
+    lua_pushinteger(L, sched->num_reads);
+    lua_setfield(L, -2, "reads");
+    lua_pushinteger(L, stats->peak_reads);
+    lua_setfield(L, -2, "peakReads");
+    lua_pushinteger(L, stats->queued);
+    lua_setfield(L, -2, "queued");
+    lua_pushinteger(L, stats->peak_queued);
+    lua_setfield(L, -2, "peakQueued");
+    lua_pushinteger(L, stats->dispatched);
+    lua_setfield(L, -2, "dispatched");
+    lua_pushinteger(L, stats->coalesced);
+    lua_setfield(L, -2, "coalesced");
+    lua_pushinteger(L, stats->rejected);
+    lua_setfield(L, -2, "rejected");
+    lua_pushinteger(L, stats->total_wait);
+    lua_setfield(L, -2, "totalWait");
+    lua_pushinteger(L, stats->max_wait);
+    lua_setfield(L, -2, "maxWait");
+    return 1;
+}
+
+static int lhap_get_ip_storage_stats(lua_State *L) {
+    lhap_desc *desc = &gv_lhap_desc;
+
+    if (!desc->started) {
+        luaL_error(L, "HAP is not started.");
+    }
+
+    const lhap_ip_storage_stats *stats = &desc->ip_stats;
+    lua_createtable(L, 0, 6);
+    lua_pushinteger(L, desc->ip_config.num_sessions);
+    lua_setfield(L, -2, "numSessions");
+    lua_pushinteger(L, stats->sessions);
+    lua_setfield(L, -2, "sessions");
+    lua_pushinteger(L, stats->buffers);
+    lua_setfield(L, -2, "buffers");
+    lua_pushinteger(L, stats->contexts);
+    lua_setfield(L, -2, "contexts");
+    lua_pushinteger(L, stats->notifications);
+    lua_setfield(L, -2, "notifications");
+    lua_pushinteger(L, stats->sessions + stats->buffers + stats->contexts + stats->notifications);
+    lua_setfield(L, -2, "total");
+    return 1;
+}
+
+static int lhap_get_db_stats(lua_State *L) {
+    lhap_desc *desc = &gv_lhap_desc;
+
+    if (!desc->started) {
+        luaL_error(L, "HAP is not started.");
+    }
+
+    const lhap_db_stats *stats = &desc->db.stats;
+    lua_createtable(L, 0, 4);
+    lua_pushinteger(L, stats->num_accessories);
+    lua_setfield(L, -2, "accessories");
+    lua_pushinteger(L, stats->num_services);
+    lua_setfield(L, -2, "services");
+    lua_pushinteger(L, stats->num_chars);
+    lua_setfield(L, -2, "characteristics");
+    lua_pushinteger(L, stats->index_size);
+    lua_setfield(L, -2, "indexSize");
+    return 1;
+}
+
 static int lhap_get_new_iid(lua_State *L) {
     bool bridgedAcc = false;
     if (lua_gettop(L) == 1) {
@@ -2594,6 +3847,10 @@ static const luaL_Reg haplib[] = {
     {"start", lhap_start},
     {"stop", lhap_stop},
     {"raiseEvent", lhap_raise_event},
+    {"raiseEvents", lhap_raise_events},
+    {"getReadStats", lhap_get_read_stats},
+    {"getIPStorageStats", lhap_get_ip_storage_stats},
+    {"getDBStats", lhap_get_db_stats},
     {"getNewInstanceID", lhap_get_new_iid},
     {"getSetupCode", lhap_get_setup_code},
     {"restoreFactorySettings", lhap_restore_factory_settings},
@@ -2601,6 +3858,8 @@ static const luaL_Reg haplib[] = {
     {"AccessoryInformationService", NULL},
     {"HAPProtocolInformationService", NULL},
     {"PairingService", NULL},
+    {"ServiceType", NULL},
+    {"CharType", NULL},
     {NULL, NULL},
 };
 
@@ -2646,6 +3905,8 @@ static const luaL_Reg lhap_char_meth[] = {
     {"setContraints", lhap_char_set_contraints},
     {"setValidVals", lhap_char_set_valid_vals},
     {"setValidValsRanges", lhap_set_valid_vals_ranges},
+    {"getCacheStats", lhap_char_get_cache_stats},
+    {"setValue", lhap_char_set_value},
     {NULL, NULL},
 };
 
@@ -2680,6 +3941,23 @@ LUAMOD_API int luaopen_hap(lua_State *L) {
         lua_setfield(L, -2, ud->name);
     }
 
+    /* set type handles */
+    lua_createtable(L, 0, HAPArrayCount(lhap_service_type_tab));
+    for (size_t i = 0; i < HAPArrayCount(lhap_service_type_tab); i++) {
+        HAPAssert(i == 0 || strcmp(lhap_service_type_tab[i - 1].name, lhap_service_type_tab[i].name) < 0);
+        lua_pushlightuserdata(L, (void *)(lhap_service_type_tab + i));
+        lua_setfield(L, -2, lhap_service_type_tab[i].name);
+    }
+    lua_setfield(L, -2, "ServiceType");
+    lua_createtable(L, 0, HAPArrayCount(lhap_characteristic_type_tab));
+    for (size_t i = 0; i < HAPArrayCount(lhap_characteristic_type_tab); i++) {
+        HAPAssert(i == 0 ||
+            strcmp(lhap_characteristic_type_tab[i - 1].name, lhap_characteristic_type_tab[i].name) < 0);
+        lua_pushlightuserdata(L, (void *)(lhap_characteristic_type_tab + i));
+        lua_setfield(L, -2, lhap_characteristic_type_tab[i].name);
+    }
+    lua_setfield(L, -2, "CharType");
+
     lua_getglobal(L, "core");
     lua_getfield(L, -1, "atexit");
     lua_remove(L, -2);
@@ -43,8 +43,29 @@ static int lhash_create(lua_State *L) {
     return 1;
 }
 
+static int lhash_digest(lua_State *L) {
+    pal_md_type type = luaL_checkoption(L, 1, NULL, lhash_type_strs);
+    size_t len;
+    const char *data = luaL_checklstring(L, 2, &len);
+    size_t keylen = 0;
+    const char *key = luaL_optlstring(L, 3, NULL, &keylen);
+    luaL_argcheck(L, !key || keylen, 3, "empty key");
+    pal_md_ctx *ctx = pal_md_ctx_get_cached(type, key, keylen);
+    if (luai_unlikely(!ctx)) {
+        luaL_error(L, "failed to get a %s context", lhash_type_strs[type]);
+    }
+    size_t olen = pal_md_get_size(ctx);
+    char out[olen];
+    if (luai_unlikely((len && !pal_md_update(ctx, data, len)) || !pal_md_digest(ctx, (uint8_t *)out))) {
+        luaL_error(L, "failed to calculate the digest");
+    }
+    lua_pushlstring(L, out, olen);
+    return 1;
+}
+
 static const luaL_Reg hashlib[] = {
     {"create", lhash_create},
+    {"digest", lhash_digest},
     {NULL, NULL},
 };
 
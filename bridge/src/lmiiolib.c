@@ -0,0 +1,274 @@
+// Copyright (c) 2021-2023 Zebin Wu and homekit-bridge contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of homekit-bridge project authors.
+
+#include <string.h>
+#include <lauxlib.h>
+#include <pal/md.h>
+#include <pal/cipher.h>
+#include <pal/mem.h>
+
+#define LMIIO_CODEC_NAME "MiioCodec*"
+
+#define LMIIO_GET_CODEC(L, idx) \
+    luaL_checkudata(L, idx, LMIIO_CODEC_NAME)
+
+#define LMIIO_MAGIC 0x2131
+#define LMIIO_HEADER_LEN 32
+#define LMIIO_TOKEN_LEN 16
+#define LMIIO_BLOCK_SIZE 16
+
+/**
+ * miIO codec.
+ *
+ * The packets are built in a buffer reused by all requests of the device.
+ */
+typedef struct {
+    bool inited;
+    uint8_t token[LMIIO_TOKEN_LEN];
+    uint8_t key[LMIIO_BLOCK_SIZE];
+    uint8_t iv[LMIIO_BLOCK_SIZE];
+    pal_cipher_ctx cipher;
+    char *buf;
+    size_t buflen;
+} lmiio_codec;
+
+static void lmiio_put_u16(char *p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void lmiio_put_u32(char *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint16_t lmiio_get_u16(const char *p) {
+    const uint8_t *b = (const uint8_t *)p;
+    return (b[0] << 8) | b[1];
+}
+
+static uint32_t lmiio_get_u32(const char *p) {
+    const uint8_t *b = (const uint8_t *)p;
+    return ((uint32_t)b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+}
+
+static bool lmiio_md5(const void *p1, size_t len1, const void *p2, size_t len2,
+    const void *p3, size_t len3, uint8_t *output) {
+    pal_md_ctx *ctx = pal_md_ctx_get_cached(PAL_MD_MD5, NULL, 0);
+    if (!ctx) {
+        return false;
+    }
+    return pal_md_update(ctx, p1, len1) && (len2 == 0 || pal_md_update(ctx, p2, len2)) &&
+        (len3 == 0 || pal_md_update(ctx, p3, len3)) && pal_md_digest(ctx, output);
+}
+
+static char *lmiio_codec_getbuf(lua_State *L, lmiio_codec *codec, size_t len) {
+    if (codec->buflen < len) {
+        char *buf = pal_mem_realloc(codec->buf, len);
+        if (luai_unlikely(!buf)) {
+            luaL_error(L, "failed to alloc buffer");
+        }
+        codec->buf = buf;
+        codec->buflen = len;
+    }
+    return codec->buf;
+}
+
+static bool lmiio_codec_init_cipher(lmiio_codec *codec) {
+    if (!pal_cipher_ctx_init(&codec->cipher, PAL_CIPHER_TYPE_AES_128_CBC)) {
+        return false;
+    }
+    codec->inited = true;
+    return pal_cipher_set_padding(&codec->cipher, PAL_CIPHER_PADDING_PKCS7);
+}
+
+/**
+ * Re-initialize the cipher after a failed process.
+ *
+ * The cipher is left in the middle of the process by the failure,
+ * and the next process could not begin.
+ */
+static void lmiio_codec_reset_cipher(lmiio_codec *codec) {
+    pal_cipher_ctx_deinit(&codec->cipher);
+    codec->inited = false;
+    (void)lmiio_codec_init_cipher(codec);
+}
+
+static bool lmiio_codec_crypt(lmiio_codec *codec, pal_cipher_operation op,
+    const char *in, size_t ilen, char *out, size_t *olen) {
+    if (luai_unlikely(!codec->inited)) {
+        return false;
+    }
+    if (!pal_cipher_begin(&codec->cipher, op, codec->key, codec->iv)) {
+        return false;
+    }
+    size_t len = 0;
+    if (ilen) {
+        len = ilen + LMIIO_BLOCK_SIZE;
+        if (!pal_cipher_update(&codec->cipher, in, ilen, out, &len)) {
+            goto err;
+        }
+    }
+    size_t flen = LMIIO_BLOCK_SIZE;
+    if (!pal_cipher_finish(&codec->cipher, out + len, &flen)) {
+        goto err;
+    }
+    *olen = len + flen;
+    return true;
+
+err:
+    lmiio_codec_reset_cipher(codec);
+    return false;
+}
+
+static int lmiio_create(lua_State *L) {
+    size_t tokenlen;
+    const char *token = luaL_checklstring(L, 1, &tokenlen);
+    luaL_argcheck(L, tokenlen == LMIIO_TOKEN_LEN, 1, "invalid token length");
+
+    lmiio_codec *codec = lua_newuserdata(L, sizeof(lmiio_codec));
+    memset(codec, 0, sizeof(*codec));
+    luaL_setmetatable(L, LMIIO_CODEC_NAME);
+
+    // Key = MD5(Token), IV = MD5(Key + Token)
+    memcpy(codec->token, token, LMIIO_TOKEN_LEN);
+    if (luai_unlikely(!lmiio_md5(token, tokenlen, NULL, 0, NULL, 0, codec->key) ||
+        !lmiio_md5(codec->key, sizeof(codec->key), token, tokenlen, NULL, 0, codec->iv))) {
+        luaL_error(L, "failed to derive the key");
+    }
+    if (luai_unlikely(!lmiio_codec_init_cipher(codec))) {
+        luaL_error(L, "failed to create a AES-128-CBC cipher");
+    }
+    return 1;
+}
+
+static const luaL_Reg lmiio_funcs[] = {
+    {"create", lmiio_create},
+    {NULL, NULL},
+};
+
+static int lmiio_codec_encode(lua_State *L) {
+    lmiio_codec *codec = LMIIO_GET_CODEC(L, 1);
+    lua_Integer devid = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, devid >= 0 && devid <= UINT32_MAX, 2, "devid out of range");
+    lua_Integer stamp = luaL_checkinteger(L, 3);
+    luaL_argcheck(L, stamp >= 0 && stamp <= UINT32_MAX, 3, "stamp out of range");
+    size_t inlen;
+    const char *in = luaL_checklstring(L, 4, &inlen);
+
+    // The PKCS7 padding adds up to a block, the cipher needs another block for the output.
+    char *buf = lmiio_codec_getbuf(L, codec, LMIIO_HEADER_LEN + inlen + LMIIO_BLOCK_SIZE * 2);
+    size_t datalen;
+    if (luai_unlikely(!lmiio_codec_crypt(codec, PAL_CIPHER_OP_ENCRYPT, in, inlen,
+        buf + LMIIO_HEADER_LEN, &datalen))) {
+        luaL_error(L, "failed to encrypt the data");
+    }
+    size_t len = LMIIO_HEADER_LEN + datalen;
+    if (luai_unlikely(len > UINT16_MAX)) {
+        luaL_error(L, "data too long");
+    }
+
+    lmiio_put_u16(buf, LMIIO_MAGIC);
+    lmiio_put_u16(buf + 2, len);
+    lmiio_put_u32(buf + 4, 0);
+    lmiio_put_u32(buf + 8, devid);
+    lmiio_put_u32(buf + 12, stamp);
+    if (luai_unlikely(!lmiio_md5(buf, 16, codec->token, LMIIO_TOKEN_LEN,
+        buf + LMIIO_HEADER_LEN, datalen, (uint8_t *)buf + 16))) {
+        luaL_error(L, "failed to calculate the checksum");
+    }
+    lua_pushlstring(L, buf, len);
+    return 1;
+}
+
+static int lmiio_codec_decode(lua_State *L) {
+    lmiio_codec *codec = LMIIO_GET_CODEC(L, 1);
+    size_t len;
+    const char *pkt = luaL_checklstring(L, 2, &len);
+
+    if (len < 2 || lmiio_get_u16(pkt) != LMIIO_MAGIC) {
+        luaL_error(L, "Invalid magic number.");
+    }
+    if (len < LMIIO_HEADER_LEN || lmiio_get_u16(pkt + 2) != len) {
+        luaL_error(L, "Invalid package length.");
+    }
+
+    const char *data = pkt + LMIIO_HEADER_LEN;
+    size_t datalen = len - LMIIO_HEADER_LEN;
+    uint8_t checksum[16];
+    if (luai_unlikely(!lmiio_md5(pkt, 16, codec->token, LMIIO_TOKEN_LEN, data, datalen, checksum))) {
+        luaL_error(L, "failed to calculate the checksum");
+    }
+    if (memcmp(checksum, pkt + 16, sizeof(checksum))) {
+        luaL_error(L, "Got checksum error which indicates use of an invalid token.");
+    }
+
+    lua_pushinteger(L, lmiio_get_u32(pkt + 8));
+    lua_pushinteger(L, lmiio_get_u32(pkt + 12));
+    if (datalen == 0) {
+        lua_pushnil(L);
+        return 3;
+    }
+
+    char *buf = lmiio_codec_getbuf(L, codec, datalen + LMIIO_BLOCK_SIZE * 2);
+    size_t outlen;
+    if (luai_unlikely(!lmiio_codec_crypt(codec, PAL_CIPHER_OP_DECRYPT, data, datalen, buf, &outlen))) {
+        luaL_error(L, "Failed to decrypt the message.");
+    }
+    lua_pushlstring(L, buf, outlen);
+    return 3;
+}
+
+static int lmiio_codec_gc(lua_State *L) {
+    lmiio_codec *codec = LMIIO_GET_CODEC(L, 1);
+    if (codec->inited) {
+        pal_cipher_ctx_deinit(&codec->cipher);
+    }
+    pal_mem_free(codec->buf);
+    return 0;
+}
+
+static int lmiio_codec_tostring(lua_State *L) {
+    lmiio_codec *codec = LMIIO_GET_CODEC(L, 1);
+    lua_pushfstring(L, "miio codec (%p)", codec);
+    return 1;
+}
+
+/*
+ * metamethods for miio codec
+ */
+static const luaL_Reg lmiio_codec_metameth[] = {
+    {"__index", NULL},  /* place holder */
+    {"__gc", lmiio_codec_gc},
+    {"__tostring", lmiio_codec_tostring},
+    {NULL, NULL}
+};
+
+/*
+ * methods for miio codec
+ */
+static const luaL_Reg lmiio_codec_meth[] = {
+    {"encode", lmiio_codec_encode},
+    {"decode", lmiio_codec_decode},
+    {NULL, NULL},
+};
+
+static void lmiio_createmeta(lua_State *L) {
+    luaL_newmetatable(L, LMIIO_CODEC_NAME);  /* metatable for miio codec */
+    luaL_setfuncs(L, lmiio_codec_metameth, 0);  /* add metamethods to new metatable */
+    luaL_newlibtable(L, lmiio_codec_meth);  /* create method table */
+    luaL_setfuncs(L, lmiio_codec_meth, 0);  /* add miio codec methods to method table */
+    lua_setfield(L, -2, "__index");  /* metatable.__index = method table */
+    lua_pop(L, 1);  /* pop metatable */
+}
+
+LUAMOD_API int luaopen_miio(lua_State *L) {
+    luaL_newlib(L, lmiio_funcs); /* new module */
+    lmiio_createmeta(L);
+    return 1;
+}
@@ -14,6 +14,8 @@
 
 #define LUA_SOCKET_OBJECT_NAME "Socket*"
 
+#define LSOCKET_RECVMANY_MAX 64
+
 typedef struct {
     bool destroyed;
     pal_socket_obj socket;
@@ -258,8 +260,10 @@ static int lsocket_obj_sent_int(lua_State *L, bool all) {
     size_t len;
     const char *data = luaL_checklstring(L, 2, &len);
 
+    // The yielded coroutine keeps the string alive until the data is sent.
     size_t sent_len = len;
-    lua_pushinteger(L, pal_socket_send(&obj->socket, data, &sent_len, all, lsocket_sent_cb, L));
+    lua_pushinteger(L, (lua_isyieldable(L) ? pal_socket_send_nocopy : pal_socket_send)(&obj->socket,
+        data, &sent_len, all, lsocket_sent_cb, L));
     lua_pushinteger(L, sent_len);
     return finishsend(L, 2, (lua_KContext)all);
 }
@@ -281,7 +285,8 @@ static int lsocket_obj_sendto(lua_State *L) {
     luaL_argcheck(L, (port >= 0) && (port <= 65535), 4, "port out of range");
 
     size_t sent_len = len;
-    lua_pushinteger(L, pal_socket_sendto(&obj->socket, data, &sent_len, addr, port, false, lsocket_sent_cb, L));
+    lua_pushinteger(L, (lua_isyieldable(L) ? pal_socket_sendto_nocopy : pal_socket_sendto)(&obj->socket,
+        data, &sent_len, addr, port, false, lsocket_sent_cb, L));
     lua_pushinteger(L, sent_len);
     return finishsend(L, 0, (lua_KContext)false);
 }
@@ -388,6 +393,80 @@ static int lsocket_obj_recvfrom(lua_State *L) {
     }
 }
 
+static void lsocket_recvedmany_cb(pal_socket_obj *o, pal_err err, size_t count, void *arg) {
+    lua_State *co = arg;
+    lua_State *L = lc_getmainthread(co);
+
+    HAPAssert(lua_gettop(L) == 0);
+    lua_pushinteger(co, count);
+    lua_pushinteger(co, err);
+
+    int status, nres;
+    status = lc_resume(co, L, 2, &nres);  // stack <..., count, err>
+    if (luai_unlikely(status != LUA_OK && status != LUA_YIELD)) {
+        HAPLogError(&lsocket_log, "%s: %s", __func__, lua_tostring(L, -1));
+    }
+
+    lua_settop(L, 0);
+    lc_collectgarbage(L);
+}
+
+static int lsocket_push_msgs(lua_State *L, pal_socket_msg *msgs, size_t count) {
+    lua_createtable(L, count, 0);
+    for (size_t i = 0; i < count; i++) {
+        lua_createtable(L, 0, 3);
+        lua_pushlstring(L, msgs[i].buf, msgs[i].len);
+        lua_setfield(L, -2, "data");
+        lua_pushstring(L, msgs[i].addr);
+        lua_setfield(L, -2, "addr");
+        lua_pushinteger(L, msgs[i].port);
+        lua_setfield(L, -2, "port");
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+static int finishrecvmany(lua_State *L, int status, lua_KContext extra) {
+    pal_socket_msg *msgs = (pal_socket_msg *)extra;
+    pal_err err = lua_tointeger(L, -1);
+    size_t count = lua_tointeger(L, -2);
+    lua_pop(L, 2);
+
+    if (luai_unlikely(err != PAL_ERR_OK)) {
+        lua_pushstring(L, pal_err_string(err));
+        return lua_error(L);
+    }
+    return lsocket_push_msgs(L, msgs, count);
+}
+
+static int lsocket_obj_recvmany(lua_State *L) {
+    lsocket_obj *obj = lsocket_obj_get(L, 1);
+    lua_Integer maxcount = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, maxcount > 0 && maxcount <= LSOCKET_RECVMANY_MAX, 2, "maxcount out of range");
+    lua_Integer maxlen = luaL_checkinteger(L, 3);
+    luaL_argcheck(L, maxlen > 0 && maxlen <= UINT16_MAX, 3, "maxlen out of range");
+
+    // The messages stay on the stack while the coroutine is yielded.
+    pal_socket_msg *msgs = lua_newuserdatauv(L, maxcount * (sizeof(pal_socket_msg) + maxlen), 0);
+    char *buf = (char *)(msgs + maxcount);
+    for (lua_Integer i = 0; i < maxcount; i++) {
+        msgs[i].buf = buf + i * maxlen;
+        msgs[i].len = maxlen;
+    }
+
+    size_t count = maxcount;
+    pal_err err = pal_socket_recvmany(&obj->socket, msgs, &count, lsocket_recvedmany_cb, L);
+    switch (err) {
+    case PAL_ERR_OK:
+        return lsocket_push_msgs(L, msgs, count);
+    case PAL_ERR_IN_PROGRESS:
+        return lua_yieldk(L, 0, (lua_KContext)msgs, finishrecvmany);
+    default:
+        lua_pushstring(L, pal_err_string(err));
+        return lua_error(L);
+    }
+}
+
 static int lsocket_obj_readable(lua_State *L) {
     lsocket_obj *obj = lsocket_obj_get(L, 1);
     lua_pushboolean(L, pal_socket_readable(&obj->socket));
@@ -440,6 +519,7 @@ static const luaL_Reg lsocket_obj_meth[] = {
     {"sendto", lsocket_obj_sendto},
     {"recv", lsocket_obj_recv},
     {"recvfrom", lsocket_obj_recvfrom},
+    {"recvmany", lsocket_obj_recvmany},
     {"readable", lsocket_obj_readable},
     {"destroy", lsocket_obj_destroy},
     {NULL, NULL}
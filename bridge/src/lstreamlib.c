@@ -376,8 +376,10 @@ static int lstream_client_write(lua_State *L) {
     size_t len;
     const char *data = luaL_checklstring(L, 2, &len);
 
+    // The yielded coroutine keeps the string alive until the write is done.
     pal_err err;
-    err = pal_socket_send(&client->sock, data, &len, true, lstream_client_write_sent_cb, client);
+    err = (lua_isyieldable(L) ? pal_socket_send_nocopy : pal_socket_send)(&client->sock,
+        data, &len, true, lstream_client_write_sent_cb, client);
     switch (err) {
     case PAL_ERR_OK:
         return 0;
@@ -0,0 +1,361 @@
+// Copyright (c) 2021-2023 Zebin Wu and homekit-bridge contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of homekit-bridge project authors.
+
+#include <string.h>
+#include <pal/mem.h>
+#include <HAPBase.h>
+
+#ifdef PAL_MEM_HEAP_SLAB
+
+// Size of a slab, it is split into blocks of the same size class.
+#define PAL_MEM_SLAB_SIZE 4096
+
+// Blocks larger than this are allocated from the system allocator.
+#define PAL_MEM_SLAB_MAX_BLOCK 256
+
+static const size_t pal_mem_class_sizes[] = {
+    8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+};
+
+#define PAL_MEM_NUM_CLASSES HAPArrayCount(pal_mem_class_sizes)
+
+typedef struct pal_mem_block {
+    struct pal_mem_block *next;
+} pal_mem_block;
+
+/**
+ * Slab, the header is placed at the start of the slab and followed by the blocks.
+ */
+typedef struct pal_mem_slab {
+    struct pal_mem_slab *next;      /* Next slab with free blocks of the pool. */
+    struct pal_mem_slab **pprev;    /* NULL if the slab has no free block. */
+    pal_mem_block *free;            /* Freed blocks. */
+    char *cur;                      /* Unused space. */
+    char *end;
+    size_t cls;                     /* Size class. */
+    size_t used;                    /* Number of blocks in use. */
+} pal_mem_slab;
+
+// Size of the slab header, the blocks are aligned to 16 bytes.
+#define PAL_MEM_SLAB_HDR_SIZE ((sizeof(pal_mem_slab) + 15) & ~(size_t)15)
+
+/**
+ * Pool of a size class.
+ */
+typedef struct pal_mem_pool {
+    pal_mem_slab *partial;  /* Slabs with free blocks. */
+} pal_mem_pool;
+
+static struct {
+    bool inited;
+    uint8_t classes[PAL_MEM_SLAB_MAX_BLOCK / 8 + 1];  /* Size class of the sizes in 8 bytes. */
+    pal_mem_pool pools[PAL_MEM_NUM_CLASSES];
+    pal_mem_slab **slabs;   /* Slabs sorted by address, to find the slab of a block. */
+    size_t num_slabs;
+    size_t cap_slabs;
+    pal_mem_class_stats stats[PAL_MEM_NUM_CLASSES + 1];    /* The last one is the system allocator. */
+} gv_pal_mem_heap;
+
+static void pal_mem_heap_init(void) {
+    size_t cls = 0;
+    for (size_t i = 0; i < HAPArrayCount(gv_pal_mem_heap.classes); i++) {
+        while (pal_mem_class_sizes[cls] < i * 8) {
+            cls++;
+        }
+        gv_pal_mem_heap.classes[i] = cls;
+    }
+    for (size_t i = 0; i < PAL_MEM_NUM_CLASSES; i++) {
+        gv_pal_mem_heap.stats[i].size = pal_mem_class_sizes[i];
+    }
+    gv_pal_mem_heap.inited = true;
+}
+
+/**
+ * Get the size class of the size, PAL_MEM_NUM_CLASSES for the system allocator.
+ */
+static inline size_t pal_mem_heap_class(size_t size) {
+    if (size > PAL_MEM_SLAB_MAX_BLOCK) {
+        return PAL_MEM_NUM_CLASSES;
+    }
+    return gv_pal_mem_heap.classes[(size + 7) / 8];
+}
+
+static inline void pal_mem_heap_account(size_t cls, size_t osize, size_t nsize) {
+    pal_mem_class_stats *stats = &gv_pal_mem_heap.stats[cls];
+    stats->live = stats->live - osize + nsize;
+    if (stats->live > stats->peak) {
+        stats->peak = stats->live;
+    }
+}
+
+/**
+ * Get the index of the first slab whose address is greater than ptr.
+ */
+static size_t pal_mem_slab_upper(const void *ptr) {
+    size_t lo = 0, hi = gv_pal_mem_heap.num_slabs;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((const char *)gv_pal_mem_heap.slabs[mid] <= (const char *)ptr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Find the slab of the block.
+ *
+ * @returns NULL if the block is from the system allocator.
+ */
+static pal_mem_slab *pal_mem_slab_find(const void *ptr) {
+    size_t idx = pal_mem_slab_upper(ptr);
+    if (idx == 0) {
+        return NULL;
+    }
+    pal_mem_slab *slab = gv_pal_mem_heap.slabs[idx - 1];
+    return (const char *)ptr < (const char *)slab + PAL_MEM_SLAB_SIZE ? slab : NULL;
+}
+
+static void pal_mem_slab_link(pal_mem_pool *pool, pal_mem_slab *slab) {
+    slab->next = pool->partial;
+    if (slab->next) {
+        slab->next->pprev = &slab->next;
+    }
+    slab->pprev = &pool->partial;
+    pool->partial = slab;
+}
+
+static void pal_mem_slab_unlink(pal_mem_slab *slab) {
+    *(slab->pprev) = slab->next;
+    if (slab->next) {
+        slab->next->pprev = slab->pprev;
+    }
+    slab->next = NULL;
+    slab->pprev = NULL;
+}
+
+static pal_mem_slab *pal_mem_slab_create(size_t cls) {
+    if (gv_pal_mem_heap.num_slabs == gv_pal_mem_heap.cap_slabs) {
+        size_t cap = gv_pal_mem_heap.cap_slabs ? gv_pal_mem_heap.cap_slabs * 2 : 16;
+        pal_mem_slab **slabs = pal_mem_realloc(gv_pal_mem_heap.slabs, cap * sizeof(*slabs));
+        if (!slabs) {
+            return NULL;
+        }
+        gv_pal_mem_heap.slabs = slabs;
+        gv_pal_mem_heap.cap_slabs = cap;
+    }
+    pal_mem_slab *slab = pal_mem_alloc(PAL_MEM_SLAB_SIZE);
+    if (!slab) {
+        return NULL;
+    }
+    size_t size = pal_mem_class_sizes[cls];
+    slab->next = NULL;
+    slab->pprev = NULL;
+    slab->free = NULL;
+    slab->cur = (char *)slab + PAL_MEM_SLAB_HDR_SIZE;
+    slab->end = slab->cur + (PAL_MEM_SLAB_SIZE - PAL_MEM_SLAB_HDR_SIZE) / size * size;
+    slab->cls = cls;
+    slab->used = 0;
+
+    size_t idx = pal_mem_slab_upper(slab);
+    memmove(gv_pal_mem_heap.slabs + idx + 1, gv_pal_mem_heap.slabs + idx,
+        (gv_pal_mem_heap.num_slabs - idx) * sizeof(*gv_pal_mem_heap.slabs));
+    gv_pal_mem_heap.slabs[idx] = slab;
+    gv_pal_mem_heap.num_slabs++;
+    gv_pal_mem_heap.stats[cls].slabs++;
+    return slab;
+}
+
+static void pal_mem_slab_destroy(pal_mem_slab *slab) {
+    if (slab->pprev) {
+        pal_mem_slab_unlink(slab);
+    }
+    size_t idx = pal_mem_slab_upper(slab) - 1;
+    HAPAssert(gv_pal_mem_heap.slabs[idx] == slab);
+    gv_pal_mem_heap.num_slabs--;
+    memmove(gv_pal_mem_heap.slabs + idx, gv_pal_mem_heap.slabs + idx + 1,
+        (gv_pal_mem_heap.num_slabs - idx) * sizeof(*gv_pal_mem_heap.slabs));
+    gv_pal_mem_heap.stats[slab->cls].slabs--;
+    pal_mem_free(slab);
+}
+
+static void *pal_mem_pool_alloc(size_t cls) {
+    pal_mem_pool *pool = &gv_pal_mem_heap.pools[cls];
+
+    pal_mem_slab *slab = pool->partial;
+    if (!slab) {
+        slab = pal_mem_slab_create(cls);
+        if (!slab) {
+            return NULL;
+        }
+        pal_mem_slab_link(pool, slab);
+    }
+
+    pal_mem_block *block = slab->free;
+    if (block) {
+        slab->free = block->next;
+    } else {
+        block = (pal_mem_block *)slab->cur;
+        slab->cur += pal_mem_class_sizes[cls];
+    }
+    slab->used++;
+    if (!slab->free && slab->cur == slab->end) {
+        pal_mem_slab_unlink(slab);
+    }
+    return block;
+}
+
+/**
+ * Free a block to its slab.
+ *
+ * An empty slab is returned to the system, unless it is the only slab
+ * with free blocks of the pool, which is kept to absorb the alloc/free churn.
+ */
+static void pal_mem_pool_free(pal_mem_slab *slab, void *ptr) {
+    pal_mem_pool *pool = &gv_pal_mem_heap.pools[slab->cls];
+    pal_mem_block *block = ptr;
+    block->next = slab->free;
+    slab->free = block;
+    if (!slab->pprev) {
+        pal_mem_slab_link(pool, slab);
+    }
+    slab->used--;
+    if (slab->used == 0 && (pool->partial != slab || slab->next)) {
+        pal_mem_slab_destroy(slab);
+    }
+}
+
+/**
+ * Free a block, the slab of the block is found by its address,
+ * because a block kept by a failed shrink is smaller than its size class.
+ */
+static void pal_mem_heap_free(void *ptr, size_t osize) {
+    pal_mem_slab *slab = pal_mem_slab_find(ptr);
+    if (slab) {
+        pal_mem_heap_account(slab->cls, pal_mem_class_sizes[slab->cls], 0);
+        pal_mem_pool_free(slab, ptr);
+    } else {
+        pal_mem_heap_account(PAL_MEM_NUM_CLASSES, osize, 0);
+        pal_mem_free(ptr);
+    }
+}
+
+void *pal_mem_heap_realloc(void *ptr, size_t osize, size_t nsize) {
+    if (!gv_pal_mem_heap.inited) {
+        pal_mem_heap_init();
+    }
+    if (!ptr) {
+        osize = 0;
+    }
+
+    if (nsize == 0) {
+        if (ptr) {
+            pal_mem_heap_free(ptr, osize);
+        }
+        return NULL;
+    }
+
+    // The block is always at least as large as the size class of osize.
+    size_t ocls = ptr ? pal_mem_heap_class(osize) : PAL_MEM_NUM_CLASSES;
+    size_t ncls = pal_mem_heap_class(nsize);
+    void *nptr;
+    if (ptr && ocls == ncls) {
+        if (ncls != PAL_MEM_NUM_CLASSES) {
+            // The block is large enough.
+            return ptr;
+        }
+        nptr = pal_mem_realloc(ptr, nsize);
+        if (nptr) {
+            pal_mem_heap_account(ncls, osize, nsize);
+        }
+        return nptr;
+    }
+
+    if (ncls == PAL_MEM_NUM_CLASSES) {
+        nptr = pal_mem_alloc(nsize);
+    } else {
+        nptr = pal_mem_pool_alloc(ncls);
+    }
+    if (!nptr) {
+        if (ptr && nsize < osize) {
+            // Keep the larger block, a shrink does not fail.
+            if (!pal_mem_slab_find(ptr)) {
+                pal_mem_heap_account(PAL_MEM_NUM_CLASSES, osize, nsize);
+            }
+            return ptr;
+        }
+        return NULL;
+    }
+    pal_mem_heap_account(ncls, 0, ncls == PAL_MEM_NUM_CLASSES ? nsize : pal_mem_class_sizes[ncls]);
+    if (ptr) {
+        memcpy(nptr, ptr, osize < nsize ? osize : nsize);
+        pal_mem_heap_free(ptr, osize);
+    }
+    return nptr;
+}
+
+void pal_mem_heap_trim(void) {
+    for (size_t cls = 0; cls < PAL_MEM_NUM_CLASSES; cls++) {
+        pal_mem_slab *slab = gv_pal_mem_heap.pools[cls].partial;
+        while (slab) {
+            pal_mem_slab *next = slab->next;
+            if (slab->used == 0) {
+                pal_mem_slab_destroy(slab);
+            }
+            slab = next;
+        }
+    }
+    if (gv_pal_mem_heap.num_slabs == 0) {
+        pal_mem_free(gv_pal_mem_heap.slabs);
+        gv_pal_mem_heap.slabs = NULL;
+        gv_pal_mem_heap.cap_slabs = 0;
+    }
+}
+
+const pal_mem_class_stats *pal_mem_heap_get_stats(size_t *count) {
+    HAPPrecondition(count);
+    if (!gv_pal_mem_heap.inited) {
+        pal_mem_heap_init();
+    }
+    *count = HAPArrayCount(gv_pal_mem_heap.stats);
+    return gv_pal_mem_heap.stats;
+}
+
+#else
+
+static pal_mem_class_stats gv_pal_mem_heap_stats;
+
+void *pal_mem_heap_realloc(void *ptr, size_t osize, size_t nsize) {
+    if (!ptr) {
+        osize = 0;
+    }
+    if (nsize == 0) {
+        pal_mem_free(ptr);
+        gv_pal_mem_heap_stats.live -= osize;
+        return NULL;
+    }
+    void *nptr = pal_mem_realloc(ptr, nsize);
+    if (nptr) {
+        gv_pal_mem_heap_stats.live = gv_pal_mem_heap_stats.live - osize + nsize;
+        if (gv_pal_mem_heap_stats.live > gv_pal_mem_heap_stats.peak) {
+            gv_pal_mem_heap_stats.peak = gv_pal_mem_heap_stats.live;
+        }
+    }
+    return nptr;
+}
+
+void pal_mem_heap_trim(void) {
+}
+
+const pal_mem_class_stats *pal_mem_heap_get_stats(size_t *count) {
+    HAPPrecondition(count);
+    *count = 1;
+    return &gv_pal_mem_heap_stats;
+}
+
+#endif
@@ -31,7 +31,7 @@ typedef HAP_OPAQUE(432) pal_ssl_ctx;
 /**
  * Opaque structure for socket object.
  */
-typedef HAP_OPAQUE(112) pal_socket_obj;
+typedef HAP_OPAQUE(116) pal_socket_obj;
 
 /**
  * Opaque structure for network address.
@@ -21,6 +21,7 @@
 #endif
 
 static bool ginited;
+static size_t gmax_ip_sessions = PAL_HAP_IP_SESSION_STORAGE_NUM_ELEMENTS;
 
 static struct {
     HAPPlatformKeyValueStore keyValueStore;
@@ -126,7 +127,7 @@ void pal_hap_init_platform(HAPPlatform *platform) {
             platform->ip.tcpStreamManager,
             &(const HAPPlatformTCPStreamManagerOptions) {
                     .port = kHAPNetworkPort_Any,  // Listen on unused port number from the ephemeral port range.
-                    .maxConcurrentTCPStreams = PAL_HAP_IP_SESSION_STORAGE_NUM_ELEMENTS });
+                    .maxConcurrentTCPStreams = gmax_ip_sessions });
 
     // Service discovery.
     platform->ip.serviceDiscovery = &gplatform.serviceDiscovery;
@@ -154,6 +155,25 @@ void pal_hap_init_platform(HAPPlatform *platform) {
     ginited = true;
 }
 
+void pal_hap_set_max_ip_sessions(HAPPlatform *platform, size_t num) {
+    HAPPrecondition(platform);
+    HAPPrecondition(ginited);
+    HAPPrecondition(num);
+
+    if (num == gmax_ip_sessions) {
+        return;
+    }
+    gmax_ip_sessions = num;
+
+    // Re-create the TCP stream manager.
+    HAPPlatformTCPStreamManagerRelease(platform->ip.tcpStreamManager);
+    HAPPlatformTCPStreamManagerCreate(
+            platform->ip.tcpStreamManager,
+            &(const HAPPlatformTCPStreamManagerOptions) {
+                    .port = kHAPNetworkPort_Any,  // Listen on unused port number from the ephemeral port range.
+                    .maxConcurrentTCPStreams = gmax_ip_sessions });
+}
+
 void pal_hap_deinit_platform(HAPPlatform *platform) {
     HAPPrecondition(platform);
 
@@ -130,6 +130,21 @@ bool pal_cipher_ctx_init(pal_cipher_ctx *ctx, pal_cipher_type type);
  */
 void pal_cipher_ctx_deinit(pal_cipher_ctx *ctx);
 
+/**
+ * Get the cipher context cached by the current thread.
+ *
+ * One context is cached per cipher type, it is reset to the state
+ * of a newly initialized context and ready for pal_cipher_begin().
+ * The context is valid until the next call with the same type,
+ * and must not be released by pal_cipher_ctx_deinit().
+ *
+ * @param type Type of the cipher.
+ *
+ * @return the cached context on success.
+ * @return NULL on failure.
+ */
+pal_cipher_ctx *pal_cipher_ctx_get_cached(pal_cipher_type type);
+
 /**
  * Return the block size of the given cipher in bytes.
  *
@@ -13,23 +13,33 @@ extern "C" {
 
 #include <HAP.h>
 
-// Number of elements in a HAPIPSessionStorage.
+// Default number of elements in a HAPIPSessionStorage.
 #define PAL_HAP_IP_SESSION_STORAGE_NUM_ELEMENTS ((size_t) 5)
 
-// Size for the inbound buffer of an IP session.
+// Default size for the inbound buffer of an IP session.
 #define PAL_HAP_IP_SESSION_STORAGE_INBOUND_BUFSIZE ((size_t) 1500)
 
-// Size for the outbound buffer of an IP session.
+// Default size for the outbound buffer of an IP session.
 #define PAL_HAP_IP_SESSION_STORAGE_OUTBOUND_BUFSIZE ((size_t) 1500)
 
-// Size for the scratch buffer of an IP session.
+// Default size for the scratch buffer of an IP session.
 #define PAL_HAP_IP_SESSION_STORAGE_SCRATCH_BUFSIZE ((size_t) 1500)
 
+// Minimum size for the buffers of an IP session, enough for one encrypted frame
+// (2 bytes length, up to 1024 bytes payload and 16 bytes authentication tag).
+#define PAL_HAP_IP_SESSION_STORAGE_MIN_BUFSIZE ((size_t) 1042)
+
 /**
  * Initialize HAP platform structure.
  */
 void pal_hap_init_platform(HAPPlatform *platform);
 
+/**
+ * Set the maximum number of concurrent IP sessions.
+ * This function must be called after pal_hap_init_platform() and before the accessory server is created.
+ */
+void pal_hap_set_max_ip_sessions(HAPPlatform *platform, size_t num);
+
 /**
  * De-initialize HAP platform structure.
  */
@@ -55,6 +55,23 @@ bool pal_md_ctx_init(pal_md_ctx *ctx, pal_md_type type, const void *key, size_t
  */
 void pal_md_ctx_deinit(pal_md_ctx *ctx);
 
+/**
+ * Get the message-digest context cached by the current thread.
+ *
+ * One context is cached per digest type and per HMAC usage, it is
+ * started with the given key and ready for pal_md_update().
+ * The context is valid until the next call with the same type,
+ * and must not be released by pal_md_ctx_deinit().
+ *
+ * @param type Type of digest.
+ * @param key If key is set, HMAC will be used.
+ * @param len Length of @p key.
+ *
+ * @return the cached context on success.
+ * @return NULL on failure.
+ */
+pal_md_ctx *pal_md_ctx_get_cached(pal_md_type type, const void *key, size_t len);
+
 /**
  * Return the size of message-digest.
  *
@@ -56,6 +56,54 @@ void *pal_mem_realloc(void *ptr, size_t size);
 void pal_mem_free(void *p);
 #endif
 
+/**
+ * Allocator of the Lua heap.
+ *
+ * The caller always passes the size of the block, so the allocator does not keep it.
+ * With PAL_MEM_HEAP_SLAB defined in <pal/mem_int.h>, the small blocks are allocated
+ * from size-class slab pools, and the large blocks from the system allocator,
+ * otherwise all blocks are allocated from the system allocator. An empty slab is
+ * returned to the system at once, except the last one with free blocks of each class.
+ */
+
+/**
+ * Statistics of a size class of the Lua heap.
+ */
+typedef struct pal_mem_class_stats {
+    size_t size;        /**< Block size in bytes, 0 for the blocks from the system allocator. */
+    size_t live;        /**< Bytes in use. */
+    size_t peak;        /**< Peak bytes in use. */
+    size_t slabs;       /**< Number of slabs. */
+} pal_mem_class_stats;
+
+/**
+ * Change the size of the block of the Lua heap.
+ *
+ * If ptr is NULL, a new block is allocated and osize is ignored.
+ * If nsize is equal to 0, the block is freed and NULL is returned.
+ * If it fails, the original block is left untouched and NULL is returned.
+ *
+ * @param ptr The block or NULL.
+ * @param osize The size of the block.
+ * @param nsize The new size of the block.
+ */
+void *pal_mem_heap_realloc(void *ptr, size_t osize, size_t nsize);
+
+/**
+ * Return the free memory cached by the Lua heap allocator to the system.
+ *
+ * It is called after the Lua state is closed.
+ */
+void pal_mem_heap_trim(void);
+
+/**
+ * Get the statistics of the size classes of the Lua heap.
+ *
+ * @param count The number of size classes.
+ * @returns the array of the statistics.
+ */
+const pal_mem_class_stats *pal_mem_heap_get_stats(size_t *count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -244,6 +244,30 @@ pal_err pal_socket_send(pal_socket_obj *o, const void *data, size_t *len, bool a
 pal_err pal_socket_sendto(pal_socket_obj *o, const void *data, size_t *len,
     const char *addr, uint16_t port, bool all, pal_socket_sent_cb sent_cb, void *arg);
 
+/**
+ * Send data without copying it.
+ *
+ * Same as @b pal_socket_send(), but if the data cannot be sent at once,
+ * the socket references @p data instead of copying it.
+ *
+ * @attention If PAL_ERR_IN_PROGRESS is returned, @p data must remain valid
+ *            until @p sent_cb is called or the socket is deinitialized.
+ */
+pal_err pal_socket_send_nocopy(pal_socket_obj *o, const void *data, size_t *len, bool all,
+    pal_socket_sent_cb sent_cb, void *arg);
+
+/**
+ * Send data to remote addr and port without copying it.
+ *
+ * Same as @b pal_socket_sendto(), but if the data cannot be sent at once,
+ * the socket references @p data instead of copying it.
+ *
+ * @attention If PAL_ERR_IN_PROGRESS is returned, @p data must remain valid
+ *            until @p sent_cb is called or the socket is deinitialized.
+ */
+pal_err pal_socket_sendto_nocopy(pal_socket_obj *o, const void *data, size_t *len,
+    const char *addr, uint16_t port, bool all, pal_socket_sent_cb sent_cb, void *arg);
+
 /**
  * A callback called when a socket received data.
  *
@@ -294,6 +318,46 @@ pal_err pal_socket_recv(pal_socket_obj *o, void *buf, size_t *len,
 pal_err pal_socket_recvfrom(pal_socket_obj *o, void *buf, size_t *len, char *addr,
     size_t addrlen, uint16_t *port, pal_socket_recved_cb recved_cb, void *arg);
 
+/**
+ * A message received by @b pal_socket_recvmany().
+ */
+typedef struct {
+    void *buf;  /**< The buf to hold data. */
+    size_t len;  /**< The length of @p buf, to be updated with the actual number of Bytes received. */
+    char addr[PAL_NET_ADDR_STR_LEN];  /**< Remote address. */
+    uint16_t port;  /**< Remote port. */
+} pal_socket_msg;
+
+/**
+ * A callback called when a socket received messages.
+ *
+ * @param o The pointer to the socket object.
+ * @param err The error of the receive procress.
+ * @param count The number of the received messages.
+ * @param arg The last paramter of @b pal_socket_recvmany().
+ */
+typedef void (*pal_socket_recvedmany_cb)(pal_socket_obj *o, pal_err err, size_t count, void *arg);
+
+/**
+ * Receive multiple messages at once.
+ *
+ * Wait for the first message, then receive all the queued messages
+ * that fit in @p msgs without waiting.
+ *
+ * @param o The pointer to the UDP socket object.
+ * @param[inout] msgs The messages to hold data, they must be alloc, and free after the receive done.
+ * @param[inout] count The number of @p msgs, to be updated with the number of messages received.
+ * @param recvedmany_cb A callback called when the messages are received.
+ * @param arg The value to be passed as the last argument to @p recvedmany_cb.
+ *
+ * @return PAL_ERR_OK on success.
+ * @return PAL_ERR_IN_PROGRESS means it will take a while to recv,
+ *         @p recvedmany_cb will be called when the messages are received.
+ * @return other error number on failure.
+ */
+pal_err pal_socket_recvmany(pal_socket_obj *o, pal_socket_msg *msgs, size_t *count,
+    pal_socket_recvedmany_cb recvedmany_cb, void *arg);
+
 /**
  * Whether the socket is readable.
  *
@@ -7,6 +7,9 @@
 # system api
 set(CONFIG_POSIX ON)
 
+# run loop backend, use the select() run loop of the ADK if OFF
+set(CONFIG_EPOLL ON)
+
 # crypto library
 set(CONFIG_OPENSSL ON)
 set(CONFIG_MBEDTLS OFF)
@@ -42,6 +42,12 @@ extern "C" {
  */
 #define pal_mem_free(ptr) free(ptr)
 
+/**
+ * Allocate the small blocks of the Lua heap from size-class slab pools.
+ * Remove it to use the system allocator.
+ */
+#define PAL_MEM_HEAP_SLAB 1
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,7 +31,7 @@ typedef HAP_OPAQUE(48) pal_ssl_ctx;
 /**
  * Opaque structure for socket object.
  */
-typedef HAP_OPAQUE(176) pal_socket_obj;
+typedef HAP_OPAQUE(184) pal_socket_obj;
 
 /**
  * Opaque structure for network address.
@@ -56,6 +56,33 @@ void pal_md_ctx_deinit(pal_md_ctx *_ctx) {
     mbedtls_md_free(&ctx->ctx);
 }
 
+pal_md_ctx *pal_md_ctx_get_cached(pal_md_type type, const void *key, size_t len) {
+    HAPPrecondition(type >= 0 && type < PAL_MD_TYPE_MAX);
+    HAPPrecondition((key && len) || (!key && !len));
+
+    static _Thread_local pal_md_ctx cached_ctxs[2][PAL_MD_TYPE_MAX];
+    static _Thread_local bool cached_inited[2][PAL_MD_TYPE_MAX];
+
+    bool hmac = key != NULL;
+    pal_md_ctx *_ctx = &cached_ctxs[hmac][type];
+    if (!cached_inited[hmac][type]) {
+        if (!pal_md_ctx_init(_ctx, type, key, len)) {
+            return NULL;
+        }
+        cached_inited[hmac][type] = true;
+        return _ctx;
+    }
+
+    pal_md_ctx_int *ctx = (pal_md_ctx_int *)_ctx;
+    int ret;
+    if (hmac) {
+        ret = mbedtls_md_hmac_starts(&ctx->ctx, key, len);
+    } else {
+        ret = mbedtls_md_starts(&ctx->ctx);
+    }
+    return ret ? NULL : _ctx;
+}
+
 size_t pal_md_get_size(pal_md_ctx *_ctx) {
     HAPPrecondition(_ctx);
     pal_md_ctx_int *ctx = (pal_md_ctx_int *)_ctx;
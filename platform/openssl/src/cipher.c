@@ -140,6 +140,28 @@ void pal_cipher_ctx_deinit(pal_cipher_ctx *_ctx) {
     EVP_CIPHER_CTX_free(ctx->ctx);
 }
 
+pal_cipher_ctx *pal_cipher_ctx_get_cached(pal_cipher_type type) {
+    HAPPrecondition(type >= 0 && type < PAL_CIPHER_TYPE_MAX);
+
+    static _Thread_local pal_cipher_ctx cached_ctxs[PAL_CIPHER_TYPE_MAX];
+    static _Thread_local bool cached_inited[PAL_CIPHER_TYPE_MAX];
+
+    pal_cipher_ctx *_ctx = &cached_ctxs[type];
+    if (!cached_inited[type]) {
+        if (!pal_cipher_ctx_init(_ctx, type)) {
+            return NULL;
+        }
+        cached_inited[type] = true;
+        return _ctx;
+    }
+
+    // The previous process may be aborted by an error.
+    pal_cipher_ctx_int *ctx = (pal_cipher_ctx_int *)_ctx;
+    ctx->op = PAL_CIPHER_OP_NONE;
+    ctx->padding = PAL_CIPHER_PADDING_NONE;
+    return _ctx;
+}
+
 size_t pal_cipher_get_block_size(pal_cipher_ctx *_ctx) {
     HAPPrecondition(_ctx);
     pal_cipher_ctx_int *ctx = (pal_cipher_ctx_int *)_ctx;
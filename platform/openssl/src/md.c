@@ -85,6 +85,35 @@ void pal_md_ctx_deinit(pal_md_ctx *_ctx) {
     }
 }
 
+pal_md_ctx *pal_md_ctx_get_cached(pal_md_type type, const void *key, size_t len) {
+    HAPPrecondition(type >= 0 && type < PAL_MD_TYPE_MAX);
+    HAPPrecondition((key && len) || (!key && !len));
+
+    static _Thread_local pal_md_ctx cached_ctxs[2][PAL_MD_TYPE_MAX];
+    static _Thread_local bool cached_inited[2][PAL_MD_TYPE_MAX];
+
+    bool hmac = key != NULL;
+    pal_md_ctx *_ctx = &cached_ctxs[hmac][type];
+    if (!cached_inited[hmac][type]) {
+        if (!pal_md_ctx_init(_ctx, type, key, len)) {
+            return NULL;
+        }
+        cached_inited[hmac][type] = true;
+        return _ctx;
+    }
+
+    // pal_md_digest() cleans up the digest context, so set the digest again.
+    pal_md_ctx_int *ctx = (pal_md_ctx_int *)_ctx;
+    const EVP_MD *md = pal_md_get_md(type);
+    int ret;
+    if (hmac) {
+        ret = HMAC_Init_ex(ctx->ctx, key, len, md, NULL);
+    } else {
+        ret = EVP_DigestInit_ex(ctx->ctx, md, NULL);
+    }
+    return ret ? _ctx : NULL;
+}
+
 size_t pal_md_get_size(pal_md_ctx *_ctx) {
     HAPPrecondition(_ctx);
     pal_md_ctx_int *ctx = (pal_md_ctx_int *)_ctx;
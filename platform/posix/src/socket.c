@@ -4,6 +4,8 @@
 // you may not use this file except in compliance with the License.
 // See [CONTRIBUTORS.md] for the list of homekit-bridge project authors.
 
+#define _GNU_SOURCE  // recvmmsg()
+
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -12,6 +14,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <pal/socket.h>
 #include <pal/mem.h>
 
@@ -39,6 +42,16 @@
 
 #define PAL_SOCKET_OBJ_MAGIC 0x1515
 
+/**
+ * The max number of queued mbufs gathered into one writev().
+ */
+#define PAL_SOCKET_MBUF_GATHER_MAX 16
+
+/**
+ * The max number of messages received by one pal_socket_raw_recvmany().
+ */
+#define PAL_SOCKET_RECVMANY_MAX 32
+
 HAP_ENUM_BEGIN(uint8_t, pal_socket_state) {
     PAL_SOCKET_ST_NONE,
     PAL_SOCKET_ST_CONNECTING,
@@ -61,9 +74,10 @@ typedef struct pal_socket_mbuf {
     struct pal_socket_mbuf *next;
     size_t sent_len;
     size_t len;
-    char *pos;
+    const char *pos;
     bool all;
-    char buf[0];
+    bool done;  // Completed by a gathered write, waiting for its sent_cb.
+    char buf[0];  // Empty if the mbuf references the caller's data.
 } pal_socket_mbuf;
 
 typedef struct pal_socket_obj_int {
@@ -90,9 +104,11 @@ typedef struct pal_socket_obj_int {
     HAPPlatformFileHandleCallback handle_cb;
     HAPPlatformFileHandleRef handle;
     HAPPlatformFileHandleEvent interests;
+    bool recvmany;  // recv_buf and recv_buflen are the messages and the count.
 
     pal_socket_mbuf *mbuf_list_head;
     pal_socket_mbuf **mbuf_list_ptail;
+    bool *destroyed;
 
     void *bio_ctx;
     pal_socket_bio_method bio_method;
@@ -181,8 +197,8 @@ pal_socket_addr_get_str_addr(pal_socket_addr *addr, char *buf, size_t buflen) {
 }
 
 static pal_socket_mbuf *pal_socket_mbuf_create(const void *data, size_t len, size_t sent_len,
-    pal_socket_addr *to_addr, bool all, pal_socket_sent_cb sent_cb, void *arg) {
-    pal_socket_mbuf *mbuf = pal_mem_alloc(sizeof(*mbuf) + len);
+    pal_socket_addr *to_addr, bool all, bool copy, pal_socket_sent_cb sent_cb, void *arg) {
+    pal_socket_mbuf *mbuf = pal_mem_alloc(sizeof(*mbuf) + (copy ? len : 0));
     if (!mbuf) {
         return NULL;
     }
@@ -192,11 +208,16 @@ static pal_socket_mbuf *pal_socket_mbuf_create(const void *data, size_t len, siz
     } else {
         mbuf->to_addr.in.sin_family = AF_UNSPEC;
     }
-    memcpy(mbuf->buf, data, len);
+    if (copy) {
+        memcpy(mbuf->buf, data, len);
+        mbuf->pos = mbuf->buf;
+    } else {
+        mbuf->pos = data;
+    }
     mbuf->len = len;
-    mbuf->pos = mbuf->buf;
     mbuf->sent_len = sent_len;
     mbuf->all = all;
+    mbuf->done = false;
     mbuf->sent_cb = sent_cb;
     mbuf->arg = arg;
 
@@ -256,6 +277,7 @@ static void pal_socket_enable_write(pal_socket_obj_int *o, bool flag) {
 static void pal_socket_recv_reset(pal_socket_obj_int *o) {
     o->recv_buf = NULL;
     o->recv_buflen = 0;
+    o->recvmany = false;
     o->receiving = false;
     pal_socket_enable_read(o, false);
 }
@@ -399,6 +421,73 @@ pal_socket_recvfrom_async(pal_socket_obj_int *o, void *buf, size_t *len, pal_soc
     return pal_socket_raw_recvfrom(o, buf, len, addr);
 }
 
+static void
+pal_socket_msg_set_addr(pal_socket_obj_int *o, pal_socket_msg *msg, pal_socket_addr *addr) {
+    pal_socket_addr *_sa = pal_socket_connected(o) ? &o->remote_addr : addr;
+    msg->port = pal_socket_addr_get_port(_sa);
+    pal_socket_addr_get_str_addr(_sa, msg->addr, sizeof(msg->addr));
+}
+
+static pal_err
+pal_socket_raw_recvmany(pal_socket_obj_int *o, pal_socket_msg *msgs, size_t *count) {
+    if (o->bio_ctx) {
+        SOCKET_LOG(Error, o, "BIO not support 'recvmany'");
+        return PAL_ERR_UNKNOWN;
+    }
+
+    size_t n = *count < PAL_SOCKET_RECVMANY_MAX ? *count : PAL_SOCKET_RECVMANY_MAX;
+    pal_socket_addr sa[PAL_SOCKET_RECVMANY_MAX];
+#ifdef __linux__
+    struct mmsghdr hdrs[PAL_SOCKET_RECVMANY_MAX];
+    struct iovec iov[PAL_SOCKET_RECVMANY_MAX];
+    for (size_t i = 0; i < n; i++) {
+        iov[i].iov_base = msgs[i].buf;
+        iov[i].iov_len = msgs[i].len;
+        memset(&hdrs[i], 0, sizeof(hdrs[i]));
+        hdrs[i].msg_hdr.msg_name = &sa[i];
+        hdrs[i].msg_hdr.msg_namelen = sizeof(sa[i]);
+        hdrs[i].msg_hdr.msg_iov = &iov[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int rc;
+    do {
+        rc = recvmmsg(o->fd, hdrs, n, 0, NULL);
+    } while (rc == -1 && errno == EINTR);
+    if (rc == -1) {
+        *count = 0;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return PAL_ERR_AGAIN;
+        } else {
+            SOCKET_LOG_ERRNO(o, recvmmsg);
+            return PAL_ERR_UNKNOWN;
+        }
+    }
+    for (int i = 0; i < rc; i++) {
+        msgs[i].len = hdrs[i].msg_len;
+        pal_socket_msg_set_addr(o, &msgs[i], &sa[i]);
+    }
+    *count = rc;
+#else
+    size_t i;
+    for (i = 0; i < n; i++) {
+        size_t len = msgs[i].len;
+        pal_err err = pal_socket_raw_recvfrom(o, msgs[i].buf, &len, &sa[i]);
+        if (err != PAL_ERR_OK) {
+            if (i) {
+                break;
+            }
+            *count = 0;
+            return err;
+        }
+        msgs[i].len = len;
+        pal_socket_msg_set_addr(o, &msgs[i], &sa[i]);
+    }
+    *count = i;
+#endif
+    return PAL_ERR_OK;
+}
+
 static void pal_socket_handle_accept_cb(
         HAPPlatformFileHandleRef fileHandle,
         HAPPlatformFileHandleEvent fileHandleEvents,
@@ -529,6 +618,58 @@ static void pal_socket_handle_handshake_cb(
     cb((pal_socket_obj *)o, err, o->cb_arg);
 }
 
+/**
+ * Gather the queued stream mbufs into one writev(), and mark the mbufs
+ * completed by it as done.
+ */
+static pal_err pal_socket_mbuf_gather_send(pal_socket_obj_int *o) {
+    struct iovec iov[PAL_SOCKET_MBUF_GATHER_MAX];
+    int iovcnt = 0;
+    pal_socket_mbuf *cur;
+
+    for (cur = o->mbuf_list_head; cur && iovcnt < PAL_SOCKET_MBUF_GATHER_MAX; cur = cur->next) {
+        if (cur->done) {
+            continue;
+        }
+        iov[iovcnt].iov_base = (void *)cur->pos;
+        iov[iovcnt].iov_len = cur->len;
+        iovcnt++;
+    }
+
+    ssize_t rc;
+    do {
+        rc = writev(o->fd, iov, iovcnt);
+    } while (rc == -1 && errno == EINTR);
+    if (rc == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return PAL_ERR_AGAIN;
+        }
+        SOCKET_LOG_ERRNO(o, writev);
+        return PAL_ERR_UNKNOWN;
+    }
+
+    size_t left = rc;
+    for (cur = o->mbuf_list_head; cur && iovcnt; cur = cur->next) {
+        if (cur->done) {
+            continue;
+        }
+        iovcnt--;
+        size_t n = left < cur->len ? left : cur->len;
+        if (n == 0 && cur->len) {
+            break;
+        }
+        left -= n;
+        cur->sent_len += n;
+        if (n == cur->len || !cur->all) {
+            cur->done = true;
+        } else {
+            cur->pos += n;
+            cur->len -= n;
+        }
+    }
+    return PAL_ERR_OK;
+}
+
 static void pal_socket_handle_send_cb(
         HAPPlatformFileHandleRef fileHandle,
         HAPPlatformFileHandleEvent fileHandleEvents,
@@ -543,46 +684,76 @@ static void pal_socket_handle_send_cb(
         return;
     }
 
-    bool issendto = mbuf->to_addr.in.sin_family != AF_UNSPEC;
-    size_t sent_len = mbuf->len;
-    pal_err err = pal_socket_sendto_async(o, mbuf->pos, &sent_len,
-        issendto ? &mbuf->to_addr : NULL);
-    mbuf->sent_len += sent_len;
-    switch (err) {
-    case PAL_ERR_OK: {
-        char addr[64];
-        pal_socket_addr *_sa = issendto ? &mbuf->to_addr : &o->remote_addr;
-        if (sent_len == mbuf->len) {
-            SOCKET_LOG(Debug, o, "Sent message(len=%zu) to %s:%u", mbuf->sent_len,
-                pal_socket_addr_get_str_addr(_sa, addr, sizeof(addr)),
-                pal_socket_addr_get_port(_sa));
-        } else if (mbuf->all && sent_len) {
-            mbuf->pos += sent_len;
-            mbuf->len -= sent_len;
+    pal_err err = PAL_ERR_OK;
+    if (mbuf->done) {
+        // Already completed by the previous gathered write.
+    } else if (o->type == PAL_SOCKET_TYPE_TCP && !o->bio_ctx) {
+        err = pal_socket_mbuf_gather_send(o);
+        if (err == PAL_ERR_AGAIN) {
             return;
-        } else {
-            SOCKET_LOG(Debug, o, "Only sent %zu bytes message(len=%zu) to %s:%u",
-                mbuf->sent_len, mbuf->len + mbuf->sent_len,
-                pal_socket_addr_get_str_addr(_sa, addr, sizeof(addr)),
-                pal_socket_addr_get_port(_sa));
         }
-        break;
-    }
-    case PAL_ERR_AGAIN:
-        HAPFatalError();
-    default:
-        break;
+    } else {
+        bool issendto = mbuf->to_addr.in.sin_family != AF_UNSPEC;
+        size_t sent_len = mbuf->len;
+        err = pal_socket_sendto_async(o, mbuf->pos, &sent_len,
+            issendto ? &mbuf->to_addr : NULL);
+        mbuf->sent_len += sent_len;
+        switch (err) {
+        case PAL_ERR_OK:
+            if (sent_len != mbuf->len && mbuf->all && sent_len) {
+                mbuf->pos += sent_len;
+                mbuf->len -= sent_len;
+                return;
+            }
+            mbuf->done = true;
+            break;
+        case PAL_ERR_AGAIN:
+            HAPFatalError();
+        default:
+            break;
+        }
     }
 
-    pal_socket_mbuf_out(o);
+    // Detach the completed mbufs, on failure only the top one.
+    pal_socket_mbuf *done = NULL;
+    pal_socket_mbuf **pdone = &done;
+    while ((mbuf = pal_socket_mbuf_top(o)) && (mbuf->done || err != PAL_ERR_OK)) {
+        pal_socket_mbuf_out(o);
+        mbuf->next = NULL;
+        *pdone = mbuf;
+        pdone = &mbuf->next;
+        if (err != PAL_ERR_OK) {
+            break;
+        }
+    }
     if (!pal_socket_mbuf_top(o)) {
         pal_socket_enable_write(o, false);
     }
 
-    if (mbuf->sent_cb) {
-        mbuf->sent_cb((pal_socket_obj *)o, err, mbuf->sent_len, mbuf->arg);
+    // The socket may be deinitialized in sent_cb.
+    bool destroyed = false;
+    o->destroyed = &destroyed;
+    while (done) {
+        mbuf = done;
+        done = mbuf->next;
+        if (!destroyed) {
+            if (err == PAL_ERR_OK) {
+                char addr[64];
+                pal_socket_addr *_sa = mbuf->to_addr.in.sin_family != AF_UNSPEC ?
+                    &mbuf->to_addr : &o->remote_addr;
+                SOCKET_LOG(Debug, o, "Sent message(len=%zu) to %s:%u", mbuf->sent_len,
+                    pal_socket_addr_get_str_addr(_sa, addr, sizeof(addr)),
+                    pal_socket_addr_get_port(_sa));
+            }
+            if (mbuf->sent_cb) {
+                mbuf->sent_cb((pal_socket_obj *)o, err, mbuf->sent_len, mbuf->arg);
+            }
+        }
+        pal_mem_free(mbuf);
+    }
+    if (!destroyed) {
+        o->destroyed = NULL;
     }
-    pal_mem_free(mbuf);
 }
 
 static void pal_socket_handle_recv_cb(
@@ -604,6 +775,22 @@ static void pal_socket_handle_recv_cb(
         o->timer = 0;
     }
 
+    if (o->recvmany) {
+        size_t count = o->recv_buflen;
+        pal_err err = pal_socket_raw_recvmany(o, o->recv_buf, &count);
+        if (err == PAL_ERR_AGAIN) {
+            return;
+        }
+        SOCKET_LOG(Debug, o, "Received %zu messages", count);
+        pal_socket_recv_reset(o);
+
+        HAPAssert(o->cb);
+        pal_socket_recvedmany_cb cb = o->cb;
+        o->cb = NULL;
+        cb((pal_socket_obj *)o, err, count, o->cb_arg);
+        return;
+    }
+
     uint16_t port = 0;
     const char *addr = NULL;
     size_t len = o->recv_buflen;
@@ -759,6 +946,9 @@ void pal_socket_obj_deinit(pal_socket_obj *_o) {
     if (o->timer) {
         HAPPlatformTimerDeregister(o->timer);
     }
+    if (o->destroyed) {
+        *o->destroyed = true;
+    }
     pal_socket_mbuf *cur;
     while (o->mbuf_list_head) {
         cur = o->mbuf_list_head;
@@ -960,13 +1150,8 @@ pal_err pal_socket_connect(pal_socket_obj *_o, const char *addr, uint16_t port,
     return err;
 }
 
-pal_err pal_socket_send(pal_socket_obj *o, const void *data,
-    size_t *len, bool all, pal_socket_sent_cb sent_cb, void *arg) {
-    return pal_socket_sendto(o, data, len, NULL, 0, all, sent_cb, arg);
-}
-
-pal_err pal_socket_sendto(pal_socket_obj *_o, const void *data, size_t *len,
-    const char *addr, uint16_t port, bool all, pal_socket_sent_cb sent_cb, void *arg) {
+static pal_err pal_socket_sendto_int(pal_socket_obj *_o, const void *data, size_t *len,
+    const char *addr, uint16_t port, bool all, bool copy, pal_socket_sent_cb sent_cb, void *arg) {
     HAPPrecondition(_o);
     HAPPrecondition(sent_cb);
     HAPPrecondition(len);
@@ -1011,7 +1196,7 @@ pal_err pal_socket_sendto(pal_socket_obj *_o, const void *data, size_t *len,
     }
     switch (err) {
     case PAL_ERR_AGAIN: {
-        pal_socket_mbuf *mbuf = pal_socket_mbuf_create(data, *len, sent_len, psa, all, sent_cb, arg);
+        pal_socket_mbuf *mbuf = pal_socket_mbuf_create(data, *len, sent_len, psa, all, copy, sent_cb, arg);
         if (!mbuf) {
             return PAL_ERR_ALLOC;
         }
@@ -1026,7 +1211,7 @@ pal_err pal_socket_sendto(pal_socket_obj *_o, const void *data, size_t *len,
             SOCKET_LOG(Debug, o, "Sent message(len=%zu) to %s:%u", *len, addr, port);
         } else if (all && sent_len) {
             pal_socket_mbuf *mbuf = pal_socket_mbuf_create(data + sent_len, *len - sent_len,
-                sent_len, psa, all, sent_cb, arg);
+                sent_len, psa, all, copy, sent_cb, arg);
             if (!mbuf) {
                 return PAL_ERR_ALLOC;
             }
@@ -1048,16 +1233,41 @@ pal_err pal_socket_sendto(pal_socket_obj *_o, const void *data, size_t *len,
     return err;
 }
 
+pal_err pal_socket_send(pal_socket_obj *o, const void *data,
+    size_t *len, bool all, pal_socket_sent_cb sent_cb, void *arg) {
+    return pal_socket_sendto_int(o, data, len, NULL, 0, all, true, sent_cb, arg);
+}
+
+pal_err pal_socket_sendto(pal_socket_obj *o, const void *data, size_t *len,
+    const char *addr, uint16_t port, bool all, pal_socket_sent_cb sent_cb, void *arg) {
+    return pal_socket_sendto_int(o, data, len, addr, port, all, true, sent_cb, arg);
+}
+
+pal_err pal_socket_send_nocopy(pal_socket_obj *o, const void *data,
+    size_t *len, bool all, pal_socket_sent_cb sent_cb, void *arg) {
+    return pal_socket_sendto_int(o, data, len, NULL, 0, all, false, sent_cb, arg);
+}
+
+pal_err pal_socket_sendto_nocopy(pal_socket_obj *o, const void *data, size_t *len,
+    const char *addr, uint16_t port, bool all, pal_socket_sent_cb sent_cb, void *arg) {
+    return pal_socket_sendto_int(o, data, len, addr, port, all, false, sent_cb, arg);
+}
+
 static void pal_socket_recv_timeout_cb(HAPPlatformTimerRef timer, void *context) {
     pal_socket_obj_int *o = context;
 
     o->timer = 0;
+    bool recvmany = o->recvmany;
     pal_socket_recv_reset(o);
 
     HAPAssert(o->cb);
-    pal_socket_recved_cb cb = o->cb;
+    void *cb = o->cb;
     o->cb = NULL;
-    cb((pal_socket_obj *)o, PAL_ERR_TIMEOUT, NULL, 0, 0, o->cb_arg);
+    if (recvmany) {
+        ((pal_socket_recvedmany_cb)cb)((pal_socket_obj *)o, PAL_ERR_TIMEOUT, 0, o->cb_arg);
+    } else {
+        ((pal_socket_recved_cb)cb)((pal_socket_obj *)o, PAL_ERR_TIMEOUT, NULL, 0, 0, o->cb_arg);
+    }
 }
 
 pal_err pal_socket_recv(pal_socket_obj *o, void *buf, size_t *len,
@@ -1130,6 +1340,58 @@ pal_err pal_socket_recvfrom(pal_socket_obj *_o, void *buf, size_t *len, char *ad
     return err;
 }
 
+pal_err pal_socket_recvmany(pal_socket_obj *_o, pal_socket_msg *msgs, size_t *count,
+    pal_socket_recvedmany_cb recvedmany_cb, void *arg) {
+    HAPPrecondition(_o);
+    HAPPrecondition(msgs);
+    HAPPrecondition(count);
+    HAPPrecondition(*count > 0);
+    HAPPrecondition(recvedmany_cb);
+
+    pal_socket_obj_int *o = (pal_socket_obj_int *)_o;
+    HAPAssert(o->magic == PAL_SOCKET_OBJ_MAGIC);
+
+    SOCKET_LOG(Debug, o, "%s(count = %zu)", __func__, *count);
+
+    if (o->type != PAL_SOCKET_TYPE_UDP) {
+        return PAL_ERR_INVALID_STATE;
+    }
+
+    if (o->receiving) {
+        return PAL_ERR_BUSY;
+    }
+
+    size_t n = *count;
+    pal_err err = pal_socket_raw_recvmany(o, msgs, &n);
+    switch (err) {
+    case PAL_ERR_AGAIN:
+        if (o->timeout != 0 && HAPPlatformTimerRegister(&o->timer,
+            HAPPlatformClockGetCurrent() + o->timeout,
+            pal_socket_recv_timeout_cb, o) != kHAPError_None) {
+            SOCKET_LOG(Error, o, "Failed to create timeout timer.");
+            return PAL_ERR_UNKNOWN;
+        }
+        err = PAL_ERR_IN_PROGRESS;
+        o->recv_buf = msgs;
+        o->recv_buflen = *count;
+        o->recvmany = true;
+        o->cb = recvedmany_cb;
+        o->cb_arg = arg;
+        o->receiving = true;
+        pal_socket_enable_read(o, true);
+        SOCKET_LOG(Debug, o, "Receiving ...");
+        break;
+    case PAL_ERR_OK:
+        *count = n;
+        SOCKET_LOG(Debug, o, "Received %zu messages", n);
+        break;
+    default:
+        break;
+    }
+
+    return err;
+}
+
 bool pal_socket_readable(pal_socket_obj *_o) {
     HAPPrecondition(_o);
 
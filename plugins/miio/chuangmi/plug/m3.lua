@@ -5,8 +5,8 @@ local M = {}
 ---@param conf MiioAccessoryConf Device configuration.
 ---@return HAPAccessory accessory HomeKit Accessory.
 function M.gen(device, conf)
-    function device:getOn()
-        return self:getProp("power") == "on"
+    function device.toOn(power)
+        return power == "on"
     end
 
     function device:setOn(value)
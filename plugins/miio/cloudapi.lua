@@ -72,7 +72,7 @@ local function genSignatureARC4(method, path, signed_nonce, query)
     end
     tinsert(strs, base64.encode(signed_nonce))
     local s = tconcat(strs, "&")
-    return base64.encode(hash.create("SHA1"):update(s):digest())
+    return base64.encode(hash.digest("SHA1", s))
 end
 
 local function genSignature(path, nonce, signNonce, query)
@@ -82,7 +82,7 @@ local function genSignature(path, nonce, signNonce, query)
         tinsert(strs, ("%s=%s"):format(key, query[key]))
     end
     local s = tconcat(strs, "&")
-    return base64.encode(hash.create("SHA256", signNonce):update(s):digest())
+    return base64.encode(hash.digest("SHA256", s, signNonce))
 end
 
 local function genNonce()
@@ -90,7 +90,7 @@ local function genNonce()
 end
 
 local function signNonce(ssecurity, nonce)
-    return hash.create("SHA256"):update(ssecurity .. nonce):digest()
+    return hash.digest("SHA256", ssecurity .. nonce)
 end
 
 ---Login step 1.
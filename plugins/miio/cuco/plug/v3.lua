@@ -10,10 +10,6 @@ function M.gen(device, conf)
         power = {siid = 2, piid = 1}
     })
 
-    function device:getOn()
-        return self:getProp("power")
-    end
-
     function device:setOn(value)
         self:setProp("power", value)
     end
@@ -1,11 +1,28 @@
 local protocol = require "miio.protocol"
 local util = require "util"
 local xpcall = xpcall
+local pcall = pcall
 local traceback = debug.traceback
 local assert = assert
 local type = type
 local tunpack = table.unpack
 local tinsert = table.insert
+local pairs = pairs
+local ipairs = ipairs
+local min = math.min
+local max = math.max
+
+---Polling interval in milliseconds after a write or a user interaction.
+local pollFastInterval = 2000
+
+---Max polling interval in milliseconds, the interval doubles from
+---``pollFastInterval`` up to it while the properties are not changed.
+local pollSlowInterval = 60000
+
+---Polling interval in milliseconds of the first retry of a unreachable device,
+---it doubles on each failure up to ``pollRetryMaxInterval``.
+local pollRetryInterval = 5000
+local pollRetryMaxInterval = 300000
 
 local M = {}
 
@@ -39,85 +56,345 @@ local M = {}
 ---@class MiioDevice Device object.
 local device = {}
 
----Get properties.
----@param obj MiioDevice
-local function getProps(obj)
-    local names = obj.names
-    obj.names = {}
-    local success, result = xpcall(obj.request, traceback, obj, "get_prop", tunpack(names))
+---Set MIOT property mapping.
+---@param mapping table<string, MiotIID> Property name -> MIOT instance ID mapping.
+function device:setMapping(mapping)
+    self.mapping = mapping
+end
+
+---Get properties in one request.
+---@param names string[] Property names.
+---@return table<string, string|number|boolean> props Property name -> value.
+---@nodiscard
+function device:getProps(names)
+    local props = {}
+    if #names == 0 then
+        return props
+    end
+
+    local mapping = self.mapping
+    if mapping then
+        local params = {}
+        for i, name in ipairs(names) do
+            params[i] = {
+                did = name,
+                siid = mapping[name].siid,
+                piid = mapping[name].piid,
+            }
+        end
+        for _, prop in ipairs(self:request("get_properties", tunpack(params))) do
+            props[prop.did] = prop.value
+        end
+    else
+        for i, value in ipairs(self:request("get_prop", tunpack(names))) do
+            props[names[i]] = value
+        end
+    end
+    return props
+end
+
+---Convert the property values to the value of a bound characteristic.
+---@param binding MiioCharBinding
+---@param props table<string, string|number|boolean> Property name -> value.
+---@return any value Characteristic value.
+local function convert(binding, props)
+    local names = binding.names
+    local values = {}
+    for i, name in ipairs(names) do
+        values[i] = props[name]
+    end
+    return binding.conv(tunpack(values, 1, #names))
+end
+
+---Poll all properties read so far in one request.
+---@param self MiioDevice
+---@return boolean success
+---@return boolean changed Whether the properties are changed.
+local function poll(self)
+    local names = {}
+    for name, _ in pairs(self.names) do
+        tinsert(names, name)
+    end
+
+    local unreachable = self.snapshot == false
+    local success, result = xpcall(self.getProps, traceback, self, names)
     if success == false then
-        obj.mq:send(success, result)
+        self.logger:error(result)
+        self.snapshot = false
+        return false, false
+    end
+
+    -- Compare with the values served last, they may be updated while polling.
+    local snapshot = self.snapshot
+    local changed = unreachable or not snapshot
+    if not changed then
+        for name, value in pairs(result) do
+            if snapshot[name] ~= value then
+                changed = true
+                break
+            end
+        end
+    end
+    self.snapshot = result
+    return true, changed
+end
+
+---Push the value of a bound characteristic, or withdraw it if the properties are not polled.
+---@param binding MiioCharBinding
+---@param snapshot table<string, string|number|boolean>|false
+local function publishOne(binding, snapshot)
+    if not snapshot then
+        binding.char:setValue(nil)
         return
     end
-    local props = {}
-    for i, value in ipairs(result) do
-        props[names[i]] = value
+    for _, name in ipairs(binding.names) do
+        if snapshot[name] == nil then
+            binding.char:setValue(nil)
+            return
+        end
     end
-    obj.mq:send(success, props)
+    binding.char:setValue(convert(binding, snapshot))
 end
 
----Get properties(MIOT).
----@param obj MiioDevice
-local function getPropsMiot(obj)
-    local mapping = obj.mapping
-    assert(mapping ~= nil, "missing mapping")
-    local params = {}
-    for _, name in ipairs(obj.names) do
-        tinsert(params, {
-            did = name,
-            siid = mapping[name].siid,
-            piid = mapping[name].piid,
-        })
+---Push the polled values to the bound characteristics.
+---
+---The reads of a pushed value are served in C without calling the read callback,
+---and ``characteristic:setValue()`` raises the event if the value is changed.
+---The values are withdrawn while the device is unreachable, so that the reads
+---fail in the read callback.
+---@param self MiioDevice
+local function publish(self)
+    local snapshot = self.snapshot
+    for _, binding in pairs(self.bindings) do
+        local success, err = pcall(publishOne, binding, snapshot)
+        if success == false then
+            self.logger:error(err)
+            binding.char:setValue(nil)
+        end
     end
-    obj.names = {}
-    local success, result = xpcall(obj.request, traceback, obj, "get_properties", tunpack(params))
-    if success == false then
-        obj.mq:send(success, result)
+end
+
+---Poll the device until it is closed.
+---
+---The interval is reset to ``pollFastInterval`` when the properties are changed,
+---and doubles while they are not. A unreachable device is retried with an
+---exponential backoff, the reads fail at once within ``pollFastInterval``
+---after a failed poll.
+---@param self MiioDevice
+local function pollLoop(self)
+    local wakeup = self.wakeup
+    while not self.closed do
+        local timeout = self.nextPoll - core.time()
+        if timeout > 0 then
+            -- Woken up when the next poll is brought forward or the device is closed.
+            wakeup:recv(timeout)
+        else
+            local success, changed = poll(self)
+            local interval
+            if success then
+                self.failures = 0
+                -- The properties read since the last poll are pushed even if nothing is changed.
+                publish(self)
+                if changed then
+                    interval = pollFastInterval
+                else
+                    interval = min(self.interval * 2, pollSlowInterval)
+                end
+            else
+                self.failures = self.failures + 1
+                if self.failures == 1 then
+                    interval = pollRetryInterval
+                    publish(self)
+                else
+                    interval = min(self.interval * 2, pollRetryMaxInterval)
+                end
+            end
+            self.interval = interval
+            self.lastPoll = core.time()
+            self.nextPoll = self.lastPoll + interval
+        end
+    end
+end
+
+---Start polling if not started.
+---@param self MiioDevice
+local function startPoller(self)
+    if self.wakeup or self.closed then
         return
     end
-    local props = {}
-    for _, prop in ipairs(result) do
-        props[prop.did] = prop.value
+    self.wakeup = core.createMQ(1)
+    self.interval = pollFastInterval
+    self.nextPoll = core.time() + pollFastInterval
+    core.createTimer(pollLoop, self):start(0)
+end
+
+---Clear the unreachable state after a successful request,
+---and poll at once to refresh the properties.
+---@param self MiioDevice
+local function reachable(self)
+    if self.failures == 0 then
+        return
+    end
+    self.failures = 0
+    if self.snapshot == false then
+        self.snapshot = {}
+    end
+    if self.wakeup then
+        self.interval = pollFastInterval
+        self.nextPoll = core.time()
+        self.wakeup:trySend()
     end
-    obj.mq:send(success, props)
 end
 
----Set MIOT property mapping.
----@param mapping table<string, MiotIID> Property name -> MIOT instance ID mapping.
-function device:setMapping(mapping)
-    self.mapping = mapping
-    self.timer = core.createTimer(getPropsMiot, self)
+---Poll faster after a user interaction.
+---@param self MiioDevice
+---@param delay integer Poll in ``delay`` milliseconds at the latest.
+local function interact(self, delay)
+    -- Keep the retry schedule of a unreachable device.
+    if not self.wakeup or self.failures > 0 then
+        return
+    end
+    self.interval = pollFastInterval
+    local nextPoll = core.time() + delay
+    if nextPoll < self.nextPoll then
+        self.nextPoll = nextPoll
+        self.wakeup:trySend()
+    end
+end
+
+---Whether the reads fail at once, the device is unreachable
+---and the last poll failed within ``pollFastInterval``.
+---@param self MiioDevice
+---@return boolean
+local function failFast(self)
+    return self.snapshot == false and core.time() - self.lastPoll < pollFastInterval
+end
+
+local function identity(value)
+    return value
+end
+
+---Create a characteristic bound to properties.
+---
+---The first read of the characteristic is sent to the device, the reads in
+---a transaction are served by ``device.readBatch``. The properties are then
+---polled in the background and the values are pushed to the characteristic.
+---@param Char table Characteristic module, ``Char.new(iid, read, write)`` creates the characteristic.
+---@param iid integer Characteristic instance ID.
+---@param names string|string[] Property names.
+---@param conv? fun(...): any Convert the property values to the characteristic value, the first value is used if it is ``nil``.
+---@param write? async fun(request: HAPCharacteristicWriteRequest, value: any) Write callback.
+---@return HAPCharacteristic char
+function device:bind(Char, iid, names, conv, write)
+    if type(names) == "string" then
+        names = { names }
+    end
+
+    ---@class MiioCharBinding:table Characteristic bound to properties.
+    local binding = {
+        names = names,
+        conv = conv or identity,
+    }
+    binding.char = Char.new(iid, function (request)
+        local props = {}
+        for _, name in ipairs(names) do
+            props[name] = self:getProp(name)
+        end
+        return convert(binding, props)
+    end, write)
+    self.bindings[iid] = binding
+    return binding.char
+end
+
+---Read the bound characteristics of a transaction.
+---
+---The properties not polled yet are fetched in one request, the values are
+---returned in the order of the requests.
+---@param self MiioDevice
+---@param requests HAPCharacteristicReadRequest[]
+---@return any[]|nil values The values of the unbound characteristics are ``nil``.
+local function readBatch(self, requests)
+    local bindings = self.bindings
+    local snapshot = self.snapshot or {}
+    local names = {}
+    local seen = {}
+    local found = false
+    for _, request in ipairs(requests) do
+        local binding = bindings[request.cid]
+        if binding then
+            found = true
+            for _, name in ipairs(binding.names) do
+                if snapshot[name] == nil and not seen[name] then
+                    seen[name] = true
+                    tinsert(names, name)
+                end
+            end
+        end
+    end
+    if not found then
+        return nil
+    end
+    if failFast(self) then
+        error("failed to get properties")
+    end
+
+    if #names > 0 then
+        local props = self:getProps(names)
+        snapshot = self.snapshot
+        if snapshot == false then
+            snapshot = {}
+            self.snapshot = snapshot
+        end
+        for _, name in ipairs(names) do
+            self.names[name] = true
+            snapshot[name] = props[name]
+        end
+        startPoller(self)
+    end
+    interact(self, max(0, self.lastPoll + pollFastInterval - core.time()))
+
+    local values = {}
+    for i, request in ipairs(requests) do
+        local binding = bindings[request.cid]
+        if binding then
+            values[i] = convert(binding, snapshot)
+        end
+    end
+    return values
 end
 
 ---Get property.
+---
+---The properties are served from the result of the background polling,
+---only the first read of a property is sent to the device.
 ---@param name string Property name.
 ---@return string|number|boolean value Property value.
 ---@nodiscard
 function device:getProp(name)
     assert(type(name) == "string")
 
-    local names = self.names
-    if #names == 0 then
-        self.timer:start(0)
-    else
-        for _, _name in ipairs(names) do
-            if name == _name then
-                goto recv
-            end
-        end
+    if failFast(self) then
+        error("failed to get property")
+    end
+    local snapshot = self.snapshot
+    local value = snapshot and snapshot[name]
+    if value ~= nil then
+        return value
     end
-    tinsert(names, name)
 
-::recv::
-    local success, result = self.mq:recv()
+    self.names[name] = true
+    local success, result = xpcall(self.getProps, traceback, self, { name })
     if success == false then
         self.logger:error(result)
         error("failed to get property")
     end
-    if result[name] == nil then
-        goto recv
+    value = result[name]
+    snapshot = self.snapshot
+    if snapshot then
+        snapshot[name] = value
     end
-    return result[name]
+    startPoller(self)
+    return value
 end
 
 ---Set property.
@@ -136,6 +413,13 @@ function device:setProp(name, value)
     else
         assert(self:request("set_" .. name, value)[1] == "ok")
     end
+    if self.snapshot then
+        self.snapshot[name] = value
+        -- Update the characteristics depending on the property at once.
+        publish(self)
+    end
+    -- Give the device time to apply the value before the next poll.
+    interact(self, pollFastInterval)
 end
 
 ---Get device information.
@@ -145,12 +429,54 @@ function device:getInfo()
     return self:request("miIO.info")
 end
 
+---Update the address and token of the device.
+---
+---The requests in flight on the old connection fail with "closed".
+---@param addr string Device address.
+---@param token string Device token.
+function device:update(addr, token)
+    assert(type(addr) == "string")
+    assert(type(token) == "string")
+    assert(#token == 32)
+
+    if addr == self.addr and token == self.token then
+        return
+    end
+    self.logger:info(("Updated the address to %s."):format(addr))
+    self.logger = log.getLogger("miio.device:" .. addr)
+    self.pcb:close()
+    self.pcb = protocol.create(addr, util.hex2bin(token))
+    self.addr = addr
+    self.token = token
+    -- Poll the new address at once, even if the old one is unreachable.
+    self.failures = 0
+    interact(self, 0)
+end
+
 ---Start a request.
 ---@param method string The request method.
 ---@param ... any The request parameters.
 ---@return any result
 function device:request(method, ...)
-    return self.pcb:request(self.timeout, method, ...)
+    local pcb = self.pcb
+    local success, result = pcall(pcb.request, pcb, self.timeout, method, ...)
+    if success == false then
+        error(result, 0)
+    end
+    reachable(self)
+    return result
+end
+
+---Close the device, the background polling is stopped.
+function device:close()
+    if self.closed then
+        return
+    end
+    self.closed = true
+    self.pcb:close()
+    if self.wakeup then
+        self.wakeup:trySend()
+    end
 end
 
 ---Create a device object.
@@ -169,12 +495,25 @@ function M.create(addr, token)
         pcb = protocol.create(addr, util.hex2bin(token)),
         mapping = false,
         addr = addr,
+        token = token,
         timeout = 1000,
-        mq = core.createMQ(1),
-        names = {}, ---@type string[]
+        names = {}, ---@type table<string, boolean>
+        snapshot = {}, ---@type table<string, string|number|boolean>|false
+        wakeup = false, ---@type MessageQueue|false
+        interval = pollFastInterval,
+        failures = 0,
+        lastPoll = 0,
+        nextPoll = 0,
+        bindings = {}, ---@type table<integer, MiioCharBinding>
+        closed = false,
     }
 
-    o.timer = core.createTimer(getProps, o)
+    ---The batch read callback of the accessory, see ``readBatch()``.
+    ---@param requests HAPCharacteristicReadRequest[]
+    ---@return any[]|nil values
+    function o.readBatch(requests)
+        return readBatch(o, requests)
+    end
 
     setmetatable(o, {
         __index = device
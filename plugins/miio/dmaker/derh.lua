@@ -29,38 +29,33 @@ function M.gen(device, conf)
         {
             hap.AccessoryInformationService,
             hap.newService(iids.derh, "HumidifierDehumidifier", true, false, {
-                Active.new(iids.active, function (request)
-                    return device:getProp("power") and Active.value.Active or Active.value.Inactive
+                device:bind(Active, iids.active, "power", function (power)
+                    return power and Active.value.Active or Active.value.Inactive
                 end, function (request, value)
                     device:setProp("power", value == Active.value.Active)
                     raiseEvent(request.aid, request.sid, request.cid)
                     raiseEvent(request.aid, request.sid, iids.curState)
                 end),
-                CurState.new(iids.curState, function (request)
-                    return device:getProp("power") and CurState.value.Dehumidifying or CurState.value.Inactive
+                device:bind(CurState, iids.curState, "power", function (power)
+                    return power and CurState.value.Dehumidifying or CurState.value.Inactive
                 end):setValidVals(CurState.value.Inactive, CurState.value.Dehumidifying),
                 TgtState.new(iids.tgtState, function (request)
                     return TgtState.value.Dehumidifier
                 end, nil):setValidVals(TgtState.value.Dehumidifier),
-                CurHumidity.new(iids.curHumidity, function (request)
-                    return device:getProp("curHumidity")
-                end),
-                TgtHumidity.new(iids.tgtHumidity, function (request)
-                    return device:getProp("tgtHumidity")
-                end, function (request, value)
+                device:bind(CurHumidity, iids.curHumidity, "curHumidity"),
+                device:bind(TgtHumidity, iids.tgtHumidity, "tgtHumidity", nil, function (request, value)
                     device:setProp("tgtHumidity", assert(tointeger(value), "value not a integer"))
                     raiseEvent(request.aid, request.sid, request.cid)
                 end):setContraints(30, 70, 1)
             }),
             hap.newService(iids.temp, "TemperatureSensor", false, false, {
-                CurTemp.new(iids.curTemp, function (request)
-                    return device:getProp("curTemp")
-                end):setContraints(-30, 100, 0.1)
+                device:bind(CurTemp, iids.curTemp, "curTemp"):setContraints(-30, 100, 0.1)
             })
         },
         function (request)
             device.logger:info("Identify callback is called.")
-        end
+        end,
+        device.readBatch
     )
 end
 
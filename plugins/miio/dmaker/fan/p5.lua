@@ -26,20 +26,18 @@ function M.gen(device, conf)
         {
             hap.AccessoryInformationService,
             hap.newService(iids.fan, "Fan", true, false, {
-                Active.new(iids.active, function (request)
-                    return device:getProp("power") and Active.value.Active or Active.value.Inactive
+                device:bind(Active, iids.active, "power", function (power)
+                    return power and Active.value.Active or Active.value.Inactive
                 end, function (request, value)
                     device:request("s_power", value == Active.value.Active)
                     raiseEvent(request.aid, request.sid, request.cid)
                 end),
-                RotationSpeed.new(iids.rotationSpeed, function (request)
-                    return device:getProp("speed")
-                end, function (request, value)
+                device:bind(RotationSpeed, iids.rotationSpeed, "speed", nil, function (request, value)
                     device:request("s_speed", tointeger(value))
                     raiseEvent(request.aid, request.sid, request.cid)
                 end):setContraints(1, 100, 1),
-                SwingMode.new(iids.swingMode, function (request)
-                    return device:getProp("roll_enable") and SwingMode.value.Enabled or SwingMode.value.Disabled
+                device:bind(SwingMode, iids.swingMode, "roll_enable", function (roll_enable)
+                    return roll_enable and SwingMode.value.Enabled or SwingMode.value.Disabled
                 end, function (request, value)
                     device:request("s_roll", value == SwingMode.value.Enabled)
                     raiseEvent(request.aid, request.sid, request.cid)
@@ -48,7 +46,8 @@ function M.gen(device, conf)
         },
         function (request)
             device.logger:info("Identify callback is called.")
-        end
+        end,
+        device.readBatch
     )
 end
 
@@ -48,8 +48,8 @@ function M.gen(device, conf)
         {
             hap.AccessoryInformationService,
             hap.newService(iids.heaterCooler, "HeaterCooler", true, false, {
-                Active.new(iids.active, function (request)
-                    return valMapping.power[device:getProp("power")]
+                device:bind(Active, iids.active, "power", function (power)
+                    return valMapping.power[power]
                 end, function (request, value)
                     device:setProp("power", searchKey(valMapping.power, value))
                     raiseEvent(request.aid, request.sid, request.cid)
@@ -62,11 +62,8 @@ function M.gen(device, conf)
                         raiseEvent(request.aid, iids.heaterCooler, iids.swingMode)
                     end):start(500)
                 end),
-                CurTemp.new(iids.curTemp, function (request)
-                    return device:getProp("tar_temp")
-                end),
-                CurHeatCoolState.new(iids.curState, function (request)
-                    local mode = device:getProp("mode")
+                device:bind(CurTemp, iids.curTemp, "tar_temp"),
+                device:bind(CurHeatCoolState, iids.curState, "mode", function (mode)
                     local value
                     if mode == "cool" then
                         value = CurHeatCoolState.value.Cooling
@@ -77,8 +74,7 @@ function M.gen(device, conf)
                     end
                     return value
                 end),
-                TgtHeatCoolState.new(iids.tgtState, function (request)
-                    local mode = device:getProp("mode")
+                device:bind(TgtHeatCoolState, iids.tgtState, "mode", function (mode)
                     local value
                     if mode == "unsupport" or mode == "dry" or mode == "wind" then
                         value = TgtHeatCoolState.value.HeatOrCool
@@ -95,20 +91,15 @@ function M.gen(device, conf)
                         raiseEvent(request.aid, iids.heaterCooler, iids.heatThrTemp)
                     end):start(500)
                 end),
-                CoolThrholdTemp.new(iids.coolThrTemp, function (request)
-                    return device:getProp("tar_temp")
-                end, function (request, value)
+                device:bind(CoolThrholdTemp, iids.coolThrTemp, "tar_temp", nil, function (request, value)
                     device:setProp("tar_temp", assert(tointeger(value), "value not a integer"))
                     raiseEvent(request.aid, request.sid, request.cid)
                 end):setContraints(16, 30, 1),
-                HeatThrholdTemp.new(iids.heatThrTemp, function (request)
-                    return device:getProp("tar_temp")
-                end, function (request, value)
+                device:bind(HeatThrholdTemp, iids.heatThrTemp, "tar_temp", nil, function (request, value)
                     device:setProp("tar_temp", assert(tointeger(value), "value not a integer"))
                     raiseEvent(request.aid, request.sid, request.cid)
                 end):setContraints(16, 30, 1),
-                SwingMode.new(iids.swingMode, function (request)
-                    local ver_swing = device:getProp("ver_swing")
+                device:bind(SwingMode, iids.swingMode, "ver_swing", function (ver_swing)
                     local value
                     if ver_swing == "unsupport" then
                         value = SwingMode.value.Disabled
@@ -124,7 +115,8 @@ function M.gen(device, conf)
         },
         function (request)
             device.logger:info("Identify callback is called.")
-        end
+        end,
+        device.readBatch
     )
 end
 
@@ -6,7 +6,7 @@ local M = {}
 
 ---@class PlugDevice:MiioDevice
 ---
----@field getOn fun(self: MiioDevice): boolean
+---@field toOn? fun(power: any): boolean Convert the power property to the value of On, the property is used if it is ``nil``.
 ---@field setOn fun(self: MiioDevice, value: boolean)
 
 ---Create a plug.
@@ -28,9 +28,7 @@ function M.gen(device, conf)
         {
             hap.AccessoryInformationService,
             hap.newService(iids.outlet, "Outlet", true, false, {
-                On.new(iids.on, function (request)
-                    return device:getOn()
-                end, function (request, value)
+                device:bind(On, iids.on, "power", device.toOn, function (request, value)
                     device:setOn(value)
                     raiseEvent(request.aid, request.sid, request.cid)
                 end)
@@ -38,7 +36,8 @@ function M.gen(device, conf)
         },
         function (request)
             device.logger:info("Identify callback is called.")
-        end
+        end,
+        device.readBatch
     )
 end
 
@@ -1,10 +1,12 @@
 local config = require "config"
 local hapUtil = require "hap.util"
+local util = require "util"
 local nvs = require "nvs"
+local hash = require "hash"
 local device = require "miio.device"
 local cloudapi = require "miio.cloudapi"
-local traceback = debug.traceback
 local tinsert = table.insert
+local traceback = debug.traceback
 
 local M = {}
 local logger = log.getLogger("miio.plugin")
@@ -22,60 +24,215 @@ local logger = log.getLogger("miio.plugin")
 ---@field fw_ver string Firmware version.
 ---@field hw_ver string Hardware version.
 
----Generate accessory via configuration.
----@param conf MiioAccessoryConf Accessory configuration.
+---Cached device entry, ``sn`` is the key of the inventory.
+---@class MiioInventoryEntry
+---
+---@field sn string Accessory serial number.
+---@field addr string Device address.
+---@field token string Device token.
+---@field name string Device name.
+---@field model string Device model.
+---@field fw_ver string Firmware version.
+---@field hw_ver string Hardware version.
+
+---NVS namespace of the device inventory.
+local nvsNamespace = "miio"
+
+---Created devices, sn -> device object.
+---@type table<string, MiioDevice>
+local devices = {}
+
+---Generate accessory via the cached device entry.
+---@param entry MiioInventoryEntry
 ---@return HAPAccessory accessory
-local function gen(conf)
-    return require("miio." .. conf.model).gen(device.create(conf.addr, conf.token), conf)
+local function gen(entry)
+    local handle <close> = nvs.open(entry.sn)
+    ---@type MiioAccessoryConf
+    local conf = {
+        aid = hapUtil.getBridgedAccessoryIID(handle),
+        iids = hapUtil.getInstanceIDs(handle),
+        addr = entry.addr,
+        token = entry.token,
+        name = entry.name,
+        model = entry.model,
+        sn = entry.sn,
+        fw_ver = entry.fw_ver,
+        hw_ver = entry.hw_ver,
+    }
+    local obj = device.create(conf.addr, conf.token)
+    local accessory = require("miio." .. conf.model).gen(obj, conf)
+    devices[conf.sn] = obj
+    return accessory
 end
 
----Initialize plugin.
----@return HAPAccessory[] bridgedAccessories Bridges Accessories.
-function M.init()
-    logger:info("Initialing ...")
+---Get the fingerprint of the account, the cached inventory
+---is only valid for the account and Wi-Fi it was fetched with.
+---@param region string
+---@param username string
+---@param ssid string
+---@return string fingerprint
+---@nodiscard
+local function fingerprint(region, username, ssid)
+    return util.bin2hex(hash.digest("MD5", ("%s\0%s\0%s"):format(region, username, ssid)))
+end
 
-    local confs = {}
+---Get the devices connected to the Wi-Fi from the cloud.
+---@param region string
+---@param username string
+---@param password string
+---@param ssid string
+---@return MiioInventoryEntry[] inventory
+---@nodiscard
+local function fetchInventory(region, username, password, ssid)
+    local start = core.time()
+    local list
     do
-        local devices
-        do
-            local region = assert(config.get("miio.region"), "config 'miio.region' not exist")
-            local username = assert(config.get("miio.username"), "config 'miio.username' not exist")
-            local password = assert(config.get("miio.password"), "missing 'miio.password' not exist")
-            local session <close> = cloudapi.session(region, username, password)
-            devices = session:getDevices("wifi")
+        local session <close> = cloudapi.session(region, username, password)
+        list = session:getDevices("wifi")
+    end
+    logger:info(("Got %d devices from the cloud in %d ms."):format(#list, core.time() - start))
+
+    local inventory = {}
+    for _, device in ipairs(list) do
+        if device.ssid == ssid then
+            tinsert(inventory, {
+                sn = device.mac:gsub(":", ""),
+                addr = device.localip,
+                token = device.token,
+                name = device.name,
+                model = device.model,
+                fw_ver = device.extra.fw_version,
+                hw_ver = device.extra.mcu_version or "0",
+            })
         end
-        collectgarbage()
-        local ssid = assert(config.get("miio.ssid"), "config 'miio.ssid' not exist")
-        for _, device in ipairs(devices) do
-            if device.ssid == ssid then
-                local sn = device.mac:gsub(":", "")
-                local handle = nvs.open(sn)
-                tinsert(confs, {
-                    aid = hapUtil.getBridgedAccessoryIID(handle),
-                    iids = hapUtil.getInstanceIDs(handle),
-                    addr = device.localip,
-                    token = device.token,
-                    name = device.name,
-                    model = device.model,
-                    sn = sn,
-                    fw_ver = device.extra.fw_version,
-                    hw_ver = device.extra.mcu_version or "0",
-                })
+    end
+    return inventory
+end
+
+---Load the cached inventory.
+---@param fp string Fingerprint of the account.
+---@return MiioInventoryEntry[]|nil inventory ``nil`` if not cached or the fingerprint not match.
+---@nodiscard
+local function loadInventory(fp)
+    local handle <close> = nvs.open(nvsNamespace)
+    if handle:get("fingerprint") ~= fp then
+        return nil
+    end
+    return handle:get("inventory")
+end
+
+---Save the inventory to the cache.
+---@param fp string Fingerprint of the account.
+---@param inventory MiioInventoryEntry[]
+local function saveInventory(fp, inventory)
+    local handle <close> = nvs.open(nvsNamespace)
+    handle:set("inventory", inventory)
+    handle:set("fingerprint", fp)
+    handle:commit()
+end
+
+---Refresh the inventory from the cloud and apply the changes.
+---
+---The address and token of the created devices are updated in place,
+---the other changes take effect after restart because the bridged
+---accessories cannot be changed after HAP is started.
+---@param fp string Fingerprint of the account.
+---@param cached MiioInventoryEntry[] The inventory the accessories are generated from.
+---@param region string
+---@param username string
+---@param password string
+---@param ssid string
+local function refreshInventory(fp, cached, region, username, password, ssid)
+    local success, inventory = xpcall(fetchInventory, traceback, region, username, password, ssid)
+    if success == false then
+        logger:error(inventory)
+        logger:default("Failed to refresh the inventory, keep using the cached one.")
+        return
+    end
+
+    local entries = {}
+    for _, entry in ipairs(cached) do
+        entries[entry.sn] = entry
+    end
+
+    local changed = #inventory ~= #cached
+    for _, entry in ipairs(inventory) do
+        local old = entries[entry.sn]
+        if old == nil then
+            logger:info(("New device %s(%s), takes effect after restart."):format(entry.name, entry.model))
+            changed = true
+        else
+            entries[entry.sn] = nil
+            if old.addr ~= entry.addr or old.token ~= entry.token then
+                local obj = devices[entry.sn]
+                if obj then
+                    obj:update(entry.addr, entry.token)
+                end
+                changed = true
+            end
+            if old.name ~= entry.name or old.model ~= entry.model or
+                old.fw_ver ~= entry.fw_ver or old.hw_ver ~= entry.hw_ver then
+                logger:info(("Device %s(%s) is changed, takes effect after restart."):format(entry.name, entry.model))
+                changed = true
             end
         end
     end
+    for sn, entry in pairs(entries) do
+        logger:info(("Device %s(%s) is removed, takes effect after restart."):format(entry.name, entry.model))
+        local obj = devices[sn]
+        if obj then
+            obj:close()
+            devices[sn] = nil
+        end
+    end
+
+    if changed then
+        saveInventory(fp, inventory)
+        logger:info("Inventory updated.")
+    end
+end
+
+---Initialize plugin.
+---
+---The device inventory is cached in NVS, a warm start generates the accessories
+---from the cache and refreshes the inventory from the cloud in the background.
+---@return HAPAccessory[] bridgedAccessories Bridges Accessories.
+function M.init()
+    logger:info("Initialing ...")
+
+    local region = assert(config.get("miio.region"), "config 'miio.region' not exist")
+    local username = assert(config.get("miio.username"), "config 'miio.username' not exist")
+    local password = assert(config.get("miio.password"), "missing 'miio.password' not exist")
+    local ssid = assert(config.get("miio.ssid"), "config 'miio.ssid' not exist")
+    local fp = fingerprint(region, username, ssid)
+
+    local inventory = loadInventory(fp)
+    local cached = inventory ~= nil
+    if cached then
+        logger:info(("Loaded %d devices from the cache."):format(#inventory))
+    else
+        inventory = fetchInventory(region, username, password, ssid)
+        saveInventory(fp, inventory)
+    end
     collectgarbage()
 
     local accessories = {}
 
-    for _, conf in ipairs(confs) do
-        local success, result = xpcall(gen, traceback, conf)
+    -- The generation does not yield, running it in tasks would not overlap anything.
+    local start = core.time()
+    for _, entry in ipairs(inventory) do
+        local success, result = xpcall(gen, traceback, entry)
         if success == false then
             logger:error(result)
         else
-            table.insert(accessories, result)
+            tinsert(accessories, result)
         end
     end
+    logger:info(("Generated %d accessories in %d ms."):format(#accessories, core.time() - start))
+
+    if cached then
+        core.createTimer(refreshInventory, fp, inventory, region, username, password, ssid):start(0)
+    end
     return accessories
 end
 
@@ -1,11 +1,16 @@
 local socket = require "socket"
-local hash = require "hash"
-local cipher = require "cipher"
+local miio = require "miio"
 local json = require "cjson"
 
 local assert = assert
 local type = type
 local error = error
+local pcall = pcall
+local pairs = pairs
+local next = next
+local ipairs = ipairs
+local tinsert = table.insert
+local tremove = table.remove
 local floor = math.floor
 local spack = string.pack
 local sunpack = string.unpack
@@ -15,6 +20,9 @@ local srep = string.rep
 local M = {}
 local logger = log.getLogger("miio.protocol")
 
+---The request ID is in the range [1, MAX_REQID].
+local MAX_REQID = 9999
+
 ---
 --- Message format
 ---
@@ -85,88 +93,23 @@ local logger = log.getLogger("miio.protocol")
 ---
 --- The mode of operation is Cipher Block Chaining (CBC).
 ---
----@class MiioEncryption
-local encryption = {}
-
----Encrypt data.
----@param input string
----@return string output
-function encryption:encrypt(input)
-    local ctx = self.ctx
-    return ctx:begin("encrypt", self.key, self.iv):update(input) .. ctx:finish()
-end
-
----Decrypt data.
----@param input string
----@return string output
-function encryption:decrypt(input)
-    local ctx = self.ctx
-    return ctx:begin("decrypt", self.key, self.iv):update(input) .. ctx:finish()
-end
-
----Calculates a MD5 checksum for the given data.
----@param data string
----@return string digest
-local function md5(data)
-    return hash.create("MD5"):update(data):digest()
-end
-
----Create an encryption.
----@param token string Device token.
----@return MiioEncryption encryption A new encryption.
----@nodiscard
-local function createEncryption(token)
-    local ctx = cipher.create("AES-128-CBC")
-    ctx:setPadding("PKCS7")
-
-    local key = md5(token)
-    local iv = md5(key .. token)
-
-    ---@class MiioEncryption
-    local o = {
-        ctx = ctx,
-        key = key,
-        iv = iv,
-    }
-
-    return setmetatable(o, {
-        __index = encryption
-    })
-end
+--- The packages with data are encoded and decoded by ``MiioCodec``.
 
----Pack a message to a binary package.
+---Pack a message without data to a binary package.
 ---@param unknown integer Unknown: 32-bit.
 ---@param did integer Device ID: 32-bit.
 ---@param stamp integer Stamp: 32 bit unsigned int.
----@param token? string Device token: 128-bit.
----@param data? string Optional variable-sized data.
 ---@return string package
 ---@nodiscard
-local function pack(unknown, did, stamp, token, data)
-    local len = 32
-    if data then
-        len = len + #data
-    end
-
-    local header = spack(">I2>I2>I4>I4>I4",
-        0x2131, len, unknown, did, stamp)
-    local checksum = nil
-    if token then
-        checksum = md5(header .. token .. (data or ""))
-    else
-        checksum = srep(schar(0xff), 16)
-    end
-    assert(#checksum == 16)
-
-    return header .. checksum .. (data or "")
+local function pack(unknown, did, stamp)
+    return spack(">I2>I2>I4>I4>I4", 0x2131, 32, unknown, did, stamp) .. srep(schar(0xff), 16)
 end
 
----Unpack a message from a binary package.
+---Unpack a message without data from a binary package.
 ---@param package string A binary package.
----@param token? string Device token: 128-bit.
 ---@return MiioMessage message
 ---@nodiscard
-local function unpack(package, token)
+local function unpack(package)
     if sunpack(">I2", package, 1) ~= 0x2131 then
         error("Invalid magic number.")
     end
@@ -181,14 +124,6 @@ local function unpack(package, token)
         data = sunpack("c" .. len - 32, package, 33)
     end
 
-    if token then
-        local checksum = md5(sunpack("c16", package, 1) .. token .. (data or ""))
-        assert(#checksum == 16)
-        if checksum ~= sunpack("c16", package, 17) then
-            error("Got checksum error which indicates use of an invalid token.")
-        end
-    end
-
     return {
         unknown = sunpack(">I4", package, 5),
         did = sunpack(">I4", package, 9),
@@ -233,28 +168,31 @@ function M.scan(timeout, addr)
     local results = {}
 
     while true do
-        local success, result, fromAddr, _ = pcall(sock.recvfrom, sock, 1024)
+        local success, msgs = pcall(sock.recvmany, sock, 32, 1024)
         if success == false then
-            if addr == nil and result:find("timeout") then
+            if addr == nil and msgs:find("timeout") then
                 return results
             end
-            error(result)
-        end
-        local m = unpack(result)
-        if m == nil or m.unknown ~= 0 or m.data then
-            error("Got a invalid miIO protocol packet.")
-        end
-        table.insert(results, {
-            addr = fromAddr,
-            devid = m.did,
-            stamp = m.stamp
-        })
-        if addr then
-            assert(addr == fromAddr)
-            return results
+            error(msgs)
         end
-        if seen[fromAddr] == false then
-            seen[fromAddr] = true
+        for _, msg in ipairs(msgs) do
+            local fromAddr = msg.addr
+            local m = unpack(msg.data)
+            if m == nil or m.unknown ~= 0 or m.data then
+                error("Got a invalid miIO protocol packet.")
+            end
+            table.insert(results, {
+                addr = fromAddr,
+                devid = m.did,
+                stamp = m.stamp
+            })
+            if addr then
+                assert(addr == fromAddr)
+                return results
+            end
+            if seen[fromAddr] == false then
+                seen[fromAddr] = true
+            end
         end
     end
 end
@@ -278,80 +216,262 @@ function pcb:handshake(timeout)
     self.stampDiff = floor(core.time() / 1000) - result.stamp
 end
 
----Start a request.
+---Dispatch a response to the request waiting for it.
+---@param self MiioPcb
+---@param package string A binary package.
+local function dispatch(self, package)
+    local success, did, _, s = pcall(self.codec.decode, self.codec, package)
+    if success == false then
+        logger:error(("%s: %s"):format(self.addr, did))
+        return
+    end
+    if did ~= self.devid or s == nil then
+        logger:error(("%s: Receive a invalid message."):format(self.addr))
+        return
+    end
+    logger:debug(("%s => %s"):format(self.addr, s))
+    local payload
+    success, payload = pcall(json.decode, s)
+    if success == false or type(payload) ~= "table" then
+        logger:error(("%s: Failed to parse the JSON string."):format(self.addr))
+        return
+    end
+    local waiter = self.waiters[payload.id]
+    if not waiter then
+        logger:debug(("%s: Drop the response %s without request."):format(self.addr, payload.id))
+        return
+    end
+    self.waiters[payload.id] = nil
+    waiter:trySend(payload)
+end
+
+---Receive the responses until no request is waiting.
+---@param self MiioPcb
+local function recvLoop(self)
+    local sock = self.sock
+    while next(self.waiters) do
+        local success, result = pcall(sock.recv, sock, 1024)
+        if success then
+            dispatch(self, result)
+        elseif not result:find("timeout") then
+            -- Close the socket, the next request will create a new one.
+            self.sock = false
+            sock:destroy()
+            for reqid, waiter in pairs(self.waiters) do
+                self.waiters[reqid] = nil
+                waiter:trySend(false, result)
+            end
+        end
+    end
+    self.receiving = false
+    -- The socket is left to the loop by close() while it is receiving.
+    if self.closed and self.sock then
+        self.sock:destroy()
+        self.sock = false
+    end
+end
+
+---Get the connected socket of the device.
+---@param self MiioPcb
 ---@param timeout integer Timeout period (in milliseconds).
----@param method string The request method.
----@param ... any The request parameters.
----@return any result
-function pcb:request(timeout, method, ...)
-    assert(timeout > 0, "timeout must be greater then 0")
-    assert(type(method) == "string")
+---@return Socket sock
+local function getSocket(self, timeout)
+    local sock = self.sock
+    if not sock then
+        sock = socket.create("UDP", "IPV4")
+        sock:settimeout(timeout)
+        sock:connect(self.addr, 54321)
+        self.sock = sock
+    end
+    return sock
+end
 
-    local params = {...}
-    if #params == 0 then
-        params = nil
+---Get the remaining time before the deadline.
+---@param deadline number
+---@return integer ms
+local function remaining(deadline)
+    local ms = floor(deadline - core.time())
+    if ms <= 0 then
+        error("timeout")
     end
+    return ms
+end
 
-    if self.stampDiff == nil then
-        self:handshake(timeout)
+---Wait for a free slot in the in-flight window.
+---@param self MiioPcb
+---@param deadline number
+local function acquire(self, deadline)
+    if self.inflight < self.window then
+        self.inflight = self.inflight + 1
+        return
     end
 
-    local sock <close> = socket.create("UDP", "IPV4")
-    sock:settimeout(timeout)
-    sock:connect(self.addr, 54321)
+    -- The slot is handed over by release().
+    local timeout = remaining(deadline)
+    local waiter = core.createMQ(1)
+    local pending = self.pending
+    tinsert(pending, waiter)
+    if waiter:recv(timeout) == nil then
+        for i, v in ipairs(pending) do
+            if v == waiter then
+                tremove(pending, i)
+                break
+            end
+        end
+        error("timeout")
+    end
+end
 
-    local reqid = self.reqid + 1
-    if reqid == 9999 then
-        reqid = 1
+---Release a slot in the in-flight window.
+---@param self MiioPcb
+local function release(self)
+    if #self.pending > 0 and self.inflight <= self.window then
+        tremove(self.pending, 1):trySend(true)
+    else
+        self.inflight = self.inflight - 1
     end
+end
+
+---Get a request ID not used by the outstanding requests.
+---@param self MiioPcb
+---@return integer reqid
+local function nextReqId(self)
+    local reqid = self.reqid
+    repeat
+        reqid = reqid % MAX_REQID + 1
+    until self.waiters[reqid] == nil
     self.reqid = reqid
+    return reqid
+end
+
+---Send a request and wait for the response.
+---@param self MiioPcb
+---@param deadline number
+---@param method string
+---@param params? any[]
+---@return any result
+local function call(self, deadline, method, params)
+    if self.closed then
+        error("closed")
+    end
+    if self.stampDiff == nil then
+        self:handshake(remaining(deadline))
+    end
+    if self.closed then
+        error("closed")
+    end
+
+    local sock = getSocket(self, self.recvTimeout)
+    local waiters = self.waiters
+    local reqid = nextReqId(self)
+    local waiter = core.createMQ(1)
     do
         local data = json.encode({
             id = reqid,
             method = method,
             params = params
         })
+        local package = self.codec:encode(self.devid, floor(core.time() / 1000) - self.stampDiff, data)
 
-        sock:send(pack(0, self.devid, floor(core.time() / 1000) - self.stampDiff,
-            self.token, self.encryption:encrypt(data)))
+        -- Register the waiter after the package is built, the encoding errors leave nothing behind.
+        waiters[reqid] = waiter
+        local success, err = pcall(sock.send, sock, package)
+        if success == false then
+            waiters[reqid] = nil
+            error(err)
+        end
 
         logger:debug(("%s => %s"):format(data, self.addr))
     end
 
-    local success, result = pcall(sock.recv, sock, 1024)
-    if success == false then
-        if result:find("timeout") then
-            self.stampDiff = nil
-        end
-        error(result)
+    if not self.receiving then
+        self.receiving = true
+        core.createTimer(recvLoop, self):start(0)
     end
-    self.errCnt = 0
-    local msg = unpack(result, self.token)
 
-    if msg == nil or msg.did ~= self.devid or msg.data == nil then
-        error("Receive a invalid message.")
-    end
-    local s = self.encryption:decrypt(msg.data)
-    if not s then
-        error("Failed to decrypt the message.")
-    end
-    logger:debug(("%s => %s"):format(self.addr, s))
-    local payload =  json.decode(s)
-    if not payload then
-        error("Failed to parse the JSON string.")
+    local payload, err = nil, nil
+    local timeout = floor(deadline - core.time())
+    if timeout > 0 then
+        payload, err = waiter:recv(timeout)
     end
-    if payload.id ~= reqid then
-        error("response id ~= request id")
+    if payload == nil then
+        waiters[reqid] = nil
+        self.stampDiff = nil
+        error("timeout")
+    elseif payload == false then
+        error(err)
     end
+
     ---@class MiioError
-    local err = payload.error
-    if err then
-        error(err)
+    local e = payload.error
+    if e then
+        error(e)
     end
 
     return payload.result
 end
 
+---Set the in-flight window.
+---@param window integer The max number of outstanding requests.
+function pcb:setWindow(window)
+    assert(math.type(window) == "integer" and window > 0, "window must be a positive integer")
+    self.window = window
+    -- Hand the new slots to the waiting requests.
+    while #self.pending > 0 and self.inflight < window do
+        self.inflight = self.inflight + 1
+        tremove(self.pending, 1):trySend(true)
+    end
+end
+
+---Start a request.
+---
+---Up to ``window`` requests are outstanding at the same time, the others
+---wait for a free slot. The responses are matched to the requests by the
+---request ID. ``timeout`` covers the whole request, including the wait.
+---@param timeout integer Timeout period (in milliseconds).
+---@param method string The request method.
+---@param ... any The request parameters.
+---@return any result
+function pcb:request(timeout, method, ...)
+    assert(timeout > 0, "timeout must be greater then 0")
+    assert(type(method) == "string")
+
+    local params = {...}
+    if #params == 0 then
+        params = nil
+    end
+
+    local deadline = core.time() + timeout
+    acquire(self, deadline)
+    local success, result = pcall(call, self, deadline, method, params)
+    release(self)
+    if success == false then
+        error(result, 0)
+    end
+    return result
+end
+
+---Close the PCB.
+---
+---The outstanding requests fail with "closed", the later requests fail at once.
+function pcb:close()
+    if self.closed then
+        return
+    end
+    self.closed = true
+    for reqid, waiter in pairs(self.waiters) do
+        self.waiters[reqid] = nil
+        waiter:trySend(false, "closed")
+    end
+    -- A receiving socket cannot be destroyed under the pending recv,
+    -- recvLoop() destroys it once the recv returns.
+    local sock = self.sock
+    if sock and not self.receiving then
+        self.sock = false
+        sock:destroy()
+    end
+end
+
 ---Create a PCB(protocol control block).
 ---@param addr string Device address.
 ---@param token string Device token: 128-bit.
@@ -367,9 +487,17 @@ function M.create(addr, token)
         addr = addr,
         token = token,
         reqid = 0,
+        sock = false, ---@type Socket|false
+        recvTimeout = 1000,
+        receiving = false,
+        waiters = {}, ---@type table<integer, MessageQueue>
+        window = 4,
+        inflight = 0,
+        pending = {}, ---@type MessageQueue[]
+        closed = false,
     }
 
-    o.encryption = createEncryption(token)
+    o.codec = miio.create(token)
 
     setmetatable(o, {
         __index = pcb
@@ -28,8 +28,8 @@ function M.gen(device, conf)
         {
             hap.AccessoryInformationService,
             hap.newService(iids.heater, "HeaterCooler", true, false, {
-                Active.new(iids.active, function (request)
-                    return device:getProp("on") and Active.value.Active or Active.value.Inactive
+                device:bind(Active, iids.active, "on", function (on)
+                    return on and Active.value.Active or Active.value.Inactive
                 end, function (request, value)
                     device:setProp("on", value == Active.value.Active)
                     raiseEvent(request.aid, request.sid, request.cid)
@@ -37,21 +37,17 @@ function M.gen(device, conf)
                         raiseEvent(request.aid, iids.heaterCooler, iids.curState)
                     end):start(500)
                 end),
-                CurTemp.new(iids.curTemp, function (request)
-                    return device:getProp("curTemp")
-                end):setContraints(-30, 100, 1),
-                CurHeatCoolState.new(iids.curState, function (request)
-                    if not device:getProp("on") then
+                device:bind(CurTemp, iids.curTemp, "curTemp"):setContraints(-30, 100, 1),
+                device:bind(CurHeatCoolState, iids.curState, { "on", "curState" }, function (on, curState)
+                    if not on then
                         return CurHeatCoolState.value.Inactive
                     end
-                    return device:getProp("curState") == 2 and CurHeatCoolState.value.Heating or CurHeatCoolState.value.Idle
+                    return curState == 2 and CurHeatCoolState.value.Heating or CurHeatCoolState.value.Idle
                 end):setValidVals(CurHeatCoolState.value.Inactive, CurHeatCoolState.value.Idle, CurHeatCoolState.value.Heating),
                 TgtHeatCoolState.new(iids.tgtState, function (request)
                     return TgtHeatCoolState.value.Heat
                 end, nil):setValidVals(TgtHeatCoolState.value.Heat),
-                HeatThrholdTemp.new(iids.heatThrTemp, function (request)
-                    return device:getProp("tgtTemp")
-                end, function (request, value)
+                device:bind(HeatThrholdTemp, iids.heatThrTemp, "tgtTemp", nil, function (request, value)
                     device:setProp("tgtTemp", assert(tointeger(value), "value not a integer"))
                     raiseEvent(request.aid, request.sid, request.cid)
                 end):setContraints(18, 28, 1),
@@ -59,7 +55,8 @@ function M.gen(device, conf)
         },
         function (request)
             device.logger:info("Identify callback is called.")
-        end
+        end,
+        device.readBatch
     )
 end
 
@@ -39,20 +39,18 @@ function M.gen(device, conf)
         {
             hap.AccessoryInformationService,
             hap.newService(iids.fan, "Fan", true, false, {
-                Active.new(iids.active, function (request)
-                    return valMapping.power[device:getProp("power")]
+                device:bind(Active, iids.active, "power", function (power)
+                    return valMapping.power[power]
                 end, function (request, value)
                     device:setProp("power", searchKey(valMapping.power, value))
                     raiseEvent(request.aid, request.sid, request.cid)
                 end),
-                RotationSpeed.new(iids.rotationSpeed, function (request)
-                    return device:getProp("speed_level")
-                end, function (request, value)
+                device:bind(RotationSpeed, iids.rotationSpeed, "speed_level", nil, function (request, value)
                     device:setProp("speed_level", assert(tointeger(value), "value not a integer"))
                     raiseEvent(request.aid, request.sid, request.cid)
                 end):setContraints(1, 100, 1),
-                SwingMode.new(iids.swingMode, function (request)
-                    return valMapping.angle_enable[device:getProp("angle_enable")]
+                device:bind(SwingMode, iids.swingMode, "angle_enable", function (angle_enable)
+                    return valMapping.angle_enable[angle_enable]
                 end, function (request, value)
                     device:setProp("angle_enable", searchKey(valMapping.angle_enable, value))
                     raiseEvent(request.aid, request.sid, request.cid)
@@ -61,7 +59,8 @@ function M.gen(device, conf)
         },
         function (request)
             device.logger:info("Identify callback is called.")
-        end
+        end,
+        device.readBatch
     )
 end
 
@@ -0,0 +1,40 @@
+---Benchmark the one-shot digest and cipher functions
+---against the contexts created per call.
+
+local hash = require "hash"
+local cipher = require "cipher"
+
+local count = 100000
+local data = ("x"):rep(64)
+local key = ("k"):rep(16)
+local iv = ("i"):rep(16)
+
+local function bench(name, fn)
+    local start = core.time()
+    for i = 1, count, 1 do
+        fn()
+    end
+    local elapsed = core.time() - start
+    print(("%-24s %d calls, elapsed: %d ms, %.2f us/call"):format(
+        name, count, elapsed, elapsed * 1000 / count))
+end
+
+bench("hash.create(MD5)", function ()
+    return hash.create("MD5"):update(data):digest()
+end)
+bench("hash.digest(MD5)", function ()
+    return hash.digest("MD5", data)
+end)
+bench("hash.create(HMAC)", function ()
+    return hash.create("SHA256", key):update(data):digest()
+end)
+bench("hash.digest(HMAC)", function ()
+    return hash.digest("SHA256", data, key)
+end)
+bench("cipher.create(AES)", function ()
+    local ctx = cipher.create("AES-128-CBC")
+    return ctx:begin("encrypt", key, iv):update(data) .. ctx:finish()
+end)
+bench("cipher.crypt(AES)", function ()
+    return cipher.crypt("AES-128-CBC", "encrypt", key, iv, data)
+end)
@@ -0,0 +1,63 @@
+---Benchmark the wakeup cost of the run loop with many idle sockets.
+---
+---Every round registers ``n - 2`` idle UDP sockets waiting for data,
+---then measures the round trip time of a UDP echo pair, each round trip
+---takes two wakeups of the run loop.
+---
+---Raise the open files limit (``ulimit -n 8192``) before running it.
+
+local socket = require "socket"
+
+local rounds = { 100, 1000, 5000 }
+local count = 1000
+local port = 8890
+
+local function bench(n)
+    local idles = {}
+    for i = 1, n - 2, 1 do
+        local sock = socket.create("UDP", "IPV4")
+        sock:connect("127.0.0.1", 9)
+        core.createTimer(function ()
+            pcall(sock.recv, sock, 16)
+        end):start(0)
+        idles[i] = sock
+    end
+
+    local server = socket.create("UDP", "IPV4")
+    server:bind("127.0.0.1", port)
+    core.createTimer(function ()
+        while true do
+            local msg, addr, port = server:recvfrom(16)
+            if #msg == 0 then
+                server:destroy()
+                return
+            end
+            server:sendto(msg, addr, port)
+        end
+    end):start(0)
+
+    local client <close> = socket.create("UDP", "IPV4")
+    client:connect("127.0.0.1", port)
+
+    -- Let the idle sockets start waiting.
+    core.sleep(100)
+
+    local start = core.time()
+    for i = 1, count, 1 do
+        client:send("ping")
+        assert(client:recv(16) == "ping")
+    end
+    local elapsed = core.time() - start
+    client:send("")
+
+    for _, sock in ipairs(idles) do
+        sock:destroy()
+    end
+
+    print(("fds: %5d, round trips: %d, elapsed: %d ms, %.1f us/wakeup"):format(
+        n, count, elapsed, elapsed * 1000 / (count * 2)))
+end
+
+for _, n in ipairs(rounds) do
+    bench(n)
+end
@@ -1,6 +1,10 @@
 local suites = {
     "testsocket",
-    "testnvs"
+    "testnvs",
+    "testhash",
+    "testmiio",
+    "testhap",
+    "testcore"
 }
 
 local function runSuite(s)
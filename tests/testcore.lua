@@ -0,0 +1,269 @@
+-- Tests core.sleep() waiting at least the given time, and not waiting for 0.
+do
+    local start = core.time()
+    core.sleep(0)
+    assert(core.time() - start < 5)
+
+    start = core.time()
+    core.sleep(20)
+    assert(core.time() - start >= 20)
+end
+
+-- Tests the timers in different levels of the wheel firing in order.
+do
+    local fired = {}
+    local done = core.createMQ(1)
+    local delays = { 300, 0, 70, 5, 1, 64 }
+    for _, ms in ipairs(delays) do
+        core.createTimer(function ()
+            table.insert(fired, ms)
+            if #fired == #delays then
+                done:send()
+            end
+        end):start(ms)
+    end
+    done:recv()
+    local expected = { 0, 1, 5, 64, 70, 300 }
+    for i, ms in ipairs(expected) do
+        assert(fired[i] == ms)
+    end
+end
+
+-- Tests a timer firing on time after an unrelated timer fires,
+-- while a later timer is in the current slot of a higher level of the wheel.
+for _, delays in ipairs({ { 4095, 200 }, { 5 * 3600 * 1000, 300 * 1000 } }) do
+    local long = core.createTimer(function () end)
+    long:start(delays[1])
+    local start = core.time()
+    local fired
+    core.createTimer(function ()
+        fired = core.time()
+    end):start(delays[2])
+    core.createTimer(function () end):start(10)
+    core.sleep(delays[2] + 100)
+    long:stop()
+    assert(fired and fired - start >= delays[2] and fired - start < delays[2] + 50)
+end
+
+-- Tests a periodic timer.
+do
+    local count = 0
+    local timer = core.createTimer(function ()
+        count = count + 1
+    end)
+    timer:start(10, true)
+    core.sleep(55)
+    timer:stop()
+    assert(count >= 3 and count <= 5)
+    local stopped = count
+    core.sleep(30)
+    assert(count == stopped)
+end
+
+-- Tests stopping and restarting a timer.
+do
+    local count = 0
+    local timer = core.createTimer(function ()
+        count = count + 1
+    end)
+    timer:start(20)
+    timer:stop()
+    core.sleep(30)
+    assert(count == 0)
+
+    timer:start(50)
+    timer:start(10)
+    core.sleep(20)
+    assert(count == 1)
+    core.sleep(50)
+    assert(count == 1)
+end
+
+-- Tests the timers with a tolerance.
+do
+    core.setTimerTolerance(20)
+    local start = core.time()
+    core.sleep(1)
+    local elapsed = core.time() - start
+    core.setTimerTolerance(0)
+    assert(elapsed >= 1 and elapsed <= 25)
+    assert(pcall(core.setTimerTolerance, -1) == false)
+end
+
+-- Tests core.spawn() with a task finishing at once.
+do
+    local task = core.spawn(function (a, b)
+        return a + b, "ok"
+    end, 1, 2)
+    assert(task:done())
+    local sum, s = task:join()
+    assert(sum == 3 and s == "ok")
+end
+
+-- Tests task:join() waiting for a task.
+do
+    local task = core.spawn(function (ms)
+        core.sleep(ms)
+        return ms
+    end, 10)
+    assert(not task:done())
+    assert(task:join() == 10)
+    assert(task:done())
+    assert(task:join() == 10)
+end
+
+-- Tests task:join() raising the error of the task.
+do
+    local task = core.spawn(function ()
+        core.sleep(10)
+        error("task error")
+    end)
+    local success, err = pcall(task.join, task)
+    assert(success == false)
+    assert(err:find("task error"))
+end
+
+-- Tests several coroutines joining the same task.
+do
+    local task = core.spawn(function ()
+        core.sleep(10)
+        return "done"
+    end)
+    local joiners = {}
+    for i = 1, 3, 1 do
+        joiners[i] = core.spawn(function ()
+            return task:join()
+        end)
+    end
+    for _, joiner in ipairs(joiners) do
+        assert(joiner:join() == "done")
+    end
+end
+
+-- Tests core.spawn() with invalid parameters.
+do
+    assert(pcall(core.spawn, nil) == false)
+    assert(pcall(core.spawn, "func") == false)
+end
+
+-- Tests the values of the messages, including nil values.
+do
+    local mq = core.createMQ(4)
+    mq:send(1, nil, 3)
+    mq:send("a")
+    assert(select("#", mq:recv()) == 3)
+    local a, b = mq:recv()
+    assert(a == "a" and b == nil)
+end
+
+-- Tests mq:trySend() on a full queue and mq:recv(0) on an empty queue.
+do
+    local mq = core.createMQ(2)
+    assert(mq:trySend(1) == true)
+    assert(mq:trySend(2) == true)
+    assert(mq:trySend(3) == false)
+    assert(mq:recv(0) == 1)
+    assert(mq:recv(0) == 2)
+    assert(select("#", mq:recv(0)) == 0)
+end
+
+-- Tests mq:recv() with a timeout.
+do
+    local mq = core.createMQ(1)
+    local start = core.time()
+    assert(select("#", mq:recv(20)) == 0)
+    assert(core.time() - start >= 20)
+
+    core.createTimer(function ()
+        mq:send("late")
+    end):start(10)
+    assert(mq:recv(1000) == "late")
+end
+
+-- Tests a message without values, it is received as nothing like a timeout.
+do
+    local mq = core.createMQ(1)
+    assert(mq:trySend() == true)
+    assert(select("#", mq:recv(0)) == 0)
+    assert(mq:trySend(true) == true)
+    assert(mq:recv(0) == true)
+end
+
+-- Tests mq:send() waiting on a full queue.
+do
+    local mq = core.createMQ(1)
+    mq:send(1)
+    local sender = core.spawn(function ()
+        mq:send(2)
+        return true
+    end)
+    assert(not sender:done())
+    assert(mq:recv() == 1)
+    assert(sender:join() == true)
+    assert(mq:recv(0) == 2)
+end
+
+-- Tests multiple producers and consumers, each message is received once.
+do
+    local mq = core.createMQ(2)
+    local producers = {}
+    for p = 1, 3, 1 do
+        producers[p] = core.spawn(function ()
+            for i = 1, 10, 1 do
+                mq:send(p * 100 + i)
+                if i % 3 == 0 then
+                    core.sleep(1)
+                end
+            end
+        end)
+    end
+    local consumers = {}
+    for c = 1, 3, 1 do
+        consumers[c] = core.spawn(function ()
+            local got = {}
+            while true do
+                local v = mq:recv()
+                if v == false then
+                    return got
+                end
+                table.insert(got, v)
+            end
+        end)
+    end
+    for _, producer in ipairs(producers) do
+        producer:join()
+    end
+    for _ = 1, #consumers, 1 do
+        mq:send(false)
+    end
+    local seen = {}
+    local count = 0
+    for _, consumer in ipairs(consumers) do
+        for _, v in ipairs(consumer:join()) do
+            assert(seen[v] == nil)
+            seen[v] = true
+            count = count + 1
+        end
+    end
+    assert(count == 30)
+end
+
+-- Tests the pressure threshold following the live data,
+-- it falls back to the configured one after a peak is collected.
+do
+    local base = core.getGCStats().heap + 1024
+    core.setGCConfig({ mode = "generational", pressure = base })
+    local peak = {}
+    for i = 1, 2 * base, 1 do
+        peak[i] = ("x"):rep(1000) .. i
+    end
+    -- The next tick runs a full collection with the peak alive.
+    core.sleep(10)
+    assert(core.getGCStats().pressure >= 2 * base)
+    peak = nil
+    collectgarbage()
+    -- The next tick finishes a cycle without the peak.
+    core.sleep(10)
+    assert(core.getGCStats().pressure == base)
+    core.setGCConfig({ pressure = 0 })
+end
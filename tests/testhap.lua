@@ -0,0 +1,37 @@
+local hap = require "hap"
+
+local props = {
+    readable = true,
+    writable = false,
+    supportsEventNotification = true
+}
+
+-- Tests characteristic:setValue() with valid values.
+do
+    local on = hap.newCharacteristic(1, "Bool", hap.CharType.On, props)
+    assert(on:setValue(true) == on)
+    assert(on:setValue(nil) == on)
+
+    local brightness = hap.newCharacteristic(2, "Int", hap.CharType.Brightness, props):setContraints(0, 100, 1)
+    for _, value in ipairs({ 0, 50, 100, 1.0 }) do
+        brightness:setValue(value)
+    end
+
+    local name = hap.newCharacteristic(3, "String", hap.CharType.Name, props):setContraints(4)
+    name:setValue("Lamp")
+end
+
+-- Tests characteristic:setValue() rejecting the values which cannot be read.
+do
+    local on = hap.newCharacteristic(1, "Bool", hap.CharType.On, props)
+    assert(pcall(on.setValue, on, 1) == false)
+
+    local brightness = hap.newCharacteristic(2, "Int", hap.CharType.Brightness, props):setContraints(0, 100, 1)
+    for _, value in ipairs({ 1.5, -1, 101, 1 << 40, "abc", true }) do
+        local success, err = pcall(brightness.setValue, brightness, value)
+        assert(success == false and err:find("invalid value"))
+    end
+
+    local name = hap.newCharacteristic(3, "String", hap.CharType.Name, props):setContraints(4)
+    assert(pcall(name.setValue, name, "Lamp 1") == false)
+end
@@ -0,0 +1,66 @@
+local hash = require "hash"
+local cipher = require "cipher"
+
+local function hex(s)
+    return (s:gsub(".", function (c)
+        return ("%02x"):format(c:byte())
+    end))
+end
+
+-- Tests hash.digest() with known digests.
+do
+    assert(hex(hash.digest("MD5", "abc")) == "900150983cd24fb0d6963f7d28e17f72")
+    assert(hex(hash.digest("MD5", "")) == "d41d8cd98f00b204e9800998ecf8427e")
+    assert(hex(hash.digest("SHA256", "The quick brown fox jumps over the lazy dog", "key")) ==
+        "f7bc83f430538424b13298e6aa6fb143ef4d59a14946175997479dbc2d1a3cd8")
+end
+
+-- Tests hash.digest() matches the hash context.
+for _, type in ipairs({"MD5", "SHA1", "SHA256", "SHA512"}) do
+    for _, k in ipairs({false, "key"}) do
+        local key = k or nil
+        for i = 1, 3, 1 do
+            local data = ("%d"):format(i):rep(i * 100)
+            assert(hash.digest(type, data, key) == hash.create(type, key):update(data):digest())
+        end
+    end
+end
+
+-- Tests hash.digest() with invalid parameters.
+do
+    assert(pcall(hash.digest, "XXX", "abc") == false)
+    assert(pcall(hash.digest, "MD5", nil) == false)
+    assert(pcall(hash.digest, "MD5", "abc", "") == false)
+end
+
+-- Tests cipher.crypt() matches the cipher context.
+do
+    local key = ("k"):rep(16)
+    local iv = ("i"):rep(16)
+    local ctx = cipher.create("AES-128-CBC")
+    ctx:setPadding("PKCS7")
+    for _, input in ipairs({"abc", ("x"):rep(16), ("y"):rep(100)}) do
+        local output = cipher.crypt("AES-128-CBC", "encrypt", key, iv, input, "PKCS7")
+        assert(output == ctx:begin("encrypt", key, iv):update(input) .. ctx:finish())
+        assert(cipher.crypt("AES-128-CBC", "decrypt", key, iv, output, "PKCS7") == input)
+    end
+    local output = cipher.crypt("AES-128-CBC", "encrypt", key, iv, "", "PKCS7")
+    assert(#output == 16)
+    assert(cipher.crypt("AES-128-CBC", "decrypt", key, iv, output, "PKCS7") == "")
+end
+
+-- Tests cipher.crypt() without IV.
+do
+    local key = ("k"):rep(16)
+    local input = ("x"):rep(32)
+    local output = cipher.crypt("AES-128-ECB", "encrypt", key, nil, input, "NONE")
+    assert(#output == 32)
+    assert(cipher.crypt("AES-128-ECB", "decrypt", key, nil, output, "NONE") == input)
+end
+
+-- Tests cipher.crypt() with invalid parameters.
+do
+    assert(pcall(cipher.crypt, "AES-128-CBC", "encrypt", "short", ("i"):rep(16), "abc") == false)
+    assert(pcall(cipher.crypt, "AES-128-CBC", "encrypt", ("k"):rep(16), "short", "abc") == false)
+    assert(pcall(cipher.crypt, "AES-128-CBC", "xxx", ("k"):rep(16), ("i"):rep(16), "abc") == false)
+end
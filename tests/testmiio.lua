@@ -0,0 +1,86 @@
+local miio = require "miio"
+local hash = require "hash"
+local cipher = require "cipher"
+
+local function bin(s)
+    return (s:gsub("%x%x", function (c)
+        return string.char(tonumber(c, 16))
+    end))
+end
+
+local token = bin("00112233445566778899AABBCCDDEEFF")
+local data = '{"id":1,"method":"miIO.info","params":[]}'
+
+-- The package of the data above, generated with OpenSSL.
+local package = bin("2131005000000000123456780000ABCDD5A1F818B565F57343BD901607075BAC" ..
+    "A5516EC6151955DC2BB2D43E7C84C18352A39A7F22FD2903D282A5783C6D56AC8C9C7629130A25FAC17D38175C1A7799")
+
+-- Tests codec:encode() and codec:decode() with a known package.
+do
+    local codec = miio.create(token)
+    assert(codec:encode(0x12345678, 0xabcd, data) == package)
+    local did, stamp, s = codec:decode(package)
+    assert(did == 0x12345678 and stamp == 0xabcd and s == data)
+end
+
+-- Tests the round trip of the data with different lengths.
+do
+    local codec = miio.create(token)
+    for _, len in ipairs({0, 1, 15, 16, 17, 1000}) do
+        local s = ("x"):rep(len)
+        local pkt = codec:encode(1, 2, s)
+        assert(#pkt == 32 + (len // 16 + 1) * 16)
+        local did, stamp, out = codec:decode(pkt)
+        assert(did == 1 and stamp == 2 and out == s)
+    end
+end
+
+-- Tests codec:decode() with a checksum mismatch.
+do
+    local other = miio.create(("\0"):rep(16))
+    local success, err = pcall(other.decode, other, package)
+    assert(success == false and err:find("checksum"))
+
+    local codec = miio.create(token)
+    local tampered = package:sub(1, 40) .. string.char(package:byte(41) ~ 1) .. package:sub(42)
+    success, err = pcall(codec.decode, codec, tampered)
+    assert(success == false and err:find("checksum"))
+end
+
+-- Tests codec:decode() with invalid packages.
+do
+    local codec = miio.create(token)
+    assert(pcall(codec.decode, codec, "") == false)
+    assert(pcall(codec.decode, codec, package:sub(1, 31)) == false)
+    assert(pcall(codec.decode, codec, package .. "\0") == false)
+    assert(pcall(codec.decode, codec, "\0\0" .. package:sub(3)) == false)
+end
+
+-- Build a package with a valid checksum around the raw encrypted data.
+local function pack(did, stamp, data)
+    local head = string.pack(">I2I2I4I4I4", 0x2131, 32 + #data, 0, did, stamp)
+    return head .. hash.digest("MD5", head .. token .. data) .. data
+end
+
+-- Tests the codec still works after failing to decrypt a package with a valid checksum.
+do
+    local codec = miio.create(token)
+    local key = hash.digest("MD5", token)
+    local iv = hash.digest("MD5", key .. token)
+    local badPadding = cipher.crypt("AES-128-CBC", "encrypt", key, iv, ("x"):rep(16), "NONE")
+    for _, pkt in ipairs({pack(1, 2, badPadding), pack(1, 2, ("x"):rep(15))}) do
+        local success, err = pcall(codec.decode, codec, pkt)
+        assert(success == false and err:find("decrypt"))
+        assert(codec:encode(0x12345678, 0xabcd, data) == package)
+        local did, stamp, s = codec:decode(package)
+        assert(did == 0x12345678 and stamp == 0xabcd and s == data)
+    end
+end
+
+-- Tests the parameters.
+do
+    assert(pcall(miio.create, "short") == false)
+    local codec = miio.create(token)
+    assert(pcall(codec.encode, codec, -1, 0, data) == false)
+    assert(pcall(codec.encode, codec, 0, 0x100000000, data) == false)
+end
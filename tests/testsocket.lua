@@ -92,6 +92,35 @@ do
     assert(client:send("") == 0)
 end
 
+---Test socket.recvmany() draining queued messages.
+do
+    local server <close> = socket.create("UDP", "IPV4")
+    server:bind("127.0.0.1", 8889)
+    local client <close> = socket.create("UDP", "IPV4")
+    client:connect("127.0.0.1", 8889)
+    for i = 1, 10, 1 do
+        local msg = fillStr(i * 10)
+        assert(client:send(msg) == #msg)
+    end
+    local msgs = server:recvmany(4, 1024)
+    assert(#msgs == 4)
+    msgs = server:recvmany(16, 1024)
+    assert(#msgs == 6)
+    for i, msg in ipairs(msgs) do
+        assert(msg.data == fillStr((i + 4) * 10))
+        assert(msg.addr == "127.0.0.1")
+        assert(math.type(msg.port) == "integer")
+    end
+end
+
+---Test socket.recvmany() with invalid parameters.
+do
+    local sock <close> = socket.create("UDP", "IPV4")
+    for _, args in ipairs({{0, 1024}, {65, 1024}, {1, 0}}) do
+        assert(pcall(sock.recvmany, sock, table.unpack(args)) == false)
+    end
+end
+
 ---Test TCP socket echo
 do
     local listener = socket.create("TCP", "IPV4")
@@ -119,3 +148,24 @@ do
     end
     assert(client:send("") == 0)
 end
+
+---Test destroying a socket in a timer while an event of the socket is pending.
+do
+    local server = socket.create("UDP", "IPV4")
+    server:bind("127.0.0.1", 8890)
+    core.createTimer(function ()
+        server:recvfrom(1024)
+        error("the destroyed socket is read")
+    end):start(0)
+    core.sleep(10)
+    core.createTimer(function ()
+        server:destroy()
+    end):start(0)
+    local client <close> = socket.create("UDP", "IPV4")
+    client:connect("127.0.0.1", 8890)
+    assert(client:send("ping") == 4)
+    -- Block the run loop, so that the timer expires in the same wakeup as the datagram arrives.
+    local start = core.time()
+    while core.time() - start < 10 do end
+    core.sleep(10)
+end
@@ -0,0 +1,41 @@
+// Copyright (c) 2021-2023 Zebin Wu and homekit-bridge contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of homekit-bridge project authors.
+
+#ifndef HAP_PLATFORM_FILE_HANDLE_EPOLL_H
+#define HAP_PLATFORM_FILE_HANDLE_EPOLL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "HAPPlatform.h"
+#include "HAPPlatformFileHandle.h"
+
+#if __has_feature(nullability)
+#pragma clang assume_nonnull begin
+#endif
+
+/**
+ * Switches a file handle between level-triggered (default) and edge-triggered notification.
+ *
+ * In edge-triggered mode the callback is only invoked when the readiness of the file descriptor changes,
+ * so it must read or write until the operation fails with EAGAIN. Updating the interests of the file handle
+ * re-arms the notification.
+ *
+ * @param      fileHandle           File handle.
+ * @param      edgeTriggered        Whether to use edge-triggered notification.
+ */
+void HAPPlatformFileHandleSetEdgeTriggered(HAPPlatformFileHandleRef fileHandle, bool edgeTriggered);
+
+#if __has_feature(nullability)
+#pragma clang assume_nonnull end
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,696 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+//
+// Copyright (c) 2021-2023 Zebin Wu and homekit-bridge contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of homekit-bridge project authors.
+
+// This implementation is based on `epoll`, the cost of a wakeup only depends on the number of ready file
+// descriptors instead of the number of registered ones, and there is no FD_SETSIZE limit.
+
+#include "HAPPlatform.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "HAPPlatform+Init.h"
+#include "HAPPlatformFileHandle.h"
+#include "HAPPlatformFileHandle+Epoll.h"
+#include "HAPPlatformLog+Init.h"
+#include "HAPPlatformRunLoop+Init.h"
+
+static const HAPLogObject logObject = { .subsystem = kHAPPlatform_LogSubsystem, .category = "RunLoop" };
+
+/**
+ * Maximum number of events fetched by one epoll_wait call.
+ */
+#define kHAPPlatformRunLoop_MaxEvents ((size_t) 64)
+
+/**
+ * Internal file handle type, representing the registration of a platform-specific file descriptor.
+ */
+typedef struct HAPPlatformFileHandle HAPPlatformFileHandle;
+
+/**
+ * Internal file handle representation.
+ */
+struct HAPPlatformFileHandle {
+    /**
+     * Platform-specific file descriptor.
+     */
+    int fileDescriptor;
+
+    /**
+     * Set of file handle events on which the callback shall be invoked.
+     */
+    HAPPlatformFileHandleEvent interests;
+
+    /**
+     * Function to call when one or more events occur on the given file descriptor.
+     */
+    HAPPlatformFileHandleCallback _Nullable callback;
+
+    /**
+     * The context parameter given to the HAPPlatformFileHandleRegister function.
+     */
+    void* _Nullable context;
+
+    /**
+     * Events the file descriptor is currently registered with in the epoll instance, 0 if not registered.
+     */
+    uint32_t epollEvents;
+
+    /**
+     * Whether edge-triggered notification is used.
+     */
+    bool isEdgeTriggered;
+
+    /**
+     * Next file handle in the list of file handles released while dispatching events.
+     */
+    HAPPlatformFileHandle* _Nullable nextReleasedFileHandle;
+};
+
+/**
+ * Internal timer type.
+ */
+typedef struct HAPPlatformTimer HAPPlatformTimer;
+
+/**
+ * Internal timer representation.
+ */
+struct HAPPlatformTimer {
+    /**
+     * Deadline at which the timer expires.
+     */
+    HAPTime deadline;
+
+    /**
+     * Callback that is invoked when the timer expires.
+     */
+    HAPPlatformTimerCallback callback;
+
+    /**
+     * The context parameter given to the HAPPlatformTimerRegister function.
+     */
+    void* _Nullable context;
+
+    /**
+     * Next timer in linked list.
+     */
+    HAPPlatformTimer* _Nullable nextTimer;
+};
+
+/**
+ * Run loop state.
+ */
+HAP_ENUM_BEGIN(uint8_t, HAPPlatformRunLoopState) { /**
+                                                    * Idle.
+                                                    */
+                                                   kHAPPlatformRunLoopState_Idle,
+
+                                                   /**
+                                                    * Running.
+                                                    */
+                                                   kHAPPlatformRunLoopState_Running,
+
+                                                   /**
+                                                    * Stopping.
+                                                    */
+                                                   kHAPPlatformRunLoopState_Stopping
+} HAP_ENUM_END(uint8_t, HAPPlatformRunLoopState);
+
+static struct {
+    /**
+     * The epoll instance.
+     */
+    int epollFileDescriptor;
+
+    /**
+     * Whether expired timers or events returned by epoll_wait are being dispatched.
+     */
+    bool isDispatching;
+
+    /**
+     * File handles deregistered while dispatching events, freed after the dispatch.
+     */
+    HAPPlatformFileHandle* _Nullable releasedFileHandles;
+
+    /**
+     * Start of linked list of timers, ordered by deadline.
+     */
+    HAPPlatformTimer* _Nullable timers;
+
+    /**
+     * Self-pipe file descriptor to receive data.
+     */
+    volatile int selfPipeFileDescriptor0;
+
+    /**
+     * Self-pipe file descriptor to send data.
+     */
+    volatile int selfPipeFileDescriptor1;
+
+    /**
+     * Self-pipe byte buffer.
+     *
+     * - Callbacks are serialized into the buffer as:
+     *   - 8-byte aligned callback pointer.
+     *   - Context size (up to UINT8_MAX).
+     *   - Context (unaligned). When invoking the callback, the context is first moved to be 8-byte aligned.
+     */
+    HAP_ALIGNAS(8)
+    char selfPipeBytes[sizeof(HAPPlatformRunLoopCallback) + 1 + UINT8_MAX];
+
+    /**
+     * Number of bytes in self-pipe byte buffer.
+     */
+    size_t numSelfPipeBytes;
+
+    /**
+     * File handle for self-pipe.
+     */
+    HAPPlatformFileHandleRef selfPipeFileHandle;
+
+    /**
+     * Current run loop state.
+     */
+    HAPPlatformRunLoopState state;
+} runLoop = { .epollFileDescriptor = -1,
+              .isDispatching = false,
+              .releasedFileHandles = NULL,
+
+              .timers = NULL,
+
+              .selfPipeFileDescriptor0 = -1,
+              .selfPipeFileDescriptor1 = -1 };
+
+/**
+ * Computes the epoll events for the interests of a file handle.
+ */
+HAP_RESULT_USE_CHECK
+static uint32_t GetEpollEvents(const HAPPlatformFileHandle* fileHandle) {
+    uint32_t events = 0;
+    if (fileHandle->interests.isReadyForReading) {
+        events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (fileHandle->interests.isReadyForWriting) {
+        events |= EPOLLOUT;
+    }
+    if (fileHandle->interests.hasErrorConditionPending) {
+        events |= EPOLLPRI;
+    }
+    if (events && fileHandle->isEdgeTriggered) {
+        events |= EPOLLET;
+    }
+    return events;
+}
+
+/**
+ * Synchronizes the registration of a file handle in the epoll instance with its interests.
+ *
+ * The file descriptor is only registered while the file handle has interests, otherwise EPOLLHUP and EPOLLERR
+ * would be reported for a file descriptor nobody is waiting on.
+ */
+static void UpdateEpollEvents(HAPPlatformFileHandle* fileHandle, bool rearm) {
+    HAPPrecondition(runLoop.epollFileDescriptor != -1);
+
+    uint32_t events = GetEpollEvents(fileHandle);
+    if (events == fileHandle->epollEvents && !(rearm && events)) {
+        return;
+    }
+
+    int op;
+    if (!events) {
+        op = EPOLL_CTL_DEL;
+    } else if (!fileHandle->epollEvents) {
+        op = EPOLL_CTL_ADD;
+    } else {
+        op = EPOLL_CTL_MOD;
+    }
+
+    struct epoll_event event = { .events = events, .data.ptr = fileHandle };
+    int e = epoll_ctl(runLoop.epollFileDescriptor, op, fileHandle->fileDescriptor, &event);
+    if (e != 0) {
+        int _errno = errno;
+        HAPAssert(e == -1);
+        HAPPlatformLogPOSIXError(
+                kHAPLogType_Error, "System call 'epoll_ctl' failed.", _errno, __func__, HAP_FILE, __LINE__);
+        HAPFatalError();
+    }
+    fileHandle->epollEvents = events;
+}
+
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformFileHandleRegister(
+        HAPPlatformFileHandleRef* fileHandle_,
+        int fileDescriptor,
+        HAPPlatformFileHandleEvent interests,
+        HAPPlatformFileHandleCallback callback,
+        void* _Nullable context) {
+    HAPPrecondition(fileHandle_);
+    HAPPrecondition(fileDescriptor >= 0);
+
+    // Prepare fileHandle.
+    HAPPlatformFileHandle* fileHandle = calloc(1, sizeof(HAPPlatformFileHandle));
+    if (!fileHandle) {
+        HAPLog(&logObject, "Cannot allocate more file handles.");
+        *fileHandle_ = 0;
+        return kHAPError_OutOfResources;
+    }
+    fileHandle->fileDescriptor = fileDescriptor;
+    fileHandle->interests = interests;
+    fileHandle->callback = callback;
+    fileHandle->context = context;
+    fileHandle->epollEvents = 0;
+    fileHandle->isEdgeTriggered = false;
+    fileHandle->nextReleasedFileHandle = NULL;
+    UpdateEpollEvents(fileHandle, false);
+
+    *fileHandle_ = (HAPPlatformFileHandleRef) fileHandle;
+    return kHAPError_None;
+}
+
+void HAPPlatformFileHandleUpdateInterests(
+        HAPPlatformFileHandleRef fileHandle_,
+        HAPPlatformFileHandleEvent interests,
+        HAPPlatformFileHandleCallback callback,
+        void* _Nullable context) {
+    HAPPrecondition(fileHandle_);
+    HAPPlatformFileHandle* fileHandle = (HAPPlatformFileHandle * _Nonnull) fileHandle_;
+    HAPPrecondition(fileHandle->fileDescriptor != -1);
+
+    fileHandle->interests = interests;
+    fileHandle->callback = callback;
+    fileHandle->context = context;
+    UpdateEpollEvents(fileHandle, fileHandle->isEdgeTriggered);
+}
+
+void HAPPlatformFileHandleSetEdgeTriggered(HAPPlatformFileHandleRef fileHandle_, bool edgeTriggered) {
+    HAPPrecondition(fileHandle_);
+    HAPPlatformFileHandle* fileHandle = (HAPPlatformFileHandle * _Nonnull) fileHandle_;
+    HAPPrecondition(fileHandle->fileDescriptor != -1);
+
+    fileHandle->isEdgeTriggered = edgeTriggered;
+    UpdateEpollEvents(fileHandle, false);
+}
+
+void HAPPlatformFileHandleDeregister(HAPPlatformFileHandleRef fileHandle_) {
+    HAPPrecondition(fileHandle_);
+    HAPPlatformFileHandle* fileHandle = (HAPPlatformFileHandle * _Nonnull) fileHandle_;
+    HAPPrecondition(fileHandle->fileDescriptor != -1);
+
+    // The file descriptor may already be closed, and a closed file descriptor is removed from the epoll
+    // instance automatically.
+    if (fileHandle->epollEvents) {
+        struct epoll_event event = { 0 };
+        (void) epoll_ctl(runLoop.epollFileDescriptor, EPOLL_CTL_DEL, fileHandle->fileDescriptor, &event);
+    }
+
+    fileHandle->fileDescriptor = -1;
+    fileHandle->interests.isReadyForReading = false;
+    fileHandle->interests.isReadyForWriting = false;
+    fileHandle->interests.hasErrorConditionPending = false;
+    fileHandle->callback = NULL;
+    fileHandle->context = NULL;
+    fileHandle->epollEvents = 0;
+
+    // Events of this file handle may still be pending in the current batch, also when it is deregistered by
+    // a timer that expired before the batch is dispatched.
+    if (runLoop.isDispatching) {
+        fileHandle->nextReleasedFileHandle = runLoop.releasedFileHandles;
+        runLoop.releasedFileHandles = fileHandle;
+        return;
+    }
+    HAPPlatformFreeSafe(fileHandle);
+}
+
+static void ProcessEpollEvents(struct epoll_event* events, size_t numEvents) {
+    HAPPrecondition(events);
+    HAPPrecondition(runLoop.isDispatching);
+
+    for (size_t i = 0; i < numEvents; i++) {
+        HAPPlatformFileHandle* fileHandle = events[i].data.ptr;
+        uint32_t e = events[i].events;
+
+        if (fileHandle->fileDescriptor == -1 || !fileHandle->callback) {
+            continue;
+        }
+
+        HAPPlatformFileHandleEvent fileHandleEvents;
+        fileHandleEvents.isReadyForReading = fileHandle->interests.isReadyForReading &&
+                                             (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR));
+        fileHandleEvents.isReadyForWriting = fileHandle->interests.isReadyForWriting &&
+                                             (e & (EPOLLOUT | EPOLLHUP | EPOLLERR));
+        fileHandleEvents.hasErrorConditionPending = fileHandle->interests.hasErrorConditionPending &&
+                                                    (e & (EPOLLPRI | EPOLLERR));
+
+        if (fileHandleEvents.isReadyForReading || fileHandleEvents.isReadyForWriting ||
+            fileHandleEvents.hasErrorConditionPending) {
+            fileHandle->callback((HAPPlatformFileHandleRef) fileHandle, fileHandleEvents, fileHandle->context);
+        }
+    }
+}
+
+static void FreeReleasedFileHandles(void) {
+    while (runLoop.releasedFileHandles) {
+        HAPPlatformFileHandle* fileHandle = runLoop.releasedFileHandles;
+        runLoop.releasedFileHandles = fileHandle->nextReleasedFileHandle;
+        HAPPlatformFreeSafe(fileHandle);
+    }
+}
+
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformTimerRegister(
+        HAPPlatformTimerRef* timer_,
+        HAPTime deadline,
+        HAPPlatformTimerCallback callback,
+        void* _Nullable context) {
+    HAPPrecondition(timer_);
+    HAPPlatformTimer* _Nullable* newTimer = (HAPPlatformTimer * _Nullable*) timer_;
+    HAPPrecondition(callback);
+
+    // Prepare timer.
+    *newTimer = calloc(1, sizeof(HAPPlatformTimer));
+    if (!*newTimer) {
+        HAPLog(&logObject, "Cannot allocate more timers.");
+        return kHAPError_OutOfResources;
+    }
+    (*newTimer)->deadline = deadline ? deadline : 1;
+    (*newTimer)->callback = callback;
+    (*newTimer)->context = context;
+
+    // Insert timer.
+    for (HAPPlatformTimer* _Nullable* nextTimer = &runLoop.timers;; nextTimer = &(*nextTimer)->nextTimer) {
+        if (!*nextTimer) {
+            (*newTimer)->nextTimer = NULL;
+            *nextTimer = *newTimer;
+            break;
+        }
+        if ((*nextTimer)->deadline > deadline) {
+            // Search condition must be '>' and not '>=' to ensure that timers fire in ascending order of their
+            // deadlines and that timers registered with the same deadline fire in order of registration.
+            (*newTimer)->nextTimer = *nextTimer;
+            *nextTimer = *newTimer;
+            break;
+        }
+    }
+
+    return kHAPError_None;
+}
+
+void HAPPlatformTimerDeregister(HAPPlatformTimerRef timer_) {
+    HAPPrecondition(timer_);
+    HAPPlatformTimer* timer = (HAPPlatformTimer*) timer_;
+
+    // Find and remove timer.
+    for (HAPPlatformTimer* _Nullable* nextTimer = &runLoop.timers; *nextTimer; nextTimer = &(*nextTimer)->nextTimer) {
+        if (*nextTimer == timer) {
+            *nextTimer = timer->nextTimer;
+            HAPPlatformFreeSafe(timer);
+            return;
+        }
+    }
+
+    // Timer not found.
+    HAPFatalError();
+}
+
+static void ProcessExpiredTimers(void) {
+    // Get current time.
+    HAPTime now = HAPPlatformClockGetCurrent();
+
+    // Enumerate timers.
+    while (runLoop.timers) {
+        if (runLoop.timers->deadline > now) {
+            break;
+        }
+
+        // Update head, so that reentrant add / removes do not interfere.
+        HAPPlatformTimer* expiredTimer = runLoop.timers;
+        runLoop.timers = runLoop.timers->nextTimer;
+
+        // Invoke callback.
+        expiredTimer->callback((HAPPlatformTimerRef) expiredTimer, expiredTimer->context);
+
+        // Free memory.
+        HAPPlatformFreeSafe(expiredTimer);
+    }
+}
+
+static void CloseFileDescriptor(int fileDescriptor, const char* message) {
+    if (fileDescriptor == -1) {
+        return;
+    }
+    HAPLogDebug(&logObject, "close(%d);", fileDescriptor);
+    int e = close(fileDescriptor);
+    if (e != 0) {
+        int _errno = errno;
+        HAPAssert(e == -1);
+        HAPPlatformLogPOSIXError(kHAPLogType_Error, message, _errno, __func__, HAP_FILE, __LINE__);
+    }
+}
+
+static void HandleSelfPipeFileHandleCallback(
+        HAPPlatformFileHandleRef fileHandle,
+        HAPPlatformFileHandleEvent fileHandleEvents,
+        void* _Nullable context HAP_UNUSED) {
+    HAPAssert(fileHandle);
+    HAPAssert(fileHandle == runLoop.selfPipeFileHandle);
+    HAPAssert(fileHandleEvents.isReadyForReading);
+
+    HAPAssert(runLoop.numSelfPipeBytes < sizeof runLoop.selfPipeBytes);
+
+    ssize_t n;
+    do {
+        n = read(
+                runLoop.selfPipeFileDescriptor0,
+                &runLoop.selfPipeBytes[runLoop.numSelfPipeBytes],
+                sizeof runLoop.selfPipeBytes - runLoop.numSelfPipeBytes);
+    } while (n == -1 && errno == EINTR);
+    if (n == -1 && errno == EAGAIN) {
+        return;
+    }
+    if (n < 0) {
+        int _errno = errno;
+        HAPAssert(n == -1);
+        HAPPlatformLogPOSIXError(kHAPLogType_Error, "Self-pipe read failed.", _errno, __func__, HAP_FILE, __LINE__);
+        HAPFatalError();
+    }
+    if (n == 0) {
+        HAPLogError(&logObject, "Self-pipe read returned no data.");
+        HAPFatalError();
+    }
+
+    HAPAssert((size_t) n <= sizeof runLoop.selfPipeBytes - runLoop.numSelfPipeBytes);
+    runLoop.numSelfPipeBytes += (size_t) n;
+    for (;;) {
+        if (runLoop.numSelfPipeBytes < sizeof(HAPPlatformRunLoopCallback) + 1) {
+            break;
+        }
+        size_t contextSize = (size_t) runLoop.selfPipeBytes[sizeof(HAPPlatformRunLoopCallback)];
+        if (runLoop.numSelfPipeBytes < sizeof(HAPPlatformRunLoopCallback) + 1 + contextSize) {
+            break;
+        }
+
+        HAPPlatformRunLoopCallback callback;
+        HAPRawBufferCopyBytes(&callback, &runLoop.selfPipeBytes[0], sizeof(HAPPlatformRunLoopCallback));
+        HAPRawBufferCopyBytes(
+                &runLoop.selfPipeBytes[0],
+                &runLoop.selfPipeBytes[sizeof(HAPPlatformRunLoopCallback) + 1],
+                runLoop.numSelfPipeBytes - (sizeof(HAPPlatformRunLoopCallback) + 1));
+        runLoop.numSelfPipeBytes -= (sizeof(HAPPlatformRunLoopCallback) + 1);
+
+        // Issue memory barrier to ensure visibility of data referenced by callback context.
+        __sync_synchronize();
+
+        callback(contextSize ? &runLoop.selfPipeBytes[0] : NULL, contextSize);
+
+        HAPRawBufferCopyBytes(
+                &runLoop.selfPipeBytes[0], &runLoop.selfPipeBytes[contextSize], runLoop.numSelfPipeBytes - contextSize);
+        runLoop.numSelfPipeBytes -= contextSize;
+    }
+}
+
+void HAPPlatformRunLoopCreate(void) {
+    HAPError err;
+
+    HAPLogDebug(&logObject, "Storage configuration: runLoop = %lu", (unsigned long) sizeof runLoop);
+    HAPLogDebug(&logObject, "Storage configuration: fileHandle = %lu", (unsigned long) sizeof(HAPPlatformFileHandle));
+    HAPLogDebug(&logObject, "Storage configuration: timer = %lu", (unsigned long) sizeof(HAPPlatformTimer));
+
+    HAPPrecondition(runLoop.epollFileDescriptor == -1);
+    HAPPrecondition(runLoop.selfPipeFileDescriptor0 == -1);
+    HAPPrecondition(runLoop.selfPipeFileDescriptor1 == -1);
+
+    // Create epoll instance.
+    runLoop.epollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (runLoop.epollFileDescriptor == -1) {
+        HAPPlatformLogPOSIXError(
+                kHAPLogType_Error, "System call 'epoll_create1' failed.", errno, __func__, HAP_FILE, __LINE__);
+        HAPFatalError();
+    }
+
+    // Open self-pipe.
+    int fileDescriptor[2];
+    if (pipe(fileDescriptor) != 0) {
+        HAPPlatformLogPOSIXError(
+                kHAPLogType_Error, "System call 'pipe' failed.", errno, __func__, HAP_FILE, __LINE__);
+        HAPFatalError();
+    }
+    for (size_t i = 0; i < HAPArrayCount(fileDescriptor); i++) {
+        if (fcntl(fileDescriptor[i], F_SETFL, O_NONBLOCK) == -1) {
+            HAPPlatformLogPOSIXError(
+                    kHAPLogType_Error,
+                    "System call 'fcntl' to set self pipe file descriptor flags to 'non-blocking' failed.",
+                    errno,
+                    __func__,
+                    HAP_FILE,
+                    __LINE__);
+            HAPFatalError();
+        }
+    }
+    runLoop.selfPipeFileDescriptor0 = fileDescriptor[0];
+    runLoop.selfPipeFileDescriptor1 = fileDescriptor[1];
+
+    err = HAPPlatformFileHandleRegister(
+            &runLoop.selfPipeFileHandle,
+            runLoop.selfPipeFileDescriptor0,
+            (HAPPlatformFileHandleEvent) {
+                    .isReadyForReading = true, .isReadyForWriting = false, .hasErrorConditionPending = false },
+            HandleSelfPipeFileHandleCallback,
+            NULL);
+    if (err) {
+        HAPAssert(err == kHAPError_OutOfResources);
+        HAPLogError(&logObject, "Failed to register self-pipe file handle.");
+        HAPFatalError();
+    }
+    HAPAssert(runLoop.selfPipeFileHandle);
+
+    runLoop.state = kHAPPlatformRunLoopState_Idle;
+
+    // Issue memory barrier to ensure visibility of write to runLoop.selfPipeFileDescriptor1 on other threads.
+    __sync_synchronize();
+}
+
+void HAPPlatformRunLoopRelease(void) {
+    if (runLoop.selfPipeFileHandle) {
+        HAPPlatformFileHandleDeregister(runLoop.selfPipeFileHandle);
+        runLoop.selfPipeFileHandle = 0;
+    }
+
+    CloseFileDescriptor(runLoop.selfPipeFileDescriptor0, "Closing pipe failed (log, selfPipeFileDescriptor0).");
+    CloseFileDescriptor(runLoop.selfPipeFileDescriptor1, "Closing pipe failed (log, selfPipeFileDescriptor1).");
+    CloseFileDescriptor(runLoop.epollFileDescriptor, "Closing epoll instance failed.");
+
+    runLoop.selfPipeFileDescriptor0 = -1;
+    runLoop.selfPipeFileDescriptor1 = -1;
+    runLoop.epollFileDescriptor = -1;
+
+    runLoop.state = kHAPPlatformRunLoopState_Idle;
+
+    // Issue memory barrier to ensure visibility of write to runLoop.selfPipeFileDescriptor1 on other threads.
+    __sync_synchronize();
+}
+
+void HAPPlatformRunLoopRun(void) {
+    HAPPrecondition(runLoop.state == kHAPPlatformRunLoopState_Idle);
+
+    HAPLogInfo(&logObject, "Entering run loop.");
+    runLoop.state = kHAPPlatformRunLoopState_Running;
+    do {
+        int timeout = -1;
+        HAPTime nextDeadline = runLoop.timers ? runLoop.timers->deadline : 0;
+        if (nextDeadline) {
+            HAPTime now = HAPPlatformClockGetCurrent();
+            HAPTime delta = nextDeadline > now ? nextDeadline - now : 0;
+            timeout = delta > INT_MAX ? INT_MAX : (int) delta;
+        }
+
+        struct epoll_event events[kHAPPlatformRunLoop_MaxEvents];
+        int e = epoll_wait(runLoop.epollFileDescriptor, events, (int) HAPArrayCount(events), timeout);
+        if (e == -1 && errno == EINTR) {
+            continue;
+        }
+        if (e < 0) {
+            int _errno = errno;
+            HAPAssert(e == -1);
+            HAPPlatformLogPOSIXError(
+                    kHAPLogType_Error, "System call 'epoll_wait' failed.", _errno, __func__, HAP_FILE, __LINE__);
+            HAPFatalError();
+        }
+
+        // File handles deregistered by the timers or the callbacks are only freed after the whole batch is
+        // dispatched, since their events may still be pending in it.
+        runLoop.isDispatching = true;
+        ProcessExpiredTimers();
+        ProcessEpollEvents(events, (size_t) e);
+        runLoop.isDispatching = false;
+        FreeReleasedFileHandles();
+    } while (runLoop.state == kHAPPlatformRunLoopState_Running);
+
+    HAPLogInfo(&logObject, "Exiting run loop.");
+    HAPAssert(runLoop.state == kHAPPlatformRunLoopState_Stopping);
+    runLoop.state = kHAPPlatformRunLoopState_Idle;
+}
+
+void HAPPlatformRunLoopStop(void) {
+    if (runLoop.state == kHAPPlatformRunLoopState_Running) {
+        runLoop.state = kHAPPlatformRunLoopState_Stopping;
+    }
+}
+
+HAPError HAPPlatformRunLoopScheduleCallback(
+        HAPPlatformRunLoopCallback callback,
+        void* _Nullable const context,
+        size_t contextSize) {
+    HAPPrecondition(callback);
+    HAPPrecondition(!contextSize || context);
+
+    if (contextSize > UINT8_MAX) {
+        HAPLogError(&logObject, "Contexts larger than UINT8_MAX are not supported.");
+        return kHAPError_OutOfResources;
+    }
+    if (contextSize + 1 + sizeof callback > PIPE_BUF) {
+        HAPLogError(&logObject, "Context too large (PIPE_BUF).");
+        return kHAPError_OutOfResources;
+    }
+
+    // Issue memory barrier to ensure visibility of write to runLoop.selfPipeFileDescriptor1 on other threads.
+    __sync_synchronize();
+
+    // Serialize event context.
+    // Format: Callback pointer followed by 1 byte context size and context data.
+    // Context is copied to offset 0 when invoking the callback to ensure proper alignment.
+    uint8_t bytes[sizeof callback + 1 + UINT8_MAX];
+    size_t numBytes = 0;
+    HAPRawBufferCopyBytes(&bytes[numBytes], &callback, sizeof callback);
+    numBytes += sizeof callback;
+    bytes[numBytes] = (uint8_t) contextSize;
+    numBytes++;
+    if (context) {
+        HAPRawBufferCopyBytes(&bytes[numBytes], context, contextSize);
+        numBytes += contextSize;
+    }
+    HAPAssert(numBytes <= sizeof bytes);
+
+    ssize_t n;
+    do {
+        n = write(runLoop.selfPipeFileDescriptor1, bytes, numBytes);
+    } while (n == -1 && errno == EINTR);
+    if (n == -1) {
+        HAPLogError(&logObject, "write failed: %ld.", (long) n);
+        return kHAPError_Unknown;
+    }
+
+    return kHAPError_None;
+}